@@ -0,0 +1,137 @@
+#include <cmath>
+#include <charconv>
+#include "bench.h"
+
+namespace luisa::bench {
+
+uint32_t argument(const std::vector<std::string_view> &args, size_t i, uint32_t fallback) {
+    if (i >= args.size()) { return fallback; }
+    auto value = fallback;
+    if (auto [end, error] = std::from_chars(args[i].data(), args[i].data() + args[i].size(), value);
+        error != std::errc{} || end != args[i].data() + args[i].size()) {
+        std::cerr << "ignoring argument \"" << args[i] << "\", which is not an unsigned integer." << std::endl;
+        return fallback;
+    }
+    return value;
+}
+
+namespace {
+
+void add_triangle(SyntheticMesh &mesh, math::float3 a, math::float3 b, math::float3 c, uint32_t material_id) {
+    auto normal = math::normalize(math::cross(b - a, c - a));
+    for (auto p : {a, b, c}) {
+        mesh.positions.emplace_back(p);
+        mesh.normals.emplace_back(normal);
+    }
+    mesh.material_ids.emplace_back(material_id);
+}
+
+void add_quad(SyntheticMesh &mesh, math::float3 a, math::float3 b, math::float3 c, math::float3 d, uint32_t material_id) {
+    add_triangle(mesh, a, b, c, material_id);
+    add_triangle(mesh, a, c, d, material_id);
+}
+
+template<typename T>
+[[nodiscard]] std::shared_ptr<Buffer> upload(Device &device, const std::vector<T> &data) {
+    auto buffer = device.create_buffer(sizeof(T) * data.size(), BufferStorageTag::MANAGED);
+    buffer->upload(data.data(), sizeof(T) * data.size());
+    return buffer;
+}
+
+}
+
+SyntheticMesh make_synthetic_mesh(uint32_t sphere_triangle_count) {
+
+    SyntheticMesh mesh;
+
+    // floor, back, left and right walls of a box of side 4 at the origin, open at the top and towards the camera
+    add_quad(mesh, {-2.0f, 0.0f, 2.0f}, {2.0f, 0.0f, 2.0f}, {2.0f, 0.0f, -2.0f}, {-2.0f, 0.0f, -2.0f}, 0u);
+    add_quad(mesh, {-2.0f, 0.0f, -2.0f}, {2.0f, 0.0f, -2.0f}, {2.0f, 4.0f, -2.0f}, {-2.0f, 4.0f, -2.0f}, 0u);
+    add_quad(mesh, {-2.0f, 0.0f, 2.0f}, {-2.0f, 0.0f, -2.0f}, {-2.0f, 4.0f, -2.0f}, {-2.0f, 4.0f, 2.0f}, 1u);
+    add_quad(mesh, {2.0f, 0.0f, -2.0f}, {2.0f, 0.0f, 2.0f}, {2.0f, 4.0f, 2.0f}, {2.0f, 4.0f, -2.0f}, 2u);
+
+    // rings x 2 rings quads, the poles included, with a ripple so that the sphere does not collapse into a few large boxes
+    auto rings = std::max(static_cast<uint32_t>(std::sqrt(static_cast<float>(sphere_triangle_count) / 4.0f)), 2u);
+    auto segments = rings * 2u;
+    auto vertex = [rings, segments](uint32_t i, uint32_t j) noexcept {
+        auto theta = math::K_PI * static_cast<float>(i) / static_cast<float>(rings);
+        auto phi = 2.0f * math::K_PI * static_cast<float>(j % segments) / static_cast<float>(segments);
+        auto r = 0.9f * (1.0f + 0.05f * std::sin(24.0f * theta) * std::sin(24.0f * phi));
+        return math::float3{r * std::sin(theta) * std::cos(phi), 1.2f + r * std::cos(theta), r * std::sin(theta) * std::sin(phi)};
+    };
+    mesh.positions.reserve(mesh.positions.size() + 6ul * rings * segments);
+    mesh.normals.reserve(mesh.normals.size() + 6ul * rings * segments);
+    mesh.material_ids.reserve(mesh.material_ids.size() + 2ul * rings * segments);
+    for (auto i = 0u; i < rings; i++) {
+        for (auto j = 0u; j < segments; j++) {
+            add_quad(mesh, vertex(i, j), vertex(i, j + 1u), vertex(i + 1u, j + 1u), vertex(i + 1u, j), 0u);
+        }
+    }
+    return mesh;
+}
+
+Scene make_scene(Device &device, const SyntheticMesh &mesh, AccelerationStructureBuildMode build_mode) {
+    Scene scene;
+    scene.position_buffer = upload(device, mesh.positions);
+    scene.normal_buffer = upload(device, mesh.normals);
+    scene.material_id_buffer = upload(device, mesh.material_ids);
+    scene.material_buffer = upload(device, std::vector<MaterialData>{
+        {{0.8f, 0.8f, 0.8f}, 0u}, {{0.8f, 0.1f, 0.1f}, 0u}, {{0.1f, 0.8f, 0.1f}, 0u}});
+    scene.light_buffer = upload(device, std::vector<LightData>{{{0.0f, 3.5f, 1.0f}, {20.0f, 20.0f, 20.0f}}});
+    scene.light_count = 1u;
+    scene.acceleration_structure = device.create_acceleration_structure(
+        *scene.position_buffer, sizeof(math::float3), mesh.triangle_count(), build_mode);
+    return scene;
+}
+
+std::shared_ptr<Camera> make_camera(Device &device) {
+    return create<Camera>(device, "Pinhole", {
+        {"position", std::vector<float>{0.0f, 2.0f, 6.5f}},
+        {"target", std::vector<float>{0.0f, 1.5f, 0.0f}},
+        {"up", std::vector<float>{0.0f, 1.0f, 0.0f}},
+        {"fov", std::vector<float>{22.0f}}});
+}
+
+void TimedDispatcher::operator()(Kernel &kernel, math::uint2 threadgroups, math::uint2 threadgroup_size, std::function<void(KernelArgumentEncoder &)> encode) {
+    auto function = &dynamic_cast<cpu::CPUKernel &>(kernel).function();
+    enqueue([this] { _start = std::chrono::steady_clock::now(); });
+    CPUKernelDispatcher::operator()(kernel, threadgroups, threadgroup_size, std::move(encode));
+    enqueue([this, function] { _milliseconds[function] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count(); });
+}
+
+double TimedDispatcher::milliseconds(std::string_view kernel_name) const noexcept {
+    auto iter = _milliseconds.find(cpu::cpu_kernel_function(kernel_name));
+    return iter == _milliseconds.end() ? 0.0 : iter->second;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+
+    using namespace luisa;
+
+    static constexpr bench::Benchmark benchmarks[]{
+        {"scheduling", "[width = 1920] [height = 1080] [frames = 8] [sphere triangles = 200000]", bench::run_scheduling_benchmark},
+        {"bvh", "[triangles = 2000000] [camera width = 1920] [camera height = 1080] [repeats = 3]", bench::run_bvh_benchmark},
+        {"ray_queue", "[repeats = 5]", bench::run_ray_queue_benchmark},
+        {"parser", "[megabytes = 256] [repeats = 5]", bench::run_parser_benchmark},
+        {"motion", "[width = 1920] [height = 1080] [triangles = 200000] [repeats = 3]", bench::run_motion_benchmark}};
+
+    auto benchmark = argc < 2 ? nullptr : std::find_if(std::begin(benchmarks), std::end(benchmarks), [name = std::string_view{argv[1]}](auto &&b) {
+        return b.name == name;
+    });
+    if (benchmark == nullptr || benchmark == std::end(benchmarks)) {
+        std::cerr << "usage: " << argv[0] << " <benchmark> [arguments...], where the benchmarks are\n";
+        for (auto &&b : benchmarks) { std::cerr << "  " << b.name << " " << b.usage << "\n"; }
+        return 1;
+    }
+
+    try {
+        cpu::CPUDevice device;
+        benchmark->run(device, std::vector<std::string_view>(argv + 2, argv + argc));
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+
+#include <luisa_render.h>
+#include <devices/cpu/cpu_kernel.h>
+
+namespace luisa::bench {
+
+// Every benchmark gets the CPU device and the command line arguments after its name, and prints its own table.
+struct Benchmark {
+    std::string_view name;
+    std::string_view usage;
+    void (*run)(cpu::CPUDevice &device, const std::vector<std::string_view> &args);
+};
+
+void run_scheduling_benchmark(cpu::CPUDevice &device, const std::vector<std::string_view> &args);
+void run_bvh_benchmark(cpu::CPUDevice &device, const std::vector<std::string_view> &args);
+void run_ray_queue_benchmark(cpu::CPUDevice &device, const std::vector<std::string_view> &args);
+void run_parser_benchmark(cpu::CPUDevice &device, const std::vector<std::string_view> &args);
+void run_motion_benchmark(cpu::CPUDevice &device, const std::vector<std::string_view> &args);
+
+// the i-th argument as a number, or fallback if there are fewer
+[[nodiscard]] uint32_t argument(const std::vector<std::string_view> &args, size_t i, uint32_t fallback);
+
+// median wall-clock milliseconds of repeats runs of f, after one more run to warm up the caches and the thread pool
+template<typename F>
+[[nodiscard]] double median_milliseconds(uint32_t repeats, F &&f) {
+    f();
+    std::vector<double> times;
+    for (auto i = 0u; i < std::max(repeats, 1u); i++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        times.emplace_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::nth_element(times.begin(), times.begin() + times.size() / 2u, times.end());
+    return times[times.size() / 2u];
+}
+
+template<typename T>
+[[nodiscard]] std::shared_ptr<T> create(Device &device, std::string_view detail_name, const CoreTypeInitializerParameterSet &param_set) {
+    auto object = TypeReflectionManager::instance().create(tag_of_non_value_core_type<T>, detail_name);
+    object->initialize(device, param_set);
+    return std::dynamic_pointer_cast<T>(object);
+}
+
+// Flat triangles in the layout of Scene, i.e. three vertices per triangle: an open box, so that some rays escape early, around
+// a bumpy sphere of about sphere_triangle_count triangles that carries most of the geometry.
+struct SyntheticMesh {
+    std::vector<math::float3> positions;
+    std::vector<math::float3> normals;
+    std::vector<uint32_t> material_ids;
+    [[nodiscard]] uint32_t triangle_count() const noexcept { return static_cast<uint32_t>(material_ids.size()); }
+};
+
+[[nodiscard]] SyntheticMesh make_synthetic_mesh(uint32_t sphere_triangle_count);
+
+// the mesh on the device with a few matte materials and one point light, and a pinhole camera looking into the box
+[[nodiscard]] Scene make_scene(Device &device, const SyntheticMesh &mesh, AccelerationStructureBuildMode build_mode);
+[[nodiscard]] std::shared_ptr<Camera> make_camera(Device &device);
+
+// Runs the commands it records on the calling thread when committed, like the device does on its queue thread, and times every
+// kernel dispatched through it, so that the kernels of a frame can be told apart; traces and other enqueued commands are not timed.
+class TimedDispatcher : public cpu::CPUKernelDispatcher {
+
+private:
+    std::unordered_map<const cpu::CPUKernelFunction *, double> _milliseconds;
+    std::chrono::steady_clock::time_point _start;
+
+public:
+    using CPUKernelDispatcher::CPUKernelDispatcher;
+    void operator()(Kernel &kernel, math::uint2 threadgroups, math::uint2 threadgroup_size, std::function<void(KernelArgumentEncoder &)> encode) override;
+
+    // of the dispatches of the named kernel committed so far
+    [[nodiscard]] double milliseconds(std::string_view kernel_name) const noexcept;
+    void reset() noexcept { _milliseconds.clear(); }
+};
+
+}
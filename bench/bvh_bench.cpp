@@ -0,0 +1,84 @@
+#include <random>
+#include <iomanip>
+#include <util/thread_pool.h>
+#include "bench.h"
+
+namespace luisa::bench {
+
+// Builds the synthetic mesh with every build mode and traces camera rays, which are coherent, and rays of random origins in the
+// box and random directions, which are not, with every traversal mode.
+void run_bvh_benchmark(cpu::CPUDevice &device, const std::vector<std::string_view> &args) {
+
+    auto mesh = make_synthetic_mesh(argument(args, 0u, 2000000u));
+    math::uint2 camera_size{argument(args, 1u, 1920u), argument(args, 2u, 1080u)};
+    auto repeats = argument(args, 3u, 3u);
+    auto ray_count = camera_size.x * camera_size.y;
+
+    auto position_buffer = device.create_buffer(sizeof(math::float3) * mesh.positions.size(), BufferStorageTag::MANAGED);
+    position_buffer->upload(mesh.positions.data(), sizeof(math::float3) * mesh.positions.size());
+
+    RayQueue camera_rays{device, ray_count, RayEncoding::FULL, BufferStorageTag::MANAGED};
+    auto random_texture = device.create_texture(camera_size, TextureFormatTag::RGBA32F, TextureAccessTag::READ_WRITE);
+    device.launch([&](KernelDispatcher &dispatch) { make_camera(device)->generate_rays(dispatch, *random_texture, camera_rays, camera_size); });
+
+    RayQueue random_rays{device, ray_count, RayEncoding::FULL, BufferStorageTag::MANAGED};
+    std::vector<RayGeometry> geometries(ray_count);
+    std::mt19937 random{19260817u};
+    std::uniform_real_distribution<float> uniform{0.0f, 1.0f};
+    for (auto &&ray : geometries) {
+        auto z = 1.0f - 2.0f * uniform(random);
+        auto r = std::sqrt(std::max(1.0f - z * z, 0.0f));
+        auto phi = 2.0f * math::K_PI * uniform(random);
+        ray = {{4.0f * uniform(random) - 2.0f, 4.0f * uniform(random), 4.0f * uniform(random) - 2.0f}, 1e-4f,
+               {r * std::cos(phi), r * std::sin(phi), z}, std::numeric_limits<float>::infinity()};
+    }
+    random_rays.geometry_buffer().upload(geometries.data(), sizeof(RayGeometry) * ray_count);
+    std::vector<RayPixel> pixels(ray_count, RayPixel{{}, 0.0f, 0.0f});
+    random_rays.pixel_buffer().upload(pixels.data(), sizeof(RayPixel) * ray_count);
+
+    auto ray_count_buffer = device.create_buffer(sizeof(uint32_t), BufferStorageTag::MANAGED);
+    ray_count_buffer->upload(&ray_count, sizeof(uint32_t));
+    auto intersection_buffer = device.create_buffer(sizeof(Intersection) * ray_count, BufferStorageTag::MANAGED);
+
+    std::cout << mesh.triangle_count() << " triangles, " << ray_count << " rays per trace, " << util::ThreadPool::instance().worker_count()
+              << " workers; median build milliseconds and Mrays/s of " << repeats << " runs\n\n"
+              << std::left << std::setw(8) << "build" << std::right << std::setw(12) << "build (ms)" << "  " << std::left << std::setw(12) << "traversal"
+              << std::right << std::setw(16) << "camera nearest" << std::setw(12) << "camera any" << std::setw(16) << "random nearest" << std::setw(12) << "random any"
+              << "\n";
+
+    for (auto build_mode : {AccelerationStructureBuildMode::SAH, AccelerationStructureBuildMode::LBVH, AccelerationStructureBuildMode::TRBVH}) {
+        std::shared_ptr<AccelerationStructure> structure;
+        auto build_milliseconds = median_milliseconds(repeats, [&] {
+            structure = device.create_acceleration_structure(*position_buffer, sizeof(math::float3), mesh.triangle_count(), build_mode);
+        });
+        auto &&cpu_structure = dynamic_cast<cpu::CPUAccelerationStructure &>(*structure);
+        for (auto traversal_mode : {cpu::CPUTraversalMode::SCALAR, cpu::CPUTraversalMode::WIDE, cpu::CPUTraversalMode::PACKET}) {
+            cpu_structure.set_traversal_mode(traversal_mode);
+            auto mrays_per_second = [&](RayQueue &rays, bool any_hit) {
+                auto milliseconds = median_milliseconds(repeats, [&] {
+                    device.launch([&](KernelDispatcher &dispatch) {
+                        if (any_hit) {
+                            structure->trace_any(dispatch, rays, *intersection_buffer, *ray_count_buffer, 0u);
+                        } else {
+                            structure->trace_nearest(dispatch, rays, *intersection_buffer, *ray_count_buffer, 0u);
+                        }
+                    });
+                });
+                return ray_count * 1e-3 / milliseconds;
+            };
+            std::cout << std::left << std::setw(8)
+                      << (traversal_mode != cpu::CPUTraversalMode::SCALAR ? "" :
+                          build_mode == AccelerationStructureBuildMode::SAH ? "SAH" :
+                          build_mode == AccelerationStructureBuildMode::LBVH ? "LBVH" : "TRBVH")
+                      << std::right << std::fixed << std::setprecision(1) << std::setw(12);
+            if (traversal_mode == cpu::CPUTraversalMode::SCALAR) { std::cout << build_milliseconds; } else { std::cout << ""; }
+            std::cout << "  " << std::left << std::setw(12)
+                      << (traversal_mode == cpu::CPUTraversalMode::SCALAR ? "SCALAR" : traversal_mode == cpu::CPUTraversalMode::WIDE ? "WIDE" : "PACKET")
+                      << std::right << std::setprecision(2)
+                      << std::setw(16) << mrays_per_second(camera_rays, false) << std::setw(12) << mrays_per_second(camera_rays, true)
+                      << std::setw(16) << mrays_per_second(random_rays, false) << std::setw(12) << mrays_per_second(random_rays, true) << "\n";
+        }
+    }
+}
+
+}
@@ -0,0 +1,106 @@
+#include <iomanip>
+#include <util/thread_pool.h>
+#include "bench.h"
+
+namespace luisa::bench {
+
+namespace {
+
+// object-to-world, uniform scaling then translation
+[[nodiscard]] math::float4x4 scaling_translation(float scaling, math::float3 translation) noexcept {
+    return {math::float4{scaling, 0.0f, 0.0f, 0.0f}, math::float4{0.0f, scaling, 0.0f, 0.0f},
+            math::float4{0.0f, 0.0f, scaling, 0.0f}, math::float4{translation, 1.0f}};
+}
+
+}
+
+// Traces the camera rays of one frame against two instances of the synthetic mesh, the second one shrunk and moving sideways
+// over the shutter [0, 1], with the times the camera draws from the sampler. Rays all at shutter open have to hit exactly what
+// they hit in a static structure with the instances at shutter open; spread over the shutter, they see the moving instance smeared.
+void run_motion_benchmark(cpu::CPUDevice &device, const std::vector<std::string_view> &args) {
+
+    math::uint2 size{argument(args, 0u, 1920u), argument(args, 1u, 1080u)};
+    auto mesh = make_synthetic_mesh(argument(args, 2u, 200000u));
+    auto repeats = argument(args, 3u, 3u);
+    auto ray_count = size.x * size.y;
+
+    auto position_buffer = device.create_buffer(sizeof(math::float3) * mesh.positions.size(), BufferStorageTag::MANAGED);
+    position_buffer->upload(mesh.positions.data(), sizeof(math::float3) * mesh.positions.size());
+    std::vector<std::shared_ptr<AccelerationStructure>> meshes{
+        device.create_acceleration_structure(*position_buffer, sizeof(math::float3), mesh.triangle_count(), AccelerationStructureBuildMode::SAH)};
+
+    std::vector<uint32_t> mesh_indices{0u, 0u};
+    auto mesh_index_buffer = device.create_buffer(sizeof(uint32_t) * mesh_indices.size(), BufferStorageTag::MANAGED);
+    mesh_index_buffer->upload(mesh_indices.data(), sizeof(uint32_t) * mesh_indices.size());
+
+    // two keyframes per instance, the first instance standing still
+    std::vector<math::float4x4> keyframes{
+        scaling_translation(1.0f, {}), scaling_translation(1.0f, {}),
+        scaling_translation(0.25f, {-1.0f, 0.5f, 1.5f}), scaling_translation(0.25f, {1.0f, 0.5f, 1.5f})};
+    auto keyframe_buffer = device.create_buffer(sizeof(math::float4x4) * keyframes.size(), BufferStorageTag::MANAGED);
+    keyframe_buffer->upload(keyframes.data(), sizeof(math::float4x4) * keyframes.size());
+    std::vector<math::float4x4> open_transforms{keyframes[0], keyframes[2]};
+    auto open_transform_buffer = device.create_buffer(sizeof(math::float4x4) * open_transforms.size(), BufferStorageTag::MANAGED);
+    open_transform_buffer->upload(open_transforms.data(), sizeof(math::float4x4) * open_transforms.size());
+
+    auto static_structure = device.create_instance_acceleration_structure(meshes, *mesh_index_buffer, *open_transform_buffer, 2u);
+    auto motion_structure = device.create_motion_instance_acceleration_structure(meshes, *mesh_index_buffer, *keyframe_buffer, 2u, 2u, 0.0f, 1.0f);
+
+    auto sampler = create<Sampler>(device, "Halton", {});
+    auto random_texture = device.create_texture(size, TextureFormatTag::RGBA32F, TextureAccessTag::READ_WRITE);
+    auto ray_count_buffer = device.create_buffer(sizeof(uint32_t), BufferStorageTag::MANAGED);
+    ray_count_buffer->upload(&ray_count, sizeof(uint32_t));
+    auto intersection_buffer = device.create_buffer(sizeof(InstanceIntersection) * ray_count, BufferStorageTag::MANAGED);
+
+    std::cout << size.x << "x" << size.y << " camera rays, 2 instances of " << mesh.triangle_count() << " triangles, "
+              << util::ThreadPool::instance().worker_count() << " workers; median Mrays/s of " << repeats << " runs\n\n"
+              << std::left << std::setw(10) << "structure" << std::setw(10) << "shutter" << std::right << std::setw(10) << "Mrays/s"
+              << std::setw(24) << "hits on moving instance" << std::setw(24) << "differing from static" << "\n";
+
+    std::vector<InstanceIntersection> static_intersections;
+    for (auto [structure, shutter_close] : {std::make_pair(static_structure.get(), 0.0f),
+                                            std::make_pair(motion_structure.get(), 0.0f),
+                                            std::make_pair(motion_structure.get(), 1.0f)}) {
+
+        auto camera = create<Camera>(device, "Pinhole", {
+            {"position", std::vector<float>{0.0f, 2.0f, 6.5f}},
+            {"target", std::vector<float>{0.0f, 1.5f, 0.0f}},
+            {"up", std::vector<float>{0.0f, 1.0f, 0.0f}},
+            {"fov", std::vector<float>{22.0f}},
+            {"shutter", std::vector<float>{0.0f, shutter_close}}});
+        RayQueue rays{device, ray_count, RayEncoding::FULL, BufferStorageTag::MANAGED};
+        device.launch([&](KernelDispatcher &dispatch) {
+            sampler->prepare_for_frame(size, 0u, SAMPLER_GROUP_DIMENSIONS);
+            sampler->generate_samples(dispatch, *random_texture, camera->random_number_dimensions());
+            camera->generate_rays(dispatch, *random_texture, rays, size, 0.0f);
+        });
+
+        auto milliseconds = median_milliseconds(repeats, [&] {
+            device.launch([&](KernelDispatcher &dispatch) {
+                structure->trace_nearest(dispatch, rays, *intersection_buffer, *ray_count_buffer, 0u);
+            });
+        });
+
+        auto intersections = static_cast<const InstanceIntersection *>(intersection_buffer->data());
+        auto moving_hits = 0u;
+        auto differing = 0u;
+        for (auto i = 0u; i < ray_count; i++) {
+            auto &&hit = intersections[i];
+            if (hit.distance >= 0.0f && hit.instance_index == 1u) { moving_hits++; }
+            if (!static_intersections.empty()) {
+                auto &&expected = static_intersections[i];
+                if ((hit.distance >= 0.0f) != (expected.distance >= 0.0f) ||
+                    (hit.distance >= 0.0f && (hit.instance_index != expected.instance_index || hit.triangle_index != expected.triangle_index))) {
+                    differing++;
+                }
+            }
+        }
+        if (static_intersections.empty()) { static_intersections.assign(intersections, intersections + ray_count); }
+
+        std::cout << std::left << std::setw(10) << (structure == static_structure.get() ? "static" : "motion")
+                  << std::setw(10) << (shutter_close == 0.0f ? "[0, 0]" : "[0, 1]") << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(10) << ray_count * 1e-3 / milliseconds << std::setw(24) << moving_hits << std::setw(24) << differing << "\n";
+    }
+}
+
+}
@@ -0,0 +1,94 @@
+#include <random>
+#include <fstream>
+#include <iomanip>
+#include <filesystem>
+#include <core/parser.h>
+#include "bench.h"
+
+namespace luisa {
+
+// A task that only holds the numbers parsed for it, so that the generated scenes need no files, shapes or device work.
+DERIVED_CLASS(ParseBenchmarkTask, Task) {
+
+protected:
+    PROPERTY(std::vector<float>, values, CoreTypeTag::FLOAT) { _values = params; }
+    PROPERTY(std::vector<int32_t>, indices, CoreTypeTag::INTEGER) { _indices = params; }
+
+public:
+    CREATOR("ParseBenchmark") noexcept { return std::make_shared<ParseBenchmarkTask>(); }
+    void initialize(Device &device [[maybe_unused]], const CoreTypeInitializerParameterSet &param_set) override {
+        _decode_values(param_set);
+        _decode_indices(param_set);
+    }
+    [[nodiscard]] size_t number_count() const noexcept { return _values.size() + _indices.size(); }
+};
+
+}
+
+namespace luisa::bench {
+
+namespace {
+
+constexpr auto TRIANGLES_PER_TASK = 65536u;
+
+// Writes about megabytes of tasks shaped like inline meshes, i.e. three vertices of three floats as %g prints them, with the odd
+// sign and exponent, and three vertex indices per triangle, and returns the number count.
+size_t generate_scene(const std::filesystem::path &path, uint32_t megabytes) {
+    std::ofstream file{path, std::ios::binary};
+    std::mt19937 random{19260817u};
+    std::uniform_real_distribution<float> uniform{-100.0f, 100.0f};
+    auto target_size = static_cast<size_t>(megabytes) << 20u;
+    auto count = 0ul;
+    char buffer[32];
+    file << "// generated by LuisaBench parser\ntasks {\n";
+    for (auto task = 0u; static_cast<size_t>(file.tellp()) < target_size; task++) {
+        file << (task == 0u ? "" : ",\n") << "  ParseBenchmark {\n    values {";
+        for (auto i = 0u; i < 9u * TRIANGLES_PER_TASK; i++) {
+            auto value = uniform(random);
+            if (i % 97u == 0u) { value *= 1e-6f; }
+            std::snprintf(buffer, sizeof(buffer), "%g", value);
+            file << (i == 0u ? " " : i % 9u == 0u ? ",\n      " : ", ") << (i % 89u == 0u && value > 0.0f ? "+" : "") << buffer;
+        }
+        file << " }\n    indices {";
+        for (auto i = 0u; i < 3u * TRIANGLES_PER_TASK; i++) {
+            file << (i == 0u ? " " : i % 12u == 0u ? ",\n      " : ", ") << (task * 3u * TRIANGLES_PER_TASK + i) % 16777216u;
+        }
+        file << " }\n  }";
+        count += 12u * TRIANGLES_PER_TASK;
+    }
+    file << "\n}\n";
+    return count;
+}
+
+}
+
+// Parses a generated scene of the given size, which is written to the working directory and removed afterwards.
+void run_parser_benchmark(cpu::CPUDevice &device, const std::vector<std::string_view> &args) {
+
+    auto megabytes = std::max(argument(args, 0u, 256u), 1u);
+    auto repeats = argument(args, 1u, 5u);
+    auto path = std::filesystem::current_path() / "parser_bench.luisa";
+    auto number_count = generate_scene(path, megabytes);
+    auto file_size = std::filesystem::file_size(path);
+
+    auto task_count = 0ul;
+    auto parsed_count = 0ul;
+    auto milliseconds = median_milliseconds(repeats, [&] {
+        auto tasks = Parser{device}.parse(path);
+        task_count = tasks.size();
+        parsed_count = 0ul;
+        for (auto &&task : tasks) { parsed_count += std::dynamic_pointer_cast<ParseBenchmarkTask>(task)->number_count(); }
+    });
+    std::filesystem::remove(path);
+    if (parsed_count != number_count) {
+        std::cerr << "parsed " << parsed_count << " numbers, expected " << number_count << "." << std::endl;
+    }
+
+    std::cout << std::fixed << std::setprecision(2) << file_size / 1048576.0 << " MB, " << task_count << " tasks, " << number_count
+              << " numbers; median of " << repeats << " runs\n\n"
+              << std::left << std::setw(16) << "milliseconds" << std::setw(10) << "MB/s" << "M numbers/s\n"
+              << std::setw(16) << milliseconds << std::setw(10) << file_size / 1048576.0 / milliseconds * 1e3
+              << number_count * 1e-3 / milliseconds << "\n";
+}
+
+}
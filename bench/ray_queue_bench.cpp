@@ -0,0 +1,163 @@
+#include <iomanip>
+#include <util/thread_pool.h>
+#include "bench.h"
+
+namespace luisa::bench {
+
+namespace {
+
+constexpr auto RAYS_PER_TASK = 4096u;
+
+// The memory accesses of the wavefront stages over n live rays, with as little arithmetic as possible: the trace reads the geometry
+// and writes an intersection, light sampling reads the geometry and the pixel and writes a shadow ray, the shading reads
+// everything and updates the ray, and compaction copies every ray. With Ray and ShadowRay buffers, or with the queue streams.
+
+struct AoSRays {
+
+    std::vector<Ray> rays;
+    std::vector<Ray> next_rays;
+    std::vector<ShadowRay> shadow_rays;
+
+    explicit AoSRays(uint32_t n) : rays(n), next_rays(n), shadow_rays(n) {
+        for (auto i = 0u; i < n; i++) {
+            rays[i] = {{}, 0.0f, {0.0f, 0.0f, -1.0f}, 1e3f, math::packed_float3{1.0f}, 1.0f, math::packed_float3{0.0f}, 0u,
+                       math::float2{static_cast<float>(i % 4096u), static_cast<float>(i / 4096u)}, 0.0f, 0.0f};
+        }
+    }
+
+    void trace(uint32_t i, Intersection &intersection) const noexcept {
+        auto &&ray = rays[i];
+        intersection = {ray.max_distance * 0.5f, i, math::float2{ray.origin.x, ray.direction.y}};
+    }
+
+    void sample_lights(uint32_t i, const Intersection &intersection) noexcept {
+        auto &&ray = rays[i];
+        if (ray.max_distance <= 0.0f) { return; }
+        auto P = ray.origin + intersection.distance * ray.direction;
+        shadow_rays[i] = {P, 1e-4f, -ray.direction, intersection.distance, math::packed_float3{ray.pixel.x}, 1.0f, ray.time};
+    }
+
+    void trace_radiance(uint32_t i, const Intersection &intersection) noexcept {
+        auto &&ray = rays[i];
+        auto &&shadow_ray = shadow_rays[i];
+        ray.radiance += ray.throughput * shadow_ray.light_radiance * (shadow_ray.max_distance / shadow_ray.light_pdf);
+        ray.throughput *= 0.5f;
+        ray.pdf *= 0.5f;
+        ray.origin = shadow_ray.origin;
+        ray.direction = -ray.direction;
+        ray.max_distance = intersection.distance;
+        ray.depth++;
+    }
+
+    void compact(uint32_t i) noexcept { next_rays[i] = rays[i]; }
+};
+
+template<typename Streams>
+struct SoARays {
+
+    std::vector<RayGeometry> geometries[2];  // the second queue holds the shadow rays and the compacted rays, as in PathTracing
+    std::vector<typename Streams::Throughput> throughputs[2];
+    std::vector<typename Streams::Radiance> radiances[2];
+    std::vector<typename Streams::Pixel> pixels[2];
+
+    explicit SoARays(uint32_t n) {
+        for (auto q = 0u; q < 2u; q++) {
+            geometries[q].resize(n);
+            throughputs[q].resize(n);
+            radiances[q].resize(n);
+            pixels[q].resize(n);
+        }
+        for (auto i = 0u; i < n; i++) {
+            geometries[0][i] = {{}, 0.0f, {0.0f, 0.0f, -1.0f}, 1e3f};
+            throughputs[0][i] = Streams::Throughput::encode({math::packed_float3{1.0f}, 1.0f});
+            radiances[0][i] = Streams::Radiance::encode({math::packed_float3{0.0f}, 0u});
+            pixels[0][i] = Streams::Pixel::encode({math::float2{static_cast<float>(i % 4096u), static_cast<float>(i / 4096u)}, 0.0f, 0.0f});
+        }
+    }
+
+    void trace(uint32_t i, Intersection &intersection) const noexcept {
+        auto &&ray = geometries[0][i];
+        intersection = {ray.max_distance * 0.5f, i, math::float2{ray.origin.x, ray.direction.y}};
+    }
+
+    void sample_lights(uint32_t i, const Intersection &intersection) noexcept {
+        auto &&ray = geometries[0][i];
+        if (ray.max_distance <= 0.0f) { return; }
+        auto pixel = Streams::Pixel::decode(pixels[0][i]);
+        auto P = ray.origin + intersection.distance * ray.direction;
+        geometries[1][i] = {P, 1e-4f, -ray.direction, intersection.distance};
+        throughputs[1][i] = Streams::Throughput::encode({math::packed_float3{pixel.pixel.x}, 1.0f});
+        pixels[1][i] = Streams::Pixel::encode(pixel);
+    }
+
+    void trace_radiance(uint32_t i, const Intersection &intersection) noexcept {
+        auto &&ray = geometries[0][i];
+        auto &&shadow_ray = geometries[1][i];
+        auto light = Streams::Throughput::decode(throughputs[1][i]);
+        auto throughput = Streams::Throughput::decode(throughputs[0][i]);
+        auto radiance = Streams::Radiance::decode(radiances[0][i]);
+        [[maybe_unused]] auto pixel = Streams::Pixel::decode(pixels[0][i]);
+        radiance.radiance += throughput.throughput * light.throughput * (shadow_ray.max_distance / light.pdf);
+        radiance.depth++;
+        throughput.throughput *= 0.5f;
+        throughput.pdf *= 0.5f;
+        ray.origin = shadow_ray.origin;
+        ray.direction = -ray.direction;
+        ray.max_distance = intersection.distance;
+        throughputs[0][i] = Streams::Throughput::encode(throughput);
+        radiances[0][i] = Streams::Radiance::encode(radiance);
+    }
+
+    void compact(uint32_t i) noexcept {
+        geometries[1][i] = geometries[0][i];
+        throughputs[1][i] = throughputs[0][i];
+        radiances[1][i] = radiances[0][i];
+        pixels[1][i] = pixels[0][i];
+    }
+};
+
+// median milliseconds of each stage
+template<typename Rays>
+[[nodiscard]] std::array<double, 4> time_stages(cpu::CPUScheduler &scheduler, uint32_t n, uint32_t repeats) {
+    Rays rays{n};
+    std::vector<Intersection> intersections(n);
+    auto stage = [&](auto &&f) {
+        return median_milliseconds(repeats, [&] {
+            scheduler.dispatch((n + RAYS_PER_TASK - 1u) / RAYS_PER_TASK, cpu::CPUSchedulingPolicy::WORK_STEALING, [&](uint32_t task) {
+                for (auto i = task * RAYS_PER_TASK; i < std::min((task + 1u) * RAYS_PER_TASK, n); i++) { f(i); }
+            });
+        });
+    };
+    return {stage([&](uint32_t i) { rays.trace(i, intersections[i]); }),
+            stage([&](uint32_t i) { rays.sample_lights(i, intersections[i]); }),
+            stage([&](uint32_t i) { rays.trace_radiance(i, intersections[i]); }),
+            stage([&](uint32_t i) { rays.compact(i); })};
+}
+
+}
+
+void run_ray_queue_benchmark(cpu::CPUDevice &device [[maybe_unused]], const std::vector<std::string_view> &args) {
+
+    auto repeats = argument(args, 0u, 5u);
+    std::cout << "bytes per ray: Ray " << sizeof(Ray) << " and ShadowRay " << sizeof(ShadowRay) << ", queue streams "
+              << sizeof(RayGeometry) + sizeof(RayThroughput) + sizeof(RayRadiance) + sizeof(RayPixel) << " or "
+              << sizeof(RayGeometry) + sizeof(CompactRayThroughput) + sizeof(CompactRayRadiance) + sizeof(CompactRayPixel) << " compact; "
+              << util::ThreadPool::instance().worker_count() << " workers; median milliseconds of " << repeats << " runs\n";
+
+    cpu::CPUScheduler scheduler;
+    for (auto size : {math::uint2{1920u, 1080u}, math::uint2{3840u, 2160u}}) {
+        auto n = size.x * size.y;
+        auto aos = time_stages<AoSRays>(scheduler, n, repeats);
+        auto soa = time_stages<SoARays<FullRayStreams>>(scheduler, n, repeats);
+        auto compact = time_stages<SoARays<CompactRayStreams>>(scheduler, n, repeats);
+        std::cout << "\n" << size.x << "x" << size.y << "\n" << std::left << std::setw(16) << "stage" << std::right
+                  << std::setw(10) << "AoS" << std::setw(10) << "SoA" << std::setw(14) << "SoA compact" << "\n";
+        constexpr std::string_view stages[]{"trace", "sample_lights", "trace_radiance", "compact"};
+        for (auto i = 0u; i < 4u; i++) {
+            std::cout << std::left << std::setw(16) << stages[i] << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(10) << aos[i] << std::setw(10) << soa[i] << std::setw(14) << compact[i] << "\n";
+        }
+    }
+}
+
+}
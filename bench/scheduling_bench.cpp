@@ -0,0 +1,58 @@
+#include <iomanip>
+#include <util/thread_pool.h>
+#include "bench.h"
+
+namespace luisa::bench {
+
+// Path traces the synthetic scene with both scheduling policies, timing the bounce kernels and the filter within the frames.
+void run_scheduling_benchmark(cpu::CPUDevice &device, const std::vector<std::string_view> &args) {
+
+    math::uint2 size{argument(args, 0u, 1920u), argument(args, 1u, 1080u)};
+    auto frames = std::max(argument(args, 2u, 8u), 1u);
+    auto mesh = make_synthetic_mesh(argument(args, 3u, 200000u));
+
+    auto scene = make_scene(device, mesh, AccelerationStructureBuildMode::SAH);
+    auto camera = make_camera(device);
+    auto sampler = create<Sampler>(device, "Halton", {});
+    auto integrator = create<Integrator>(device, "Path", {
+        {"sampler", std::vector<std::shared_ptr<Sampler>>{sampler}},
+        {"spp", std::vector<int32_t>{1}},
+        {"max_depth", std::vector<int32_t>{5}}});
+    auto filter = create<Filter>(device, "MitchellNetravali", {
+        {"radius", std::vector<float>{1.5f}},
+        {"b", std::vector<float>{1.0f / 3.0f}},
+        {"c", std::vector<float>{1.0f / 3.0f}}});
+    auto film = create<Film>(device, "RGB", {{"size", std::vector<float>{static_cast<float>(size.x), static_cast<float>(size.y)}}});
+    auto result_texture = device.create_texture(size, TextureFormatTag::RGBA32F, TextureAccessTag::READ_WRITE);
+
+    std::cout << size.x << "x" << size.y << ", " << mesh.triangle_count() << " triangles, " << frames << " frames of 1 spp and max depth 5, "
+              << util::ThreadPool::instance().worker_count() << " workers; milliseconds per frame\n\n"
+              << std::left << std::setw(16) << "policy" << std::right << std::setw(10) << "frame" << std::setw(16) << "sample_lights"
+              << std::setw(16) << "trace_radiance" << std::setw(14) << "filter_apply" << "\n";
+
+    cpu::CPUScheduler scheduler;
+    for (auto policy : {cpu::CPUSchedulingPolicy::STATIC, cpu::CPUSchedulingPolicy::WORK_STEALING}) {
+        TimedDispatcher dispatcher{scheduler, policy};
+        auto frame_index = 0u;
+        auto render = [&] {
+            integrator->render_frame(dispatcher, scene, *camera, *filter, *film, *result_texture, frame_index++);
+            dispatcher.commit();
+        };
+        render();  // allocates the buffers of the frame size
+        dispatcher.reset();
+        auto frame_milliseconds = 0.0;
+        for (auto i = 0u; i < frames; i++) {
+            auto start = std::chrono::steady_clock::now();
+            render();
+            frame_milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        std::cout << std::left << std::setw(16) << (policy == cpu::CPUSchedulingPolicy::STATIC ? "STATIC" : "WORK_STEALING")
+                  << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(10) << frame_milliseconds / frames
+                  << std::setw(16) << dispatcher.milliseconds("path_tracing_sample_lights") / frames
+                  << std::setw(16) << dispatcher.milliseconds("path_tracing_trace_radiance") / frames
+                  << std::setw(14) << dispatcher.milliseconds("filter_apply") / frames << "\n";
+    }
+}
+
+}
@@ -6,7 +6,11 @@ int main() {
     using namespace luisa;
     TypeReflectionManager::instance().print();
     
+#ifdef __APPLE__
     auto device = Device::create("Metal");
+#else
+    auto device = Device::create("CPU");
+#endif
     
     return 0;
 }
@@ -22,12 +22,19 @@ def ir_file_path(name):
     return "{}{}.air".format(build_directory, name)
 
 
-build_command_template = "xcrun -sdk macosx metal -std=macos-metal2.2 -Ofast -Wall -Wextra -ffast-math -c {src_path} -o {ir_path} -I {include_dir}"
+build_command_template = "xcrun -sdk macosx metal -std=macos-metal2.2 {optimization_flags} -Wall -Wextra -c {src_path} -o {ir_path} -I {include_dir}"
+fast_math_flags = "-Ofast -ffast-math"
+precise_math_flags = "-O3 -fno-fast-math"
+
+# the compensated accumulation of the filter must not be reassociated away
+precise_kernel_names = {"filter"}
+
 kernel_names = [f[:-6] for f in listdir(source_directory) if f.endswith(".metal")]
 for name in kernel_names:
     src_path = source_file_path(name)
     ir_path = ir_file_path(name)
-    command = build_command_template.format(src_path=src_path, ir_path=ir_path, include_dir=include_directory)
+    optimization_flags = precise_math_flags if name in precise_kernel_names else fast_math_flags
+    command = build_command_template.format(optimization_flags=optimization_flags, src_path=src_path, ir_path=ir_path, include_dir=include_directory)
     print("Generating Metal IR for:", src_path)
     print("  Command:", command)
     system(command)
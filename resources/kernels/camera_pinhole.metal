@@ -7,30 +7,66 @@ using namespace luisa;
 using namespace math;
 using namespace metal;
 
-kernel void pinhole_camera_generate_rays(
-    constant PinholeCameraGenerateRaysUniforms &uniforms [[buffer(0)]],
-    device Ray *rays [[buffer(1)]],
-    texture2d<float, access::read> random [[texture(0)]],
-    uint2 tid [[thread_position_in_grid]]) {
+template<typename Streams>
+inline void pinhole_camera_generate_rays_streams(
+    constant PinholeCameraGenerateRaysUniforms &uniforms,
+    device RayGeometry *ray_geometries,
+    device typename Streams::Throughput *ray_throughputs,
+    device typename Streams::Radiance *ray_radiances,
+    device typename Streams::Pixel *ray_pixels,
+    texture2d<float, access::read> random,
+    uint2 tid) {
     
-    if (tid.x < uniforms.frame_size.x && tid.y < uniforms.frame_size.y) {
+    if (tid.x < uniforms.frame_size.x && tid.y < uniforms.frame_size.y * uniforms.samples_per_pixel) {
         
+        // Offsets warped by filter importance sampling reach out of the pixel, whose gather ray the sample must still land in;
+        // so must offsets just below 1, which round up to the next pixel at larger coordinates. Scaling by 1 - 2^-24 gives the
+        // float right below tid + 1.
         auto r = random.read(tid);
-        auto pixel = float2(tid) + float2{r.x, r.y};
-        auto size = float2(uniforms.frame_size);
+        auto offset = float2{r.x, r.y};
+        auto pixel = min(float2(tid) + max(offset, float2(0.0f)), float2(tid + 1u) * 0.99999994f);
+        auto size = float2(uniforms.film_size);
         
-        auto sensor = (0.5f - pixel / size) * uniforms.sensor_size;
+        // the pixel records keep the row of the sample within the stacked planes, which the filter takes apart
+        auto film_pixel = uniforms.frame_origin + uint2(tid.x, tid.y % uniforms.frame_size.y);
+        auto sensor = (0.5f - (float2(film_pixel) + offset) / size) * uniforms.sensor_size;
+        auto index = tid.y * uniforms.frame_size.x + tid.x;
         
-        Ray ray{};
-        ray.origin = uniforms.position;
-        ray.direction = normalize(sensor.x * uniforms.left + sensor.y * uniforms.up + uniforms.near_plane * uniforms.front);
-        ray.min_distance = 0.0f;
-        ray.max_distance = INFINITY;
-        ray.throughput = {1.0f, 1.0f, 1.0f};
-        ray.radiance = {0.0f, 0.0f, 0.0f};
-        ray.depth = 0;
-        ray.pixel = pixel;
+        RayGeometry geometry{};
+        geometry.origin = uniforms.position;
+        geometry.direction = normalize(sensor.x * uniforms.left + sensor.y * uniforms.up + uniforms.near_plane * uniforms.front);
+        geometry.min_distance = 0.0f;
+        geometry.max_distance = INFINITY;
+        ray_geometries[index] = geometry;
         
-        rays[tid.y * uniforms.frame_size.x + tid.x] = ray;
+        ray_throughputs[index] = Streams::Throughput::encode(RayThroughput{float3{1.0f, 1.0f, 1.0f}, 1.0f});
+        ray_radiances[index] = Streams::Radiance::encode(RayRadiance{float3{0.0f, 0.0f, 0.0f}, 0u});
+        // the third channel is only generated for cameras with motion blur
+        auto time = uniforms.shutter_open < uniforms.shutter_close ? mix(uniforms.shutter_open, uniforms.shutter_close, r.z) : uniforms.shutter_open;
+        ray_pixels[index] = Streams::Pixel::encode(RayPixel{pixel, time, 0.0f});
     }
 }
+
+kernel void pinhole_camera_generate_rays(
+    constant PinholeCameraGenerateRaysUniforms &uniforms [[buffer(0)]],
+    device RayGeometry *ray_geometries [[buffer(1)]],
+    device RayThroughput *ray_throughputs [[buffer(2)]],
+    device RayRadiance *ray_radiances [[buffer(3)]],
+    device RayPixel *ray_pixels [[buffer(4)]],
+    texture2d<float, access::read> random [[texture(0)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    pinhole_camera_generate_rays_streams<FullRayStreams>(uniforms, ray_geometries, ray_throughputs, ray_radiances, ray_pixels, random, tid);
+}
+
+kernel void pinhole_camera_generate_rays_compact(
+    constant PinholeCameraGenerateRaysUniforms &uniforms [[buffer(0)]],
+    device RayGeometry *ray_geometries [[buffer(1)]],
+    device CompactRayThroughput *ray_throughputs [[buffer(2)]],
+    device CompactRayRadiance *ray_radiances [[buffer(3)]],
+    device CompactRayPixel *ray_pixels [[buffer(4)]],
+    texture2d<float, access::read> random [[texture(0)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    pinhole_camera_generate_rays_streams<CompactRayStreams>(uniforms, ray_geometries, ray_throughputs, ray_radiances, ray_pixels, random, tid);
+}
@@ -0,0 +1,165 @@
+#include "compatibility.h"
+
+#include <core/ray.h>
+#include <core/compaction.h>
+
+using namespace luisa;
+using namespace math;
+using namespace metal;
+
+kernel void compaction_count_rays(
+    constant CompactionUniforms &uniforms [[buffer(0)]],
+    device const Ray *rays [[buffer(1)]],
+    device const uint32_t &ray_count [[buffer(2)]],
+    device uint32_t *offsets [[buffer(3)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    if (tid.x < uniforms.scan_size) {
+        offsets[tid.x] = tid.x < ray_count && rays[tid.x].max_distance > 0.0f ? 1u : 0u;
+    }
+}
+
+// Work-efficient exclusive scan of the selection flags in place, after Blelloch: every pass is a dispatch of its own with one
+// thread per pair of partial sums, so the scan needs no threadgroup memory and runs the same on every device. The up-sweep
+// builds the sums of aligned ranges twice as long each pass, and the down-sweep turns them into offsets in the reverse order.
+
+kernel void compaction_scan_up(
+    constant CompactionUniforms &uniforms [[buffer(0)]],
+    device uint32_t *offsets [[buffer(1)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    if (tid.x < uniforms.scan_size / (uniforms.stride * 2u)) {
+        auto right = (tid.x + 1u) * uniforms.stride * 2u - 1u;
+        offsets[right] += offsets[right - uniforms.stride];
+    }
+}
+
+// between the sweeps, the sum of the whole range is the number of selected elements
+kernel void compaction_scan_total(
+    constant CompactionUniforms &uniforms [[buffer(0)]],
+    device uint32_t *offsets [[buffer(1)]],
+    device uint32_t &total_count [[buffer(2)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    if (tid.x == 0u) {
+        total_count = offsets[uniforms.scan_size - 1u];
+        offsets[uniforms.scan_size - 1u] = 0u;
+    }
+}
+
+kernel void compaction_scan_down(
+    constant CompactionUniforms &uniforms [[buffer(0)]],
+    device uint32_t *offsets [[buffer(1)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    if (tid.x < uniforms.scan_size / (uniforms.stride * 2u)) {
+        auto right = (tid.x + 1u) * uniforms.stride * 2u - 1u;
+        auto left = right - uniforms.stride;
+        auto sum = offsets[left];
+        offsets[left] = offsets[right];
+        offsets[right] += sum;
+    }
+}
+
+kernel void compaction_scatter_rays(
+    constant CompactionUniforms &uniforms [[buffer(0)]],
+    device const Ray *rays [[buffer(1)]],
+    device const uint32_t &ray_count [[buffer(2)]],
+    device const uint32_t *offsets [[buffer(3)]],
+    device Ray *output_rays [[buffer(4)]],
+    device GatherRay *gather_rays [[buffer(5)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    if (tid.x < ray_count) {
+        auto ray = rays[tid.x];
+        if (ray.max_distance > 0.0f) {  // still alive, packed for the next bounce
+            output_rays[offsets[tid.x]] = ray;
+        } else {
+            auto screen = uint2(ray.pixel);
+            gather_rays[screen.y * uniforms.frame_size.x + screen.x] = {ray.radiance, ray.pixel};
+        }
+    }
+}
+
+// the same over the streams of ray queues, where the counting pass only reads the geometry stream
+
+kernel void compaction_count_ray_queue(
+    constant CompactionUniforms &uniforms [[buffer(0)]],
+    device const RayGeometry *ray_geometries [[buffer(1)]],
+    device const uint32_t &ray_count [[buffer(2)]],
+    device uint32_t *offsets [[buffer(3)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    if (tid.x < uniforms.scan_size) {
+        offsets[tid.x] = tid.x < ray_count && ray_geometries[tid.x].max_distance > 0.0f ? 1u : 0u;
+    }
+}
+
+template<typename Streams>
+inline void compaction_scatter_ray_queue_streams(
+    constant CompactionUniforms &uniforms,
+    device const RayGeometry *ray_geometries,
+    device const typename Streams::Throughput *ray_throughputs,
+    device const typename Streams::Radiance *ray_radiances,
+    device const typename Streams::Pixel *ray_pixels,
+    device const uint32_t &ray_count,
+    device const uint32_t *offsets,
+    device RayGeometry *output_ray_geometries,
+    device typename Streams::Throughput *output_ray_throughputs,
+    device typename Streams::Radiance *output_ray_radiances,
+    device typename Streams::Pixel *output_ray_pixels,
+    device typename Streams::Gather *gather_rays,
+    uint2 tid) {
+    
+    if (auto i = tid.x; i < ray_count) {
+        if (ray_geometries[i].max_distance > 0.0f) {
+            auto offset = offsets[i];
+            output_ray_geometries[offset] = ray_geometries[i];
+            output_ray_throughputs[offset] = ray_throughputs[i];
+            output_ray_radiances[offset] = ray_radiances[i];
+            output_ray_pixels[offset] = ray_pixels[i];
+        } else {
+            auto pixel = Streams::Pixel::decode(ray_pixels[i]).pixel;
+            auto screen = uint2(pixel);
+            gather_rays[screen.y * uniforms.frame_size.x + screen.x] = Streams::Gather::encode(GatherRay{Streams::Radiance::decode(ray_radiances[i]).radiance, pixel});
+        }
+    }
+}
+
+kernel void compaction_scatter_ray_queue(
+    constant CompactionUniforms &uniforms [[buffer(0)]],
+    device const RayGeometry *ray_geometries [[buffer(1)]],
+    device const RayThroughput *ray_throughputs [[buffer(2)]],
+    device const RayRadiance *ray_radiances [[buffer(3)]],
+    device const RayPixel *ray_pixels [[buffer(4)]],
+    device const uint32_t &ray_count [[buffer(5)]],
+    device const uint32_t *offsets [[buffer(6)]],
+    device RayGeometry *output_ray_geometries [[buffer(7)]],
+    device RayThroughput *output_ray_throughputs [[buffer(8)]],
+    device RayRadiance *output_ray_radiances [[buffer(9)]],
+    device RayPixel *output_ray_pixels [[buffer(10)]],
+    device GatherRay *gather_rays [[buffer(11)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    compaction_scatter_ray_queue_streams<FullRayStreams>(uniforms, ray_geometries, ray_throughputs, ray_radiances, ray_pixels, ray_count, offsets,
+                                                         output_ray_geometries, output_ray_throughputs, output_ray_radiances, output_ray_pixels, gather_rays, tid);
+}
+
+kernel void compaction_scatter_ray_queue_compact(
+    constant CompactionUniforms &uniforms [[buffer(0)]],
+    device const RayGeometry *ray_geometries [[buffer(1)]],
+    device const CompactRayThroughput *ray_throughputs [[buffer(2)]],
+    device const CompactRayRadiance *ray_radiances [[buffer(3)]],
+    device const CompactRayPixel *ray_pixels [[buffer(4)]],
+    device const uint32_t &ray_count [[buffer(5)]],
+    device const uint32_t *offsets [[buffer(6)]],
+    device RayGeometry *output_ray_geometries [[buffer(7)]],
+    device CompactRayThroughput *output_ray_throughputs [[buffer(8)]],
+    device CompactRayRadiance *output_ray_radiances [[buffer(9)]],
+    device CompactRayPixel *output_ray_pixels [[buffer(10)]],
+    device CompactGatherRay *gather_rays [[buffer(11)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    compaction_scatter_ray_queue_streams<CompactRayStreams>(uniforms, ray_geometries, ray_throughputs, ray_radiances, ray_pixels, ray_count, offsets,
+                                                            output_ray_geometries, output_ray_throughputs, output_ray_radiances, output_ray_pixels, gather_rays, tid);
+}
@@ -31,10 +31,32 @@ enum struct access {
     read, write, read_write
 };
 
+// host-side view of a texture, cheap to pass by value like its Metal counterpart
 template<typename T, access mode>
 struct texture2d {
-    virtual luisa::math::float4 read(luisa::math::uint2 coord) = 0;
-    virtual void write(luisa::math::float4 value, luisa::math::uint2 coord) = 0;
+    
+    T *data;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    
+    [[nodiscard]] uint32_t get_width() const noexcept { return width; }
+    [[nodiscard]] uint32_t get_height() const noexcept { return height; }
+    
+    [[nodiscard]] luisa::math::float4 read(luisa::math::uint2 coord) const noexcept {
+        auto p = data + (static_cast<size_t>(coord.y) * width + coord.x) * channels;
+        return channels == 4u ? luisa::math::float4{p[0], p[1], p[2], p[3]} : luisa::math::float4{p[0], 0.0f, 0.0f, 1.0f};
+    }
+    
+    void write(luisa::math::float4 value, luisa::math::uint2 coord) const noexcept {
+        auto p = data + (static_cast<size_t>(coord.y) * width + coord.x) * channels;
+        p[0] = value.r;
+        if (channels == 4u) {
+            p[1] = value.g;
+            p[2] = value.b;
+            p[3] = value.a;
+        }
+    }
 };
 
 }
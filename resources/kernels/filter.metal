@@ -0,0 +1,268 @@
+#include "compatibility.h"
+
+#include <core/ray.h>
+#include <core/filter.h>
+
+using namespace luisa;
+using namespace math;
+using namespace metal;
+
+// the 1D weight at offset, in units of the radius, interpolated from the table of Filter
+inline float filter_weight(constant float *weights, float offset) {
+    auto x = abs(offset) * static_cast<float>(FILTER_WEIGHT_TABLE_SIZE - 1u);
+    if (x >= static_cast<float>(FILTER_WEIGHT_TABLE_SIZE - 1u)) { return 0.0f; }
+    auto i = static_cast<uint32_t>(x);
+    return mix(weights[i], weights[i + 1u], x - static_cast<float>(i));
+}
+
+// Adds the filtered sample of a frame to a film pixel, either blended into the running average or summed with Kahan's
+// compensation, kept in the compensation texture, for the film to divide by the weight sum on output. Both start over with
+// the first frame, so no texture needs clearing.
+inline void filter_accumulate_pixel(
+    constant FilterApplyUniforms &uniforms,
+    texture2d<float, access::read_write> result,
+    texture2d<float, access::read_write> compensation,
+    uint2 film_pixel,
+    float4 sample) {
+    
+    if (uniforms.compensated == 0u) {
+        result.write(mix(result.read(film_pixel), sample, 1.0f / (uniforms.frame_index + 1.0f)), film_pixel);
+    } else if (uniforms.frame_index == 0u) {
+        result.write(sample, film_pixel);
+        compensation.write(float4{}, film_pixel);
+    } else {
+        auto sum = result.read(film_pixel);
+        auto y = sample - compensation.read(film_pixel);
+        auto t = sum + y;
+        compensation.write((t - sum) - y, film_pixel);
+        result.write(t, film_pixel);
+    }
+}
+
+// The gather rays of a frame of samples_per_pixel samples hold one plane of frame_size per sample, stacked along y, the
+// rays of the s-th one being placed s * frame_size.y pixels down.
+
+template<typename Gather>
+inline void filter_apply_gather(
+    constant FilterApplyUniforms &uniforms,
+    device const Gather *rays,
+    constant float *weights,
+    texture2d<float, access::read_write> result,
+    texture2d<float, access::read_write> compensation,
+    uint2 tid) {
+    
+    if (tid.x < uniforms.tile_size.x && tid.y < uniforms.tile_size.y) {
+        
+        // the frame covers the footprint of the tile within the film, so clamping to it is clamping to the film
+        auto p = uniforms.tile_offset + tid;
+        auto pixel_radius = uniforms.pixel_radius;
+        
+        auto min_x = max(p.x, pixel_radius) - pixel_radius;
+        auto min_y = max(p.y, pixel_radius) - pixel_radius;
+        auto max_x = min(p.x + pixel_radius, uniforms.frame_size.x - 1u);
+        auto max_y = min(p.y + pixel_radius, uniforms.frame_size.y - 1u);
+        
+        float3 radiance_sum{};
+        auto weight_sum = 0.0f;
+        auto center = float2(p) + 0.5f;
+        for (auto s = 0u; s < uniforms.samples_per_pixel; s++) {
+            auto plane = s * uniforms.frame_size.y;
+            for (auto y = min_y; y <= max_y; y++) {
+                for (auto x = min_x; x <= max_x; x++) {
+                    auto index = (plane + y) * uniforms.frame_size.x + x;
+                    auto ray = Gather::decode(rays[index]);
+                    auto dx = (center.x - ray.pixel.x) * uniforms.inv_radius;
+                    auto dy = (center.y - (ray.pixel.y - static_cast<float>(plane))) * uniforms.inv_radius;
+                    auto weight = filter_weight(weights, dx) * filter_weight(weights, dy);
+                    radiance_sum += weight * ray.radiance;
+                    weight_sum += weight;
+                }
+            }
+        }
+        filter_accumulate_pixel(uniforms, result, compensation, uniforms.tile_origin + tid, float4(radiance_sum, weight_sum));
+    }
+}
+
+// the samples of the importance mode fall within their pixels in the gather rays (see pinhole_camera_generate_rays_streams())
+template<typename Gather>
+inline void filter_accumulate_gather(
+    constant FilterApplyUniforms &uniforms,
+    device const Gather *rays,
+    texture2d<float, access::read_write> result,
+    texture2d<float, access::read_write> compensation,
+    uint2 tid) {
+    
+    if (tid.x < uniforms.tile_size.x && tid.y < uniforms.tile_size.y) {
+        auto p = uniforms.tile_offset + tid;
+        float3 radiance_sum{};
+        for (auto s = 0u; s < uniforms.samples_per_pixel; s++) {
+            radiance_sum += Gather::decode(rays[(s * uniforms.frame_size.y + p.y) * uniforms.frame_size.x + p.x]).radiance;
+        }
+        auto sample = float4(radiance_sum, static_cast<float>(uniforms.samples_per_pixel));
+        filter_accumulate_pixel(uniforms, result, compensation, uniforms.tile_origin + tid, sample);
+    }
+}
+
+// The splatting mode: every thread takes the samples of a block of FILTER_SPLAT_BLOCK_SIZE^2 pixels of the frame, and adds their
+// weighted radiance into its own accumulator, covering the block and the pixel_radius pixels around it, so no two threads
+// write the same memory. The merge then sums the up to four accumulators over each pixel of the tile. The weights of a sample
+// are separable, so each one takes 2 * (2 * pixel_radius + 1) table reads, rather than twice the square in the gather.
+
+template<typename Gather>
+inline void filter_splat_gather(
+    constant FilterApplyUniforms &uniforms,
+    device const Gather *rays,
+    constant float *weights,
+    device float4 *accumulators,
+    uint2 tid) {
+    
+    auto block_count = (uniforms.frame_size + FILTER_SPLAT_BLOCK_SIZE - 1u) / FILTER_SPLAT_BLOCK_SIZE;
+    if (tid.x < block_count.x && tid.y < block_count.y) {
+        
+        auto r = uniforms.pixel_radius;
+        auto width = FILTER_SPLAT_BLOCK_SIZE + 2u * r;
+        auto accumulator = accumulators + (tid.y * block_count.x + tid.x) * width * width;
+        for (auto i = 0u; i < width * width; i++) { accumulator[i] = float4{}; }
+        
+        // the accumulator starts r pixels up and left of the block, which may lie out of the frame
+        auto block = tid * FILTER_SPLAT_BLOCK_SIZE;
+        auto block_end = min(block + FILTER_SPLAT_BLOCK_SIZE, uniforms.frame_size);
+        for (auto s = 0u; s < uniforms.samples_per_pixel; s++) {
+            auto plane = s * uniforms.frame_size.y;
+            for (auto y = block.y; y < block_end.y; y++) {
+                for (auto x = block.x; x < block_end.x; x++) {
+                    auto ray = Gather::decode(rays[(plane + y) * uniforms.frame_size.x + x]);
+                    auto pixel = float2{ray.pixel.x, ray.pixel.y - static_cast<float>(plane)};
+                    auto min_x = max(x, r) - r;
+                    auto min_y = max(y, r) - r;
+                    auto max_x = min(x + r, uniforms.frame_size.x - 1u);
+                    auto max_y = min(y + r, uniforms.frame_size.y - 1u);
+                    float wx[2u * FILTER_MAX_PIXEL_RADIUS + 1u];
+                    for (auto px = min_x; px <= max_x; px++) {
+                        wx[px - min_x] = filter_weight(weights, (static_cast<float>(px) + 0.5f - pixel.x) * uniforms.inv_radius);
+                    }
+                    for (auto py = min_y; py <= max_y; py++) {
+                        auto wy = filter_weight(weights, (static_cast<float>(py) + 0.5f - pixel.y) * uniforms.inv_radius);
+                        auto row = accumulator + (py + r - block.y) * width;
+                        for (auto px = min_x; px <= max_x; px++) {
+                            auto weight = wx[px - min_x] * wy;
+                            row[px + r - block.x] += float4(weight * ray.radiance, weight);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+kernel void filter_splat_merge(
+    constant FilterApplyUniforms &uniforms [[buffer(0)]],
+    device const float4 *accumulators [[buffer(1)]],
+    texture2d<float, access::read_write> result [[texture(0)]],
+    texture2d<float, access::read_write> compensation [[texture(1)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    if (tid.x < uniforms.tile_size.x && tid.y < uniforms.tile_size.y) {
+        
+        auto p = uniforms.tile_offset + tid;
+        auto r = uniforms.pixel_radius;
+        auto width = FILTER_SPLAT_BLOCK_SIZE + 2u * r;
+        auto block_count = (uniforms.frame_size + FILTER_SPLAT_BLOCK_SIZE - 1u) / FILTER_SPLAT_BLOCK_SIZE;
+        
+        // the blocks whose accumulators, r pixels wider on each side, contain p
+        auto min_block = (max(p, uint2(r)) - r) / FILTER_SPLAT_BLOCK_SIZE;
+        auto max_block = min((p + r) / FILTER_SPLAT_BLOCK_SIZE, block_count - 1u);
+        float4 sum{};
+        for (auto by = min_block.y; by <= max_block.y; by++) {
+            for (auto bx = min_block.x; bx <= max_block.x; bx++) {
+                auto accumulator = accumulators + (by * block_count.x + bx) * width * width;
+                sum += accumulator[(p.y + r - by * FILTER_SPLAT_BLOCK_SIZE) * width + (p.x + r - bx * FILTER_SPLAT_BLOCK_SIZE)];
+            }
+        }
+        filter_accumulate_pixel(uniforms, result, compensation, uniforms.tile_origin + tid, sum);
+    }
+}
+
+// an offset in [-1, 1], in units of the radius, distributed by the positive part of the weight
+inline float filter_sample_offset(constant float *inverse_cdf, float u) {
+    auto sign = u < 0.5f ? -1.0f : 1.0f;
+    auto x = (u < 0.5f ? 2.0f * u : 2.0f * u - 1.0f) * static_cast<float>(FILTER_WEIGHT_TABLE_SIZE - 1u);
+    auto i = min(static_cast<uint32_t>(x), FILTER_WEIGHT_TABLE_SIZE - 2u);
+    return sign * mix(inverse_cdf[i], inverse_cdf[i + 1u], x - static_cast<float>(i));
+}
+
+kernel void filter_warp_pixel_samples(
+    constant FilterWarpPixelSamplesUniforms &uniforms [[buffer(0)]],
+    constant float *inverse_cdf [[buffer(1)]],
+    texture2d<float, access::read_write> random [[texture(0)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    if (tid.x < uniforms.frame_size.x && tid.y < uniforms.frame_size.y) {
+        auto r = random.read(tid);
+        r.x = 0.5f + uniforms.radius * filter_sample_offset(inverse_cdf, r.x);
+        r.y = 0.5f + uniforms.radius * filter_sample_offset(inverse_cdf, r.y);
+        random.write(r, tid);
+    }
+}
+
+kernel void filter_apply(
+    constant FilterApplyUniforms &uniforms [[buffer(0)]],
+    device const GatherRay *rays [[buffer(1)]],
+    constant float *weights [[buffer(2)]],
+    texture2d<float, access::read_write> result [[texture(0)]],
+    texture2d<float, access::read_write> compensation [[texture(1)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    filter_apply_gather(uniforms, rays, weights, result, compensation, tid);
+}
+
+kernel void filter_apply_compact(
+    constant FilterApplyUniforms &uniforms [[buffer(0)]],
+    device const CompactGatherRay *rays [[buffer(1)]],
+    constant float *weights [[buffer(2)]],
+    texture2d<float, access::read_write> result [[texture(0)]],
+    texture2d<float, access::read_write> compensation [[texture(1)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    filter_apply_gather(uniforms, rays, weights, result, compensation, tid);
+}
+
+kernel void filter_accumulate(
+    constant FilterApplyUniforms &uniforms [[buffer(0)]],
+    device const GatherRay *rays [[buffer(1)]],
+    texture2d<float, access::read_write> result [[texture(0)]],
+    texture2d<float, access::read_write> compensation [[texture(1)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    filter_accumulate_gather(uniforms, rays, result, compensation, tid);
+}
+
+kernel void filter_accumulate_compact(
+    constant FilterApplyUniforms &uniforms [[buffer(0)]],
+    device const CompactGatherRay *rays [[buffer(1)]],
+    texture2d<float, access::read_write> result [[texture(0)]],
+    texture2d<float, access::read_write> compensation [[texture(1)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    filter_accumulate_gather(uniforms, rays, result, compensation, tid);
+}
+
+kernel void filter_splat(
+    constant FilterApplyUniforms &uniforms [[buffer(0)]],
+    device const GatherRay *rays [[buffer(1)]],
+    constant float *weights [[buffer(2)]],
+    device float4 *accumulators [[buffer(3)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    filter_splat_gather(uniforms, rays, weights, accumulators, tid);
+}
+
+kernel void filter_splat_compact(
+    constant FilterApplyUniforms &uniforms [[buffer(0)]],
+    device const CompactGatherRay *rays [[buffer(1)]],
+    constant float *weights [[buffer(2)]],
+    device float4 *accumulators [[buffer(3)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    filter_splat_gather(uniforms, rays, weights, accumulators, tid);
+}
@@ -1,173 +1,318 @@
-////
-//// Created by Mike Smith on 2019/10/21.
-////
 //
-//#include <intersection_data.h>
-//#include <material_data.h>
-//#include <light_data.h>
-//#include <onb.h>
-//#include <sampling.h>
-//#include <color_spaces.h>
+// Created by Mike Smith on 2019/10/21.
 //
-//using namespace metal;
-//
-//kernel void sample_lights(
-//    device RayData *ray_buffer [[buffer(0)]],
-//    device const IntersectionData *intersection_buffer [[buffer(1)]],
-//    device const LightData *light_buffer [[buffer(2)]],
-//    device const Vec3f *p_buffer[[buffer(3)]],
-//    device ShadowRayData *shadow_ray_buffer [[buffer(4)]],
-//    constant uint &light_count [[buffer(5)]],
-//    device const uint &ray_count [[buffer(6)]],
-//    uint tid [[thread_index_in_threadgroup]],
-//    uint2 tgsize [[threads_per_threadgroup]],
-//    uint2 tgid [[threadgroup_position_in_grid]],
-//    uint2 gsize [[threadgroups_per_grid]]) {
-//
-//    auto index = (tgsize.x * tgsize.y) * (tgid.y * gsize.x + tgid.x) + tid;
-//
-//    if (index < ray_count) {
-//
-//        auto its = intersection_buffer[index];
-//        auto ray_seed = ray_buffer[index].seed;
-//
-//        ShadowRayData shadow_ray{};
-//
-//        if (ray_buffer[index].max_distance <= 0.0f || its.distance <= 0.0f) {  // no intersection
-//            shadow_ray.max_distance = -1.0f;  // terminate the ray
-//        } else {  // has an intersection
-//            auto uvw = Vec3f(its.barycentric, 1.0f - its.barycentric.x - its.barycentric.y);
-//            auto i0 = its.triangle_index * 3u;
-//            auto P = uvw.x * p_buffer[i0] + uvw.y * p_buffer[i0 + 1] + uvw.z * p_buffer[i0 + 2];
-//            auto light = light_buffer[min(static_cast<uint>(halton(ray_seed) * light_count), light_count - 1u)];
-//            auto L = light.position - P;
-//            auto dist = length(L);
-//            auto inv_dist = 1.0f / dist;
-//            shadow_ray.direction = L * inv_dist;
-//            shadow_ray.origin = P + 1e-4f * shadow_ray.direction;
-//            shadow_ray.min_distance = 0.0f;
-//            shadow_ray.max_distance = dist - 1e-4f;
-//            shadow_ray.light_radiance = XYZ2ACEScg(RGB2XYZ(light.emission)) * inv_dist * inv_dist;
-//            shadow_ray.light_pdf = 1.0f / light_count;
-//        }
-//        ray_buffer[index].seed = ray_seed;
-//        shadow_ray_buffer[index] = shadow_ray;
-//    }
-//}
-//
-//kernel void trace_radiance(
-//    device RayData *ray_buffer [[buffer(0)]],
-//    device const ShadowRayData *shadow_ray_buffer [[buffer(1)]],
-//    device const IntersectionData *its_buffer [[buffer(2)]],
-//    device const ShadowIntersectionData *shadow_its_buffer [[buffer(3)]],
-//    device const Vec3f *p_buffer [[buffer(4)]],
-//    device const Vec3f *n_buffer [[buffer(5)]],
-//    device const uint *material_id_buffer [[buffer(6)]],
-//    device const MaterialData *material_buffer [[buffer(7)]],
-//    device const uint &ray_count [[buffer(8)]],
-//    uint tid [[thread_index_in_threadgroup]],
-//    uint2 tgsize [[threads_per_threadgroup]],
-//    uint2 tgid [[threadgroup_position_in_grid]],
-//    uint2 gsize [[threadgroups_per_grid]]) {
-//
-//    auto index = (tgsize.x * tgsize.y) * (tgid.y * gsize.x + tgid.x) + tid;
-//
-//    if (index < ray_count) {
-//
-//        auto ray = ray_buffer[index];
-//        if (ray.max_distance <= 0.0f || its_buffer[index].distance <= 0.0f) {  // no intersection
-//            ray.max_distance = -1.0f;  // terminate the ray
-//        } else {
-//            auto its = its_buffer[index];
-//            auto material = material_buffer[material_id_buffer[its.triangle_index]];
-//            material.albedo = XYZ2ACEScg(RGB2XYZ(material.albedo));
-//            auto i0 = its.triangle_index * 3;
-//            auto uvw = Vec3f(its.barycentric, 1.0f - its.barycentric.x - its.barycentric.y);
-//            auto P = uvw.x * p_buffer[i0] + uvw.y * p_buffer[i0 + 1] + uvw.z * p_buffer[i0 + 2];
-//            auto N = normalize(uvw.x * n_buffer[i0] + uvw.y * n_buffer[i0 + 1] + uvw.z * n_buffer[i0 + 2]);
-//            auto V = -ray.direction;
-//
-//            auto NdotV = dot(N, V);
-//            if (NdotV < 0.0f) {
-//                N = -N;
-//                NdotV = -NdotV;
-//            }
-//
-//            // direct lighting
-//            auto shadow_its = shadow_its_buffer[index];
-//            if (!material.is_mirror && shadow_its.distance < 0.0f) {  // not occluded
-//                auto shadow_ray = shadow_ray_buffer[index];
-//                auto L = shadow_ray.direction;
-//                auto NdotL = max(dot(N, L), 0.0f);
-//                ray.radiance += ray.throughput * material.albedo * NdotL * shadow_ray.light_radiance / shadow_ray.light_pdf;
-//            }
-//
-//            // sampling brdf
-//            ray.max_distance = INFINITY;
-//            if (material.is_mirror) {
-//                ray.direction = normalize(2.0f * NdotV * N - V);
-//            } else {
-//                ray.direction = normalize(Onb{N}.inverse_transform(Vec3f(cosine_sample_hemisphere(halton(ray.seed), halton(ray.seed)))));
-//                ray.throughput *= material.albedo;  // simplified for lambertian materials
-//                ray.depth++;
-//                if (ray.depth > 3) {  // RR
-//                    auto q = max(0.05f, 1.0f - ACEScg2Luminance(ray.throughput));
-//                    if (halton(ray.seed) < q) {
-//                        ray.max_distance = -1.0f;
-//                    } else {
-//                        ray.throughput /= 1.0f - q;
-//                    }
-//                }
-//            }
-//            ray.origin = P + 1e-4f * ray.direction;
-//            ray.min_distance = 0.0f;
-//        }
-//        ray_buffer[index] = ray;
-//    }
-//}
-//
-//kernel void sort_rays(
-//    device const RayData *ray_buffer [[buffer(0)]],
-//    device const uint &ray_count [[buffer(1)]],
-//    device RayData *output_ray_buffer [[buffer(2)]],
-//    device atomic_uint &output_ray_count [[buffer(3)]],
-//    constant FrameData &frame_data [[buffer(4)]],
-//    device GatherRayData *gather_ray_buffer [[buffer(5)]],
-//    uint tid [[thread_index_in_threadgroup]],
-//    uint2 tgsize [[threads_per_threadgroup]],
-//    uint2 tgid [[threadgroup_position_in_grid]],
-//    uint2 gsize [[threadgroups_per_grid]]) {
-//
-//    auto index = (tgsize.x * tgsize.y) * (tgid.y * gsize.x + tgid.x) + tid;
-//
-//    if (index < ray_count) {
-//        auto ray = ray_buffer[index];
-//        if (ray.max_distance > 0.0f) {  // add active rays to next bounce
-//            output_ray_buffer[atomic_fetch_add_explicit(&output_ray_count, 1u, memory_order_relaxed)] = ray;
-//        } else {
-//            auto screen = uint2(ray.pixel);
-//            auto gather_index = screen.y * frame_data.size.x + screen.x;
-//            gather_ray_buffer[gather_index] = {ray.radiance, ray.pixel};
-//        }
-//    }
-//}
-//
-//kernel void gather_rays(
-//    device const RayData *ray_buffer [[buffer(0)]],
-//    device const uint &ray_count [[buffer(1)]],
-//    device GatherRayData *gather_ray_buffer [[buffer(2)]],
-//    constant FrameData &frame_data [[buffer(3)]],
-//    uint tid [[thread_index_in_threadgroup]],
-//    uint2 tgsize [[threads_per_threadgroup]],
-//    uint2 tgid [[threadgroup_position_in_grid]],
-//    uint2 gsize [[threadgroups_per_grid]]) {
-//
-//    auto index = (tgsize.x * tgsize.y) * (tgid.y * gsize.x + tgid.x) + tid;
-//
-//    if (index < ray_count) {
-//        auto pixel = ray_buffer[index].pixel;
-//        auto screen = uint2(pixel);
-//        auto gather_index = screen.y * frame_data.size.x + screen.x;
-//        gather_ray_buffer[gather_index] = {ray_buffer[index].radiance, pixel};
-//    }
-//}
\ No newline at end of file
+
+#include "compatibility.h"
+
+#include <core/ray.h>
+#include <core/intersection.h>
+#include <core/color.h>
+#include <core/scene.h>
+#include <core/aov.h>
+#include <integrators/path_tracing.h>
+
+#include "sampling.h"
+
+using namespace luisa;
+using namespace math;
+using namespace metal;
+
+// Terminated paths are gathered by the compaction after each bounce, see compaction.metal and Compaction::compact_ray_queue().
+// Shadow rays are written to the streams of the other queue, which is free until the compaction refills it: the geometry
+// stream holds their records, the throughput stream the radiance of the light and its pdf, and the pixel stream the time.
+
+template<typename Streams>
+inline void path_tracing_sample_lights_streams(
+    constant PathTracingUniforms &uniforms,
+    device const RayGeometry *ray_geometries,
+    device const typename Streams::Pixel *ray_pixels,
+    device const uint32_t &ray_count,
+    device const Intersection *intersections,
+    device const float3 *positions,
+    device const LightData *lights,
+    device RayGeometry *shadow_ray_geometries,
+    device typename Streams::Throughput *shadow_ray_throughputs,
+    device typename Streams::Pixel *shadow_ray_pixels,
+    device const HaltonSamplerDimension *sampler_dimensions,
+    device const float *sampler_table,
+    device const float *sampler_blue_noise,
+    uint2 tid) {
+    
+    if (tid.x < ray_count) {
+        
+        auto its = intersections[tid.x];
+        
+        RayGeometry shadow_ray{};
+        if (ray_geometries[tid.x].max_distance <= 0.0f || its.distance <= 0.0f || uniforms.light_count == 0u) {
+            shadow_ray.max_distance = -1.0f;  // nothing to trace
+        } else {
+            auto ray_pixel = ray_pixels[tid.x];
+            auto u = sampler_sample(uniforms.sampler, sampler_dimensions, sampler_table, sampler_blue_noise, uint2(Streams::Pixel::decode(ray_pixel).pixel), uniforms.sample_dimension);
+            auto i0 = its.triangle_index * 3u;
+            auto w = 1.0f - its.barycentric.x - its.barycentric.y;
+            auto P = its.barycentric.x * positions[i0] + its.barycentric.y * positions[i0 + 1u] + w * positions[i0 + 2u];
+            auto light = lights[min(static_cast<uint32_t>(u * uniforms.light_count), uniforms.light_count - 1u)];
+            auto L = light.position - P;
+            auto dist = length(L);
+            auto inv_dist = 1.0f / dist;
+            shadow_ray.direction = L * inv_dist;
+            shadow_ray.origin = P + 1e-4f * shadow_ray.direction;
+            shadow_ray.min_distance = 0.0f;
+            shadow_ray.max_distance = dist - 1e-4f;
+            auto light_radiance = color::XYZ_to_ACEScg(color::RGB_to_XYZ(light.emission)) * inv_dist * inv_dist;
+            shadow_ray_throughputs[tid.x] = Streams::Throughput::encode(RayThroughput{light_radiance, 1.0f / static_cast<float>(uniforms.light_count)});
+            shadow_ray_pixels[tid.x] = ray_pixel;
+        }
+        shadow_ray_geometries[tid.x] = shadow_ray;
+    }
+}
+
+template<typename Streams>
+inline void path_tracing_trace_radiance_streams(
+    constant PathTracingUniforms &uniforms,
+    device RayGeometry *ray_geometries,
+    device typename Streams::Throughput *ray_throughputs,
+    device typename Streams::Radiance *ray_radiances,
+    device const typename Streams::Pixel *ray_pixels,
+    device const uint32_t &ray_count,
+    device const Intersection *intersections,
+    device const RayGeometry *shadow_ray_geometries,
+    device const typename Streams::Throughput *shadow_ray_throughputs,
+    device const ShadowIntersection *shadow_intersections,
+    device const float3 *positions,
+    device const float3 *normals,
+    device const uint32_t *material_ids,
+    device const MaterialData *materials,
+    device const HaltonSamplerDimension *sampler_dimensions,
+    device const float *sampler_table,
+    device const float *sampler_blue_noise,
+    uint2 tid) {
+    
+    if (tid.x < ray_count) {
+        
+        auto ray = ray_geometries[tid.x];
+        auto its = intersections[tid.x];
+        
+        if (ray.max_distance <= 0.0f || its.distance <= 0.0f) {  // escaped, no environment to pick up
+            ray_geometries[tid.x].max_distance = -1.0f;
+        } else {
+            
+            auto throughput = Streams::Throughput::decode(ray_throughputs[tid.x]);
+            auto radiance = Streams::Radiance::decode(ray_radiances[tid.x]);
+            auto sample_pixel = uint2(Streams::Pixel::decode(ray_pixels[tid.x]).pixel);
+            auto material = materials[material_ids[its.triangle_index]];
+            auto albedo = color::XYZ_to_ACEScg(color::RGB_to_XYZ(material.albedo));
+            
+            auto i0 = its.triangle_index * 3u;
+            auto w = 1.0f - its.barycentric.x - its.barycentric.y;
+            auto P = its.barycentric.x * positions[i0] + its.barycentric.y * positions[i0 + 1u] + w * positions[i0 + 2u];
+            auto N = normalize(its.barycentric.x * normals[i0] + its.barycentric.y * normals[i0 + 1u] + w * normals[i0 + 2u]);
+            auto V = -ray.direction;
+            auto NdotV = dot(N, V);
+            if (NdotV < 0.0f) {
+                N = -N;
+                NdotV = -NdotV;
+            }
+            
+            // direct lighting, Lambertian surfaces only
+            auto shadow_ray = shadow_ray_geometries[tid.x];
+            if (material.is_mirror == 0u && shadow_ray.max_distance > 0.0f && shadow_intersections[tid.x].distance < 0.0f) {
+                auto light = Streams::Throughput::decode(shadow_ray_throughputs[tid.x]);
+                auto NdotL = max(dot(N, shadow_ray.direction), 0.0f);
+                radiance.radiance += throughput.throughput * albedo * K_1_PI * NdotL * light.throughput / light.pdf;
+            }
+            
+            // next direction, in the frame of Duff et al., "Building an Orthonormal Basis, Revisited"
+            float3 wi;
+            if (material.is_mirror != 0u) {
+                wi = 2.0f * NdotV * N - V;
+            } else {
+                auto sign = N.z >= 0.0f ? 1.0f : -1.0f;
+                auto a = -1.0f / (sign + N.z);
+                auto b = N.x * N.y * a;
+                auto T = float3(1.0f + sign * N.x * N.x * a, sign * b, -sign * N.x);
+                auto B = float3(b, sign + N.y * N.y * a, -N.y);
+                auto u0 = sampler_sample(uniforms.sampler, sampler_dimensions, sampler_table, sampler_blue_noise, sample_pixel, uniforms.sample_dimension + 1u);
+                auto u1 = sampler_sample(uniforms.sampler, sampler_dimensions, sampler_table, sampler_blue_noise, sample_pixel, uniforms.sample_dimension + 2u);
+                auto phi = 2.0f * K_PI * u0;
+                auto radius = sqrt(u1);
+                wi = radius * cos(phi) * T + radius * sin(phi) * B + sqrt(max(1.0f - u1, 0.0f)) * N;
+                throughput.throughput *= albedo;  // cosine-weighted, so the Lambertian BRDF and pdf leave the albedo only
+            }
+            ray.direction = normalize(wi);
+            ray.origin = P + 1e-4f * ray.direction;
+            ray.min_distance = 0.0f;
+            ray.max_distance = INFINITY;
+            radiance.depth++;
+            
+            if (radiance.depth >= uniforms.max_depth) {
+                ray.max_distance = -1.0f;
+            } else if (radiance.depth > 3u) {  // Russian roulette
+                auto q = max(0.05f, 1.0f - max(throughput.throughput.x, max(throughput.throughput.y, throughput.throughput.z)));
+                if (sampler_sample(uniforms.sampler, sampler_dimensions, sampler_table, sampler_blue_noise, sample_pixel, uniforms.sample_dimension + 3u) < q) {
+                    ray.max_distance = -1.0f;
+                } else {
+                    throughput.throughput /= 1.0f - q;
+                }
+            }
+            ray_geometries[tid.x] = ray;
+            ray_throughputs[tid.x] = Streams::Throughput::encode(throughput);
+            ray_radiances[tid.x] = Streams::Radiance::encode(radiance);
+        }
+    }
+}
+
+// Averages the first hits of the camera rays of every tile pixel into the AOVs the film keeps, the running averages over the
+// frames starting over with the first one.
+kernel void path_tracing_write_aovs(
+    constant PathTracingWriteAOVsUniforms &uniforms [[buffer(0)]],
+    device const RayGeometry *ray_geometries [[buffer(1)]],
+    device const Intersection *intersections [[buffer(2)]],
+    device const float3 *normals [[buffer(3)]],
+    device const uint32_t *material_ids [[buffer(4)]],
+    device const MaterialData *materials [[buffer(5)]],
+    device float *depths [[buffer(6)]],
+    device packed_float3 *aov_normals [[buffer(7)]],
+    device packed_float3 *albedos [[buffer(8)]],
+    device uint32_t *primitive_ids [[buffer(9)]],
+    device uint32_t *sample_counts [[buffer(10)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    if (tid.x < uniforms.tile_size.x && tid.y < uniforms.tile_size.y) {
+        
+        auto p = uniforms.tile_offset + tid;
+        auto depth = 0.0f;
+        float3 normal{};
+        float3 albedo{};
+        auto primitive_id = AOV_NO_PRIMITIVE;
+        for (auto s = 0u; s < uniforms.samples_per_pixel; s++) {
+            auto index = (s * uniforms.frame_size.y + p.y) * uniforms.frame_size.x + p.x;
+            auto its = intersections[index];
+            if (its.distance > 0.0f) {
+                auto i0 = its.triangle_index * 3u;
+                auto w = 1.0f - its.barycentric.x - its.barycentric.y;
+                auto N = normalize(its.barycentric.x * normals[i0] + its.barycentric.y * normals[i0 + 1u] + w * normals[i0 + 2u]);
+                depth += its.distance;
+                normal += dot(N, ray_geometries[index].direction) > 0.0f ? -N : N;
+                albedo += materials[material_ids[its.triangle_index]].albedo;
+                if (s == 0u) { primitive_id = its.triangle_index; }
+            }
+        }
+        auto inv_count = 1.0f / static_cast<float>(uniforms.samples_per_pixel);
+        depth *= inv_count;
+        normal *= inv_count;
+        albedo *= inv_count;
+        
+        auto film_pixel = uniforms.tile_origin + tid;
+        auto film_index = film_pixel.y * uniforms.film_width + film_pixel.x;
+        auto first = uniforms.frame_index == 0u;
+        auto t = 1.0f / (uniforms.frame_index + 1.0f);
+        if ((uniforms.aovs & AOV_DEPTH) != 0u) {
+            depths[film_index] = first ? depth : mix(depths[film_index], depth, t);
+        }
+        if ((uniforms.aovs & AOV_NORMAL) != 0u) {
+            aov_normals[film_index] = first ? normal : mix(float3(aov_normals[film_index]), normal, t);
+        }
+        if ((uniforms.aovs & AOV_ALBEDO) != 0u) {
+            albedos[film_index] = first ? albedo : mix(float3(albedos[film_index]), albedo, t);
+        }
+        if ((uniforms.aovs & AOV_PRIMITIVE_ID) != 0u && first) {
+            primitive_ids[film_index] = primitive_id;
+        }
+        if ((uniforms.aovs & AOV_SAMPLE_COUNT) != 0u) {
+            sample_counts[film_index] = (first ? 0u : sample_counts[film_index]) + uniforms.samples_per_pixel;
+        }
+    }
+}
+
+kernel void path_tracing_sample_lights(
+    constant PathTracingUniforms &uniforms [[buffer(0)]],
+    device const RayGeometry *ray_geometries [[buffer(1)]],
+    device const RayPixel *ray_pixels [[buffer(2)]],
+    device const uint32_t &ray_count [[buffer(3)]],
+    device const Intersection *intersections [[buffer(4)]],
+    device const float3 *positions [[buffer(5)]],
+    device const LightData *lights [[buffer(6)]],
+    device RayGeometry *shadow_ray_geometries [[buffer(7)]],
+    device RayThroughput *shadow_ray_throughputs [[buffer(8)]],
+    device RayPixel *shadow_ray_pixels [[buffer(9)]],
+    device const HaltonSamplerDimension *sampler_dimensions [[buffer(10)]],
+    device const float *sampler_table [[buffer(11)]],
+    device const float *sampler_blue_noise [[buffer(12)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    path_tracing_sample_lights_streams<FullRayStreams>(
+        uniforms, ray_geometries, ray_pixels, ray_count, intersections, positions, lights,
+        shadow_ray_geometries, shadow_ray_throughputs, shadow_ray_pixels, sampler_dimensions, sampler_table, sampler_blue_noise, tid);
+}
+
+kernel void path_tracing_trace_radiance(
+    constant PathTracingUniforms &uniforms [[buffer(0)]],
+    device RayGeometry *ray_geometries [[buffer(1)]],
+    device RayThroughput *ray_throughputs [[buffer(2)]],
+    device RayRadiance *ray_radiances [[buffer(3)]],
+    device const RayPixel *ray_pixels [[buffer(4)]],
+    device const uint32_t &ray_count [[buffer(5)]],
+    device const Intersection *intersections [[buffer(6)]],
+    device const RayGeometry *shadow_ray_geometries [[buffer(7)]],
+    device const RayThroughput *shadow_ray_throughputs [[buffer(8)]],
+    device const ShadowIntersection *shadow_intersections [[buffer(9)]],
+    device const float3 *positions [[buffer(10)]],
+    device const float3 *normals [[buffer(11)]],
+    device const uint32_t *material_ids [[buffer(12)]],
+    device const MaterialData *materials [[buffer(13)]],
+    device const HaltonSamplerDimension *sampler_dimensions [[buffer(14)]],
+    device const float *sampler_table [[buffer(15)]],
+    device const float *sampler_blue_noise [[buffer(16)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    path_tracing_trace_radiance_streams<FullRayStreams>(
+        uniforms, ray_geometries, ray_throughputs, ray_radiances, ray_pixels, ray_count, intersections,
+        shadow_ray_geometries, shadow_ray_throughputs, shadow_intersections, positions, normals, material_ids, materials, sampler_dimensions, sampler_table, sampler_blue_noise, tid);
+}
+
+kernel void path_tracing_sample_lights_compact(
+    constant PathTracingUniforms &uniforms [[buffer(0)]],
+    device const RayGeometry *ray_geometries [[buffer(1)]],
+    device const CompactRayPixel *ray_pixels [[buffer(2)]],
+    device const uint32_t &ray_count [[buffer(3)]],
+    device const Intersection *intersections [[buffer(4)]],
+    device const float3 *positions [[buffer(5)]],
+    device const LightData *lights [[buffer(6)]],
+    device RayGeometry *shadow_ray_geometries [[buffer(7)]],
+    device CompactRayThroughput *shadow_ray_throughputs [[buffer(8)]],
+    device CompactRayPixel *shadow_ray_pixels [[buffer(9)]],
+    device const HaltonSamplerDimension *sampler_dimensions [[buffer(10)]],
+    device const float *sampler_table [[buffer(11)]],
+    device const float *sampler_blue_noise [[buffer(12)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    path_tracing_sample_lights_streams<CompactRayStreams>(
+        uniforms, ray_geometries, ray_pixels, ray_count, intersections, positions, lights,
+        shadow_ray_geometries, shadow_ray_throughputs, shadow_ray_pixels, sampler_dimensions, sampler_table, sampler_blue_noise, tid);
+}
+
+kernel void path_tracing_trace_radiance_compact(
+    constant PathTracingUniforms &uniforms [[buffer(0)]],
+    device RayGeometry *ray_geometries [[buffer(1)]],
+    device CompactRayThroughput *ray_throughputs [[buffer(2)]],
+    device CompactRayRadiance *ray_radiances [[buffer(3)]],
+    device const CompactRayPixel *ray_pixels [[buffer(4)]],
+    device const uint32_t &ray_count [[buffer(5)]],
+    device const Intersection *intersections [[buffer(6)]],
+    device const RayGeometry *shadow_ray_geometries [[buffer(7)]],
+    device const CompactRayThroughput *shadow_ray_throughputs [[buffer(8)]],
+    device const ShadowIntersection *shadow_intersections [[buffer(9)]],
+    device const float3 *positions [[buffer(10)]],
+    device const float3 *normals [[buffer(11)]],
+    device const uint32_t *material_ids [[buffer(12)]],
+    device const MaterialData *materials [[buffer(13)]],
+    device const HaltonSamplerDimension *sampler_dimensions [[buffer(14)]],
+    device const float *sampler_table [[buffer(15)]],
+    device const float *sampler_blue_noise [[buffer(16)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    path_tracing_trace_radiance_streams<CompactRayStreams>(
+        uniforms, ray_geometries, ray_throughputs, ray_radiances, ray_pixels, ray_count, intersections,
+        shadow_ray_geometries, shadow_ray_throughputs, shadow_intersections, positions, normals, material_ids, materials, sampler_dimensions, sampler_table, sampler_blue_noise, tid);
+}
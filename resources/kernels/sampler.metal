@@ -0,0 +1,23 @@
+#include "compatibility.h"
+#include "sampling.h"
+
+using namespace luisa;
+using namespace math;
+using namespace metal;
+
+kernel void sampler_generate_samples(
+    constant SamplerGenerateSamplesUniforms &uniforms [[buffer(0)]],
+    device const HaltonSamplerDimension *sampler_dimensions [[buffer(1)]],
+    device const float *sampler_table [[buffer(2)]],
+    device const float *sampler_blue_noise [[buffer(3)]],
+    texture2d<float, access::write> random [[texture(0)]],
+    uint2 tid [[thread_position_in_grid]]) {
+    
+    if (tid.x < uniforms.sampler.frame_size.x && tid.y < uniforms.sampler.frame_size.y * uniforms.sampler.samples_per_pixel) {
+        float4 v{};
+        for (auto i = 0u; i < min(uniforms.dimensions, 4u); i++) {
+            v[i] = sampler_sample(uniforms.sampler, sampler_dimensions, sampler_table, sampler_blue_noise, tid, uniforms.dimension + i);
+        }
+        random.write(v, tid);
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "compatibility.h"
+
+#include <core/sampler.h>
+#include <samplers/halton_sampler.h>
+
+// The samples of every kind of sampler, evaluated on demand by the kernels consuming them through sampler_sample(), see
+// Sampler; included by the kernel sources after the headers of their uniforms.
+
+inline float halton_sample(uint32_t offset, uint32_t dimension, device const luisa::HaltonSamplerDimension *dimensions, device const float *table, uint32_t dimension_count) {
+    if (dimension >= dimension_count) {  // beyond the tables, the bases come round again with the indices hashed by the round
+        offset = luisa::tea<4>(offset, dimension / dimension_count);
+        dimension %= dimension_count;
+    }
+    auto d = dimensions[dimension];
+    auto f = 1.0f;
+    auto r = 0.0f;
+    for (auto i = offset; i != 0u; i /= d.chunk_size) {
+        r = r + f * table[d.table_offset + i % d.chunk_size];
+        f = f * d.inv_chunk_size;
+    }
+    return luisa::math::clamp(r, 0.0f, 1.0f);
+}
+
+// The direction numbers of the first four dimensions, after Joe and Kuo's new-joe-kuo-6.21201 for all but the first, with
+// their bits reversed and interleaved by bit, so the points come out reversed for the Owen scrambling.
+constexpr unsigned int sobol_reversed_directions[32u * luisa::SAMPLER_GROUP_DIMENSIONS] = {
+    0x00000001u, 0x00000001u, 0x00000001u, 0x00000001u, 0x00000002u, 0x00000003u, 0x00000003u, 0x00000003u,
+    0x00000004u, 0x00000005u, 0x00000006u, 0x00000004u, 0x00000008u, 0x0000000fu, 0x00000009u, 0x0000000au,
+    0x00000010u, 0x00000011u, 0x00000017u, 0x0000001fu, 0x00000020u, 0x00000033u, 0x0000003au, 0x0000002eu,
+    0x00000040u, 0x00000055u, 0x00000071u, 0x00000045u, 0x00000080u, 0x000000ffu, 0x000000a3u, 0x000000c9u,
+    0x00000100u, 0x00000101u, 0x00000116u, 0x0000011bu, 0x00000200u, 0x00000303u, 0x00000339u, 0x000002a4u,
+    0x00000400u, 0x00000505u, 0x00000677u, 0x0000079au, 0x00000800u, 0x00000f0fu, 0x000009aau, 0x00000b67u,
+    0x00001000u, 0x00001111u, 0x00001601u, 0x0000101eu, 0x00002000u, 0x00003333u, 0x00003903u, 0x0000302du,
+    0x00004000u, 0x00005555u, 0x00007706u, 0x00004041u, 0x00008000u, 0x0000ffffu, 0x0000aa09u, 0x0000a0c3u,
+    0x00010000u, 0x00010001u, 0x00010117u, 0x0001f104u, 0x00020000u, 0x00030003u, 0x0003033au, 0x0002e28au,
+    0x00040000u, 0x00050005u, 0x00060671u, 0x000457dfu, 0x00080000u, 0x000f000fu, 0x000909a3u, 0x000c9baeu,
+    0x00100000u, 0x00110011u, 0x00171616u, 0x0011a105u, 0x00200000u, 0x00330033u, 0x003a3939u, 0x002a7289u,
+    0x00400000u, 0x00550055u, 0x00717777u, 0x0079e7dbu, 0x00800000u, 0x00ff00ffu, 0x00a3aaaau, 0x00b6dba4u,
+    0x01000000u, 0x01010101u, 0x01170001u, 0x0100011au, 0x02000000u, 0x03030303u, 0x033a0003u, 0x030002a7u,
+    0x04000000u, 0x05050505u, 0x06710006u, 0x0400079eu, 0x08000000u, 0x0f0f0f0fu, 0x09a30009u, 0x0a000b6du,
+    0x10000000u, 0x11111111u, 0x16160017u, 0x1f001001u, 0x20000000u, 0x33333333u, 0x3939003au, 0x2e003003u,
+    0x40000000u, 0x55555555u, 0x77770071u, 0x45004004u, 0x80000000u, 0xffffffffu, 0xaaaa00a3u, 0xc900a00au};
+
+inline uint32_t sobol_reverse_bits(uint32_t x) {
+    x = (x << 16u) | (x >> 16u);
+    x = ((x & 0x00ff00ffu) << 8u) | ((x & 0xff00ff00u) >> 8u);
+    x = ((x & 0x0f0f0f0fu) << 4u) | ((x & 0xf0f0f0f0u) >> 4u);
+    x = ((x & 0x33333333u) << 2u) | ((x & 0xccccccccu) >> 2u);
+    return ((x & 0x55555555u) << 1u) | ((x & 0xaaaaaaaau) >> 1u);
+}
+
+// Wellons' lowbias32 from "Prospecting for Hash Functions", for the seeds of the groups and dimensions
+inline uint32_t sobol_hash(uint32_t x) {
+    x ^= x >> 16u;
+    x *= 0x7feb352du;
+    x ^= x >> 15u;
+    x *= 0x846ca68bu;
+    return x ^ (x >> 16u);
+}
+
+// Laine and Karras' hash with Vegdahl's constants, flipping bits depending on the ones below them only, which is an Owen
+// scramble of the bits reversed
+inline uint32_t sobol_laine_karras_permutation(uint32_t x, uint32_t seed) {
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+inline uint32_t sobol_nested_uniform_scramble(uint32_t x, uint32_t seed) {
+    return sobol_reverse_bits(sobol_laine_karras_permutation(sobol_reverse_bits(x), seed));
+}
+
+inline float sobol_sample(uint32_t pixel_seed, uint32_t index, uint32_t dimension) {
+    auto group = dimension / luisa::SAMPLER_GROUP_DIMENSIONS;
+    auto d = dimension % luisa::SAMPLER_GROUP_DIMENSIONS;
+    auto seed = sobol_hash(pixel_seed ^ sobol_hash(group));
+    index = sobol_nested_uniform_scramble(index, seed);
+    auto x = 0u;
+    for (auto bit = d; index != 0u; index >>= 1u, bit += luisa::SAMPLER_GROUP_DIMENSIONS) {
+        x ^= sobol_reversed_directions[bit] & (0u - (index & 1u));  // without branches, as the scrambled indices have random bits
+    }
+    auto scrambled = sobol_reverse_bits(sobol_laine_karras_permutation(x, sobol_hash(seed + d + 1u)));
+    return static_cast<float>(scrambled >> 8u) * (1.0f / 16777216.0f);
+}
+
+// The given dimension of the sample of tid, in the planes of samples of the frame stacked along y (see
+// Sampler::prepare_for_frame()), as pinned down by the sampler uniforms and tables. With blue noise, all pixels of a tile of
+// the mask take the same sample, toroidally shifted by the mask read at an offset of the dimension along the R2 sequence, after
+// Georgiev and Fajardo's "Blue-noise Dithered Sampling"; neighbouring pixels thus get shifts far apart and errors of opposite
+// signs, while the samples of every pixel stay as well distributed as the sequence.
+inline float sampler_sample(constant luisa::SamplerUniforms &uniforms, device const luisa::HaltonSamplerDimension *dimensions, device const float *table,
+                            device const float *blue_noise, luisa::math::uint2 tid, uint32_t dimension) {
+    auto sample = tid.y / uniforms.frame_size.y;
+    auto pixel = uniforms.frame_origin + luisa::math::uint2(tid.x, tid.y - sample * uniforms.frame_size.y);  // seeded by film pixel, so tiles match the whole frame
+    auto is_blue_noise = uniforms.distribution == luisa::SAMPLER_BLUE_NOISE;
+    auto seed_pixel = is_blue_noise ? pixel >> luisa::SAMPLER_BLUE_NOISE_MASK_SHIFT : pixel;
+    auto seed = luisa::tea<4>(seed_pixel.x, seed_pixel.y);
+    auto index = uniforms.frame_index * uniforms.samples_per_pixel + sample;
+    auto u = uniforms.kind == luisa::SAMPLER_SOBOL ?
+             sobol_sample(seed, index, dimension) :
+             halton_sample(seed + index, dimension, dimensions, table, uniforms.table_dimensions);
+    if (is_blue_noise) {
+        constexpr auto mask = luisa::SAMPLER_BLUE_NOISE_MASK_SIZE - 1u;
+        auto x = (pixel.x + ((dimension * 0xc13fa9a9u) >> (32u - luisa::SAMPLER_BLUE_NOISE_MASK_SHIFT))) & mask;  // 0.7548776662 and
+        auto y = (pixel.y + ((dimension * 0x91e10da5u) >> (32u - luisa::SAMPLER_BLUE_NOISE_MASK_SHIFT))) & mask;  // 0.5698402910 in 0.32
+        u += blue_noise[y * luisa::SAMPLER_BLUE_NOISE_MASK_SIZE + x];
+        u = u < 1.0f ? u : u - 1.0f;
+    }
+    return u;
+}
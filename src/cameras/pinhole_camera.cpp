@@ -6,10 +6,11 @@
 
 namespace luisa {
 
-void PinholeCamera::generate_rays(KernelDispatcher &dispatch, Texture &random_texture, Buffer &ray_buffer, math::uint2 frame_size, float time [[maybe_unused]]) {
+void PinholeCamera::generate_rays(KernelDispatcher &dispatch, Texture &random_texture, RayQueue &ray_queue,
+                                  math::uint2 film_size, Viewport frame, uint32_t samples_per_pixel, float time) {
     
     math::uint2 threadgroup_size{32, 32};
-    auto threadgroups = (frame_size + threadgroup_size - 1u) / threadgroup_size;
+    auto threadgroups = (math::uint2{frame.size.x, frame.size.y * samples_per_pixel} + threadgroup_size - 1u) / threadgroup_size;
     
     PinholeCameraGenerateRaysUniforms uniforms;
     uniforms.position = _position;
@@ -17,13 +18,22 @@ void PinholeCamera::generate_rays(KernelDispatcher &dispatch, Texture &random_te
     uniforms.front = math::normalize(_target - _position);
     uniforms.left = math::normalize(math::cross(_up, uniforms.front));
     uniforms.up = math::normalize(math::cross(uniforms.front, uniforms.left));
-    uniforms.frame_size = frame_size;
+    uniforms.film_size = film_size;
+    uniforms.frame_origin = frame.origin;
+    uniforms.frame_size = frame.size;
+    uniforms.shutter_open = time + _shutter.x;
+    uniforms.shutter_close = time + _shutter.y;
+    uniforms.samples_per_pixel = samples_per_pixel;
     uniforms.near_plane = 0.01f;
-    uniforms.sensor_size = math::tan(uniforms.fov) * uniforms.near_plane * 2.0f * (math::float2(frame_size) / static_cast<float>(frame_size.y));
+    uniforms.sensor_size = math::tan(uniforms.fov) * uniforms.near_plane * 2.0f * (math::float2(film_size) / static_cast<float>(film_size.y));
     
-    dispatch(*_generate_rays_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+    auto &&kernel = ray_queue.encoding() == RayEncoding::FULL ? *_generate_rays_kernel : *_generate_compact_rays_kernel;
+    dispatch(kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
         encoder["uniforms"]->set_bytes(&uniforms, sizeof(PinholeCameraGenerateRaysUniforms));
-        encoder["rays"]->set_buffer(ray_buffer);
+        encoder["ray_geometries"]->set_buffer(ray_queue.geometry_buffer());
+        encoder["ray_throughputs"]->set_buffer(ray_queue.throughput_buffer());
+        encoder["ray_radiances"]->set_buffer(ray_queue.radiance_buffer());
+        encoder["ray_pixels"]->set_buffer(ray_queue.pixel_buffer());
         encoder["random"]->set_texture(random_texture);
     });
 }
@@ -31,6 +41,7 @@ void PinholeCamera::generate_rays(KernelDispatcher &dispatch, Texture &random_te
 void PinholeCamera::initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) {
     Camera::initialize(device, param_set);
     _generate_rays_kernel = device.create_kernel("pinhole_camera_generate_rays");
+    _generate_compact_rays_kernel = device.create_kernel("pinhole_camera_generate_rays_compact");
     if (!_decode_fov(param_set)) {
         LUISA_WARNING("parameter fov not specified, using default value (35.0).");
         _fov = 35.0f;
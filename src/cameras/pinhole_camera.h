@@ -16,7 +16,12 @@ struct alignas(16) PinholeCameraGenerateRaysUniforms {
     math::float2 sensor_size;
     float near_plane;
     float fov;
+    math::uint2 film_size;
+    math::uint2 frame_origin;
     math::uint2 frame_size;
+    float shutter_open;   // time of the frame plus the shutter of the camera
+    float shutter_close;
+    uint32_t samples_per_pixel;
 };
 
 }
@@ -32,6 +37,7 @@ DERIVED_CLASS(PinholeCamera, Camera) {
 
 private:
     std::shared_ptr<Kernel> _generate_rays_kernel;
+    std::shared_ptr<Kernel> _generate_compact_rays_kernel;
 
 protected:
     PROPERTY(float, fov, CoreTypeTag::FLOAT) {
@@ -43,8 +49,9 @@ protected:
 
 public:
     CREATOR("Pinhole") noexcept { return std::make_shared<PinholeCamera>(); }
-    [[nodiscard]] size_t random_number_dimensions() const noexcept override { return 2ul; }
-    void generate_rays(KernelDispatcher &dispatch, Texture &random_texture, Buffer &ray_buffer, math::uint2 frame_size, float time) override;
+    [[nodiscard]] size_t random_number_dimensions() const noexcept override { return motion_blurred() ? 3ul : 2ul; }
+    void generate_rays(KernelDispatcher &dispatch, Texture &random_texture, RayQueue &ray_queue,
+                       math::uint2 film_size, Viewport frame, uint32_t samples_per_pixel, float time) override;
     void initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) override;
 };
 
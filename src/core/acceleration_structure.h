@@ -8,12 +8,33 @@
 
 namespace luisa {
 
+class RayQueue;
+
+enum struct AccelerationStructureBuildMode {
+    SAH,    // slowest to build and fastest to trace, for static geometry
+    LBVH,   // linear BVH sorted along a Morton curve, for geometry rebuilt every frame, e.g. deforming characters
+    TRBVH   // LBVH with its treelets restructured to lower the SAH cost, in between the two above
+};
+
 struct AccelerationStructure : util::Noncopyable {
     virtual ~AccelerationStructure() noexcept = default;
     virtual void trace_any(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, size_t ray_count) = 0;
     virtual void trace_nearest(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, size_t ray_count) = 0;
     virtual void trace_any(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) = 0;
     virtual void trace_nearest(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) = 0;
+    
+    // trace the geometry stream of a structure-of-arrays queue, motion-blurred structures take the time of each ray from its pixel stream
+    virtual void trace_any(KernelDispatcher &dispatch, RayQueue &ray_queue, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) = 0;
+    virtual void trace_nearest(KernelDispatcher &dispatch, RayQueue &ray_queue, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) = 0;
+    
+    // Updates the structure in place after the contents of its input buffers changed with the same topology, e.g. vertices moved
+    // by Buffer::upload(); it is rebuilt instead once its SAH cost exceeds rebuild_cost_ratio times the cost of the last build
+    // (backends without cost estimates always refit), a ratio of zero never rebuilds.
+    virtual void refit(KernelDispatcher &dispatch, float rebuild_cost_ratio) = 0;
+    void refit(KernelDispatcher &dispatch) { refit(dispatch, 0.0f); }
+    
+    // whether the structure is built over instances, and so writes InstanceIntersection rather than Intersection
+    [[nodiscard]] virtual bool instanced() const noexcept { return false; }
 };
 
 }
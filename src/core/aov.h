@@ -0,0 +1,18 @@
+#pragma once
+
+#include "mathematics.h"
+
+namespace luisa {
+
+// Arbitrary output variables a film keeps besides the radiance, each in a film-sized buffer of the given element type and
+// averaged over the samples of a pixel unless told otherwise; films declare them by name, see Film::aovs().
+constexpr auto AOV_DEPTH = 1u << 0u;         // float, distance to the first hit along the camera ray, 0 where it escapes
+constexpr auto AOV_NORMAL = 1u << 1u;        // packed_float3, shading normal at the first hit, facing the camera
+constexpr auto AOV_ALBEDO = 1u << 2u;        // packed_float3, linear sRGB albedo at the first hit
+constexpr auto AOV_PRIMITIVE_ID = 1u << 3u;  // uint32_t, triangle first hit by the first sample, AOV_NO_PRIMITIVE if none
+constexpr auto AOV_SAMPLE_COUNT = 1u << 4u;  // uint32_t, samples accumulated so far
+constexpr auto AOV_COUNT = 5u;
+
+constexpr auto AOV_NO_PRIMITIVE = 0xffffffffu;
+
+}
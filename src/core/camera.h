@@ -5,6 +5,8 @@
 #pragma once
 
 #include "film.h"
+#include "ray_queue.h"
+#include "viewport.h"
 
 namespace luisa {
 
@@ -36,6 +38,15 @@ protected:
         }
         _up = {params[0], params[1], params[2]};
     }
+    
+    // offsets from the time of the frame over which the rays are spread, for motion blur (see
+    // Device::create_motion_instance_acceleration_structure()); all rays are at the time of the frame when they are equal
+    PROPERTY(math::float2, shutter, CoreTypeTag::FLOAT) {
+        if (params.size() != 2 || params[0] > params[1]) {
+            THROW_CAMERA_ERROR("expected exactly two ordered float values as camera shutter open and close.");
+        }
+        _shutter = {params[0], params[1]};
+    }
 
 public:
     void initialize(Device &device [[maybe_unused]], const CoreTypeInitializerParameterSet &param_set) override {
@@ -45,13 +56,28 @@ public:
             LUISA_WARNING("camera upside direction not specified, using default value (0.0, 1.0, 0.0).");
             _up = {0.0f, 1.0f, 0.0f};
         }
+        if (!_decode_shutter(param_set)) { _shutter = {0.0f, 0.0f}; }
     }
     
+    [[nodiscard]] math::float2 shutter() const noexcept { return _shutter; }
+    [[nodiscard]] bool motion_blurred() const noexcept { return _shutter.x < _shutter.y; }
+    
     [[nodiscard]] virtual size_t random_number_dimensions() const noexcept = 0;
-    virtual void generate_rays(KernelDispatcher &dispatch, Texture &random_texture, Buffer &ray_buffer, math::uint2 frame_size, float time) = 0;
+    // writes the s-th ray of pixel frame.origin + (x, y) of a film of film_size pixels at index (y + s * frame.size.y) * frame.size.x + x
+    // of every stream of ray_queue, with the pixel coordinates of the rays relative to frame.origin and moved down by s * frame.size.y
+    // as well, the samples_per_pixel planes of samples being stacked along y like those of the sampler; the first two channels of
+    // random_texture offset the samples from the pixel corners, out of [0, 1) when warped by Filter::warp_pixel_samples(); with
+    // motion blur the third places each ray within the shutter, at time + mix(shutter().x, shutter().y, channel), otherwise rays
+    // are at time
+    virtual void generate_rays(KernelDispatcher &dispatch, Texture &random_texture, RayQueue &ray_queue,
+                               math::uint2 film_size, Viewport frame, uint32_t samples_per_pixel, float time) = 0;
+    
+    void generate_rays(KernelDispatcher &dispatch, Texture &random_texture, RayQueue &ray_queue, math::uint2 frame_size, float time) {
+        generate_rays(dispatch, random_texture, ray_queue, frame_size, Viewport{math::uint2{0u, 0u}, frame_size}, 1u, time);
+    }
     
-    void generate_rays(KernelDispatcher &dispatch, Texture &random_texture, Buffer &ray_buffer, math::uint2 frame_size) {
-        generate_rays(dispatch, random_texture, ray_buffer, frame_size, 0.0f);
+    void generate_rays(KernelDispatcher &dispatch, Texture &random_texture, RayQueue &ray_queue, math::uint2 frame_size) {
+        generate_rays(dispatch, random_texture, ray_queue, frame_size, 0.0f);
     }
 };
 
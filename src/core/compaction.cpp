@@ -0,0 +1,123 @@
+#include "compaction.h"
+
+namespace luisa {
+
+namespace {
+
+constexpr auto COMPACTION_THREADGROUP_SIZE = 256u;
+
+[[nodiscard]] math::uint2 compaction_threadgroups(uint32_t thread_count) noexcept {
+    return {std::max((thread_count + COMPACTION_THREADGROUP_SIZE - 1u) / COMPACTION_THREADGROUP_SIZE, 1u), 1u};
+}
+
+}
+
+Compaction::Compaction(Device &device, uint32_t capacity)
+    : _scan_size{1u} {
+    while (_scan_size < capacity) { _scan_size *= 2u; }
+    _count_rays_kernel = device.create_kernel("compaction_count_rays");
+    _scan_up_kernel = device.create_kernel("compaction_scan_up");
+    _scan_total_kernel = device.create_kernel("compaction_scan_total");
+    _scan_down_kernel = device.create_kernel("compaction_scan_down");
+    _scatter_rays_kernel = device.create_kernel("compaction_scatter_rays");
+    _count_ray_queue_kernel = device.create_kernel("compaction_count_ray_queue");
+    _scatter_ray_queue_kernel = device.create_kernel("compaction_scatter_ray_queue");
+    _scatter_compact_ray_queue_kernel = device.create_kernel("compaction_scatter_ray_queue_compact");
+    _offset_buffer = device.create_buffer(sizeof(uint32_t) * _scan_size, BufferStorageTag::DEVICE_PRIVATE);
+}
+
+void Compaction::_scan(KernelDispatcher &dispatch, CompactionUniforms uniforms, Buffer &total_count_buffer, size_t total_count_buffer_offset) {
+    
+    math::uint2 threadgroup_size{COMPACTION_THREADGROUP_SIZE, 1u};
+    
+    for (uniforms.stride = 1u; uniforms.stride < _scan_size; uniforms.stride *= 2u) {
+        dispatch(*_scan_up_kernel, compaction_threadgroups(_scan_size / (uniforms.stride * 2u)), threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+            encoder["uniforms"]->set_bytes(&uniforms, sizeof(CompactionUniforms));
+            encoder["offsets"]->set_buffer(*_offset_buffer);
+        });
+    }
+    
+    dispatch(*_scan_total_kernel, math::uint2{1u, 1u}, math::uint2{1u, 1u}, [&](KernelArgumentEncoder &encoder) {
+        encoder["uniforms"]->set_bytes(&uniforms, sizeof(CompactionUniforms));
+        encoder["offsets"]->set_buffer(*_offset_buffer);
+        encoder["total_count"]->set_buffer(total_count_buffer, total_count_buffer_offset);
+    });
+    
+    for (uniforms.stride = _scan_size / 2u; uniforms.stride != 0u; uniforms.stride /= 2u) {
+        dispatch(*_scan_down_kernel, compaction_threadgroups(_scan_size / (uniforms.stride * 2u)), threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+            encoder["uniforms"]->set_bytes(&uniforms, sizeof(CompactionUniforms));
+            encoder["offsets"]->set_buffer(*_offset_buffer);
+        });
+    }
+}
+
+void Compaction::compact_rays(KernelDispatcher &dispatch, math::uint2 frame_size,
+                              Buffer &ray_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset,
+                              Buffer &output_ray_buffer, Buffer &output_ray_count_buffer, size_t output_ray_count_buffer_offset,
+                              Buffer &gather_ray_buffer) {
+    
+    CompactionUniforms uniforms{};
+    uniforms.frame_size = frame_size;
+    uniforms.scan_size = _scan_size;
+    
+    math::uint2 threadgroup_size{COMPACTION_THREADGROUP_SIZE, 1u};
+    auto threadgroups = compaction_threadgroups(_scan_size);
+    
+    dispatch(*_count_rays_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+        encoder["uniforms"]->set_bytes(&uniforms, sizeof(CompactionUniforms));
+        encoder["rays"]->set_buffer(ray_buffer);
+        encoder["ray_count"]->set_buffer(ray_count_buffer, ray_count_buffer_offset);
+        encoder["offsets"]->set_buffer(*_offset_buffer);
+    });
+    
+    _scan(dispatch, uniforms, output_ray_count_buffer, output_ray_count_buffer_offset);
+    
+    dispatch(*_scatter_rays_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+        encoder["uniforms"]->set_bytes(&uniforms, sizeof(CompactionUniforms));
+        encoder["rays"]->set_buffer(ray_buffer);
+        encoder["ray_count"]->set_buffer(ray_count_buffer, ray_count_buffer_offset);
+        encoder["offsets"]->set_buffer(*_offset_buffer);
+        encoder["output_rays"]->set_buffer(output_ray_buffer);
+        encoder["gather_rays"]->set_buffer(gather_ray_buffer);
+    });
+}
+
+void Compaction::compact_ray_queue(KernelDispatcher &dispatch, math::uint2 frame_size,
+                                   RayQueue &ray_queue, Buffer &ray_count_buffer, size_t ray_count_buffer_offset,
+                                   RayQueue &output_ray_queue, Buffer &output_ray_count_buffer, size_t output_ray_count_buffer_offset,
+                                   Buffer &gather_ray_buffer) {
+    
+    CompactionUniforms uniforms{};
+    uniforms.frame_size = frame_size;
+    uniforms.scan_size = _scan_size;
+    
+    math::uint2 threadgroup_size{COMPACTION_THREADGROUP_SIZE, 1u};
+    auto threadgroups = compaction_threadgroups(_scan_size);
+    
+    dispatch(*_count_ray_queue_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+        encoder["uniforms"]->set_bytes(&uniforms, sizeof(CompactionUniforms));
+        encoder["ray_geometries"]->set_buffer(ray_queue.geometry_buffer());
+        encoder["ray_count"]->set_buffer(ray_count_buffer, ray_count_buffer_offset);
+        encoder["offsets"]->set_buffer(*_offset_buffer);
+    });
+    
+    _scan(dispatch, uniforms, output_ray_count_buffer, output_ray_count_buffer_offset);
+    
+    auto &&scatter_kernel = ray_queue.encoding() == RayEncoding::FULL ? *_scatter_ray_queue_kernel : *_scatter_compact_ray_queue_kernel;
+    dispatch(scatter_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+        encoder["uniforms"]->set_bytes(&uniforms, sizeof(CompactionUniforms));
+        encoder["ray_geometries"]->set_buffer(ray_queue.geometry_buffer());
+        encoder["ray_throughputs"]->set_buffer(ray_queue.throughput_buffer());
+        encoder["ray_radiances"]->set_buffer(ray_queue.radiance_buffer());
+        encoder["ray_pixels"]->set_buffer(ray_queue.pixel_buffer());
+        encoder["ray_count"]->set_buffer(ray_count_buffer, ray_count_buffer_offset);
+        encoder["offsets"]->set_buffer(*_offset_buffer);
+        encoder["output_ray_geometries"]->set_buffer(output_ray_queue.geometry_buffer());
+        encoder["output_ray_throughputs"]->set_buffer(output_ray_queue.throughput_buffer());
+        encoder["output_ray_radiances"]->set_buffer(output_ray_queue.radiance_buffer());
+        encoder["output_ray_pixels"]->set_buffer(output_ray_queue.pixel_buffer());
+        encoder["gather_rays"]->set_buffer(gather_ray_buffer);
+    });
+}
+
+}
\ No newline at end of file
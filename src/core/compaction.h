@@ -0,0 +1,71 @@
+#pragma once
+
+#include "mathematics.h"
+
+namespace luisa {
+
+struct alignas(16) CompactionUniforms {
+    math::uint2 frame_size;
+    uint32_t scan_size;  // the capacity rounded up to a power of two
+    uint32_t stride;     // between the partial sums combined by a scan pass
+};
+
+}
+
+#ifndef DEVICE_COMPATIBLE
+
+#include <util/noncopyable.h>
+#include "device.h"
+#include "ray_queue.h"
+
+namespace luisa {
+
+// Stream compaction without a shared counter, one thread per element: every thread flags whether its element is selected,
+// an exclusive scan over the flags turns them into output offsets in 2 * log2(capacity) passes, and every thread then
+// moves its element to its offset. The selected elements keep their relative order, so the output is the same from one
+// run to the next.
+class Compaction : util::Noncopyable {
+
+private:
+    std::shared_ptr<Kernel> _count_rays_kernel;
+    std::shared_ptr<Kernel> _scan_up_kernel;
+    std::shared_ptr<Kernel> _scan_total_kernel;
+    std::shared_ptr<Kernel> _scan_down_kernel;
+    std::shared_ptr<Kernel> _scatter_rays_kernel;
+    std::shared_ptr<Kernel> _count_ray_queue_kernel;
+    std::shared_ptr<Kernel> _scatter_ray_queue_kernel;
+    std::shared_ptr<Kernel> _scatter_compact_ray_queue_kernel;
+    std::shared_ptr<Buffer> _offset_buffer;
+    uint32_t _scan_size;
+    
+    // turns the flags in the offset buffer into exclusive offsets, and writes their total into the given count
+    void _scan(KernelDispatcher &dispatch, CompactionUniforms uniforms, Buffer &total_count_buffer, size_t total_count_buffer_offset);
+
+public:
+    // capacity is the largest number of elements ever compacted at once, e.g. one ray per pixel
+    Compaction(Device &device, uint32_t capacity);
+    
+    // Packs the rays still alive (max_distance > 0) among the first ray_count ones of ray_buffer into output_ray_buffer
+    // and writes their number to output_ray_count_buffer; the radiance of the others is written to gather_ray_buffer by pixel.
+    // Both counts are single uint32_t values at the given byte offsets, so one buffer can hold the counts of every bounce.
+    void compact_rays(KernelDispatcher &dispatch, math::uint2 frame_size,
+                      Buffer &ray_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset,
+                      Buffer &output_ray_buffer, Buffer &output_ray_count_buffer, size_t output_ray_count_buffer_offset,
+                      Buffer &gather_ray_buffer);
+    
+    void compact_rays(KernelDispatcher &dispatch, math::uint2 frame_size, Buffer &ray_buffer, Buffer &ray_count_buffer,
+                      Buffer &output_ray_buffer, Buffer &output_ray_count_buffer, Buffer &gather_ray_buffer) {
+        compact_rays(dispatch, frame_size, ray_buffer, ray_count_buffer, 0ul, output_ray_buffer, output_ray_count_buffer, 0ul, gather_ray_buffer);
+    }
+    
+    // the same for structure-of-arrays queues, whose streams are moved together; both queues have the same encoding,
+    // which gather_ray_buffer also follows, i.e. it holds CompactGatherRay for compact queues
+    void compact_ray_queue(KernelDispatcher &dispatch, math::uint2 frame_size,
+                           RayQueue &ray_queue, Buffer &ray_count_buffer, size_t ray_count_buffer_offset,
+                           RayQueue &output_ray_queue, Buffer &output_ray_count_buffer, size_t output_ray_count_buffer_offset,
+                           Buffer &gather_ray_buffer);
+};
+
+}
+
+#endif
@@ -34,6 +34,7 @@ enum struct CoreTypeTag : uint32_t {
     FILTER = 8,
     SAVER = 9,
     TASK = 10,
+    DENOISER = 11,
     
     // only for counting
         NON_VALUE_TYPE_COUNT,
@@ -101,6 +102,7 @@ MAKE_INFO_FOR_NON_VALUE_CORE_TYPE_TAG(CoreTypeTag::FILM, Film);
 MAKE_INFO_FOR_NON_VALUE_CORE_TYPE_TAG(CoreTypeTag::FILTER, Filter);
 MAKE_INFO_FOR_NON_VALUE_CORE_TYPE_TAG(CoreTypeTag::SAVER, Saver);
 MAKE_INFO_FOR_NON_VALUE_CORE_TYPE_TAG(CoreTypeTag::TASK, Task);
+MAKE_INFO_FOR_NON_VALUE_CORE_TYPE_TAG(CoreTypeTag::DENOISER, Denoiser);
 
 #undef MAKE_INFO_FOR_NON_VALUE_CORE_TYPE_TAG
 
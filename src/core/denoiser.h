@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include "type_reflection.h"
+#include "mathematics.h"
+
+namespace luisa {
+
+LUISA_MAKE_ERROR_TYPE(DenoiserError);
+
+#define THROW_DENOISER_ERROR(...)  \
+    LUISA_THROW_ERROR(DenoiserError, __VA_ARGS__)
+
+// Host passes over the converted colours of a film, guided by its normal and albedo AOVs (see Film::denoise()).
+CORE_CLASS(Denoiser) {
+
+private:
+    double _last_milliseconds{0.0};
+
+protected:
+    virtual void _denoise(math::float4 *colors, const math::packed_float3 *normals, const math::packed_float3 *albedos, math::uint2 size) = 0;
+
+public:
+    void initialize(Device &device [[maybe_unused]], const CoreTypeInitializerParameterSet &param_set [[maybe_unused]]) override {}
+    
+    // denoises the size.x * size.y pixels of colors in place, the alpha channel left as is
+    void denoise(math::float4 *colors, const math::packed_float3 *normals, const math::packed_float3 *albedos, math::uint2 size) {
+        auto t0 = std::chrono::steady_clock::now();
+        _denoise(colors, normals, albedos, size);
+        _last_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+    
+    // the time taken by the last denoise(), so its cost can be weighed against more samples
+    [[nodiscard]] double last_milliseconds() const noexcept { return _last_milliseconds; }
+};
+
+}
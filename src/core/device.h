@@ -4,11 +4,13 @@
 
 #pragma once
 
+#include <cassert>
 #include <memory>
 #include <filesystem>
 #include <unordered_map>
 #include <functional>
 #include <utility>
+#include <vector>
 #include <iostream>
 
 #include <util/exception.h>
@@ -54,7 +56,27 @@ public:
     [[nodiscard]] virtual std::shared_ptr<Kernel> create_kernel(std::string_view function_name) = 0;
     [[nodiscard]] virtual std::shared_ptr<Texture> create_texture(math::uint2 size, TextureFormatTag format_tag, TextureAccessTag access_tag) = 0;
     [[nodiscard]] virtual std::shared_ptr<Buffer> create_buffer(size_t capacity, BufferStorageTag storage) = 0;
-    [[nodiscard]] virtual std::shared_ptr<AccelerationStructure> create_acceleration_structure(Buffer &position_buffer, size_t stride, size_t triangle_count) = 0;
+    [[nodiscard]] virtual std::shared_ptr<AccelerationStructure> create_acceleration_structure(
+        Buffer &position_buffer, size_t stride, size_t triangle_count, AccelerationStructureBuildMode build_mode) = 0;
+    
+    [[nodiscard]] std::shared_ptr<AccelerationStructure> create_acceleration_structure(Buffer &position_buffer, size_t stride, size_t triangle_count) {
+        return create_acceleration_structure(position_buffer, stride, triangle_count, AccelerationStructureBuildMode::SAH);
+    }
+    
+    // Two-level structure over instances of meshes created by create_acceleration_structure(), which are shared instead of copied:
+    // instance i places meshes[mesh_index_buffer[i]] (uint32_t) with the object-to-world transform_buffer[i] (math::float4x4).
+    [[nodiscard]] virtual std::shared_ptr<AccelerationStructure> create_instance_acceleration_structure(
+        const std::vector<std::shared_ptr<AccelerationStructure>> &meshes, Buffer &mesh_index_buffer, Buffer &transform_buffer, size_t instance_count) = 0;
+    
+    // Same as above for instances moving during the shutter interval: transform_buffer holds keyframe_count transforms per instance,
+    // evenly spaced over [shutter_open, shutter_close] (see Transform::keyframes()), and rays are traced against the instances at their time.
+    [[nodiscard]] virtual std::shared_ptr<AccelerationStructure> create_motion_instance_acceleration_structure(
+        const std::vector<std::shared_ptr<AccelerationStructure>> &meshes, Buffer &mesh_index_buffer, Buffer &transform_buffer, size_t instance_count,
+        uint32_t keyframe_count, float shutter_open, float shutter_close) = 0;
+    
+    void refit_acceleration_structure(AccelerationStructure &structure, float rebuild_cost_ratio = 0.0f) {
+        launch([&structure, rebuild_cost_ratio](KernelDispatcher &dispatch) { structure.refit(dispatch, rebuild_cost_ratio); });
+    }
     
     virtual void launch(std::function<void(KernelDispatcher &)> dispatch) = 0;
     virtual void launch_async(std::function<void(KernelDispatcher &)> dispatch, std::function<void()> callback) = 0;
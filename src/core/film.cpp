@@ -0,0 +1,54 @@
+#include "film.h"
+
+namespace luisa {
+
+namespace {
+
+constexpr size_t AOV_ELEMENT_SIZES[AOV_COUNT] = {sizeof(float), sizeof(math::packed_float3), sizeof(math::packed_float3), sizeof(uint32_t), sizeof(uint32_t)};
+
+[[nodiscard]] uint32_t aov_index(uint32_t aov) {
+    for (auto i = 0u; i < AOV_COUNT; i++) {
+        if (aov == (1u << i)) { return i; }
+    }
+    THROW_FILM_ERROR("invalid AOV flag ", aov, ", expected exactly one of those in aov.h.");
+}
+
+}
+
+void Film::initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) {
+    if (!_decode_size(param_set)) {
+        LUISA_WARNING("film size not specified, using default value (1280x720).");
+        _size = {1280u, 720u};
+    }
+    if (!_decode_aovs(param_set)) { _aovs = 0u; }
+    if (_decode_denoiser(param_set)) { _aovs |= AOV_NORMAL | AOV_ALBEDO; }
+    for (auto i = 0u; i < AOV_COUNT; i++) {
+        if (has_aov(1u << i)) {
+            _aov_buffers[i] = device.create_buffer(AOV_ELEMENT_SIZES[i] * _size.x * _size.y, BufferStorageTag::MANAGED);
+        }
+    }
+}
+
+void Film::synchronize_aovs(KernelDispatcher &dispatch) {
+    for (auto &&buffer : _aov_buffers) {
+        if (buffer != nullptr) { buffer->synchronize(dispatch); }
+    }
+}
+
+void Film::denoise(Buffer &color_buffer) {
+    if (_denoiser == nullptr) { return; }
+    if (color_buffer.storage() != BufferStorageTag::MANAGED || color_buffer.capacity() < sizeof(math::float4) * _size.x * _size.y) {
+        THROW_FILM_ERROR("expected a managed buffer of ", _size.x, "x", _size.y, " RGBA32F pixels to denoise.");
+    }
+    _denoiser->denoise(static_cast<math::float4 *>(color_buffer.data()),
+                       static_cast<const math::packed_float3 *>(aov_buffer(AOV_NORMAL).data()),
+                       static_cast<const math::packed_float3 *>(aov_buffer(AOV_ALBEDO).data()), _size);
+}
+
+Buffer &Film::aov_buffer(uint32_t aov) const {
+    auto &&buffer = _aov_buffers[aov_index(aov)];
+    if (buffer == nullptr) { THROW_FILM_ERROR("AOV ", aov, " not declared by the film."); }
+    return *buffer;
+}
+
+}
@@ -7,6 +7,8 @@
 #include "device.h"
 #include "type_reflection.h"
 #include "mathematics.h"
+#include "aov.h"
+#include "denoiser.h"
 
 namespace luisa {
 
@@ -17,6 +19,9 @@ LUISA_MAKE_ERROR_TYPE(FilmError);
 
 CORE_CLASS(Film) {
 
+private:
+    std::shared_ptr<Buffer> _aov_buffers[AOV_COUNT];  // by the index of the flag bit, only the declared ones allocated
+
 protected:
     PROPERTY(math::uint2, size, CoreTypeTag::FLOAT) {
         if (params.size() != 2) {
@@ -24,18 +29,50 @@ protected:
         }
         _size = {params[0], params[1]};
     }
-
-public:
-    void initialize(Device &device [[maybe_unused]], const CoreTypeInitializerParameterSet &param_set) override {
-        if (!_decode_size(param_set)) {
-            LUISA_WARNING("film size not specified, using default value (1280x720).");
-            _size = {1280u, 720u};
+    
+    // any of "DEPTH", "NORMAL", "ALBEDO", "PRIMITIVE_ID" and "SAMPLE_COUNT", see aov.h
+    PROPERTY(uint32_t, aovs, CoreTypeTag::STRING) {
+        _aovs = 0u;
+        for (auto &&name : params) {
+            if (name == "DEPTH") {
+                _aovs |= AOV_DEPTH;
+            } else if (name == "NORMAL") {
+                _aovs |= AOV_NORMAL;
+            } else if (name == "ALBEDO") {
+                _aovs |= AOV_ALBEDO;
+            } else if (name == "PRIMITIVE_ID") {
+                _aovs |= AOV_PRIMITIVE_ID;
+            } else if (name == "SAMPLE_COUNT") {
+                _aovs |= AOV_SAMPLE_COUNT;
+            } else {
+                THROW_FILM_ERROR("unknown film AOV \"", name, "\", expected \"DEPTH\", \"NORMAL\", \"ALBEDO\", \"PRIMITIVE_ID\" or \"SAMPLE_COUNT\".");
+            }
         }
     }
     
+    // run by denoise(), the film keeping the normal and albedo AOVs it is guided by
+    PROPERTY(std::shared_ptr<Denoiser>, denoiser, CoreTypeTag::DENOISER) {
+        _denoiser = params.front();
+    }
+
+public:
+    void initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) override;
+    
     virtual void convert_colorspace(KernelDispatcher &dispatcher, Texture &result_texture) = 0;
     
+    // The AOVs are written in place by the integrator into MANAGED buffers, and read through aov_buffer(aov).data() once
+    // synchronize_aovs() has been dispatched and the dispatch has completed, without any copy on the host.
+    void synchronize_aovs(KernelDispatcher &dispatch);
+    [[nodiscard]] Buffer &aov_buffer(uint32_t aov) const;
+    
+    // Denoises the film-sized MANAGED color_buffer of RGBA32F pixels on the host, typically the result texture copied after
+    // convert_colorspace(), once the copy and synchronize_aovs() have completed; nothing is done without a denoiser.
+    void denoise(Buffer &color_buffer);
+    
     [[nodiscard]] math::uint2 size() const noexcept { return _size; }
+    [[nodiscard]] uint32_t aovs() const noexcept { return _aovs; }
+    [[nodiscard]] bool has_aov(uint32_t aov) const noexcept { return (_aovs & aov) != 0u; }
+    [[nodiscard]] Denoiser *denoiser() const noexcept { return _denoiser.get(); }
 };
 
 }
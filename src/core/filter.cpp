@@ -0,0 +1,147 @@
+#include <array>
+#include <vector>
+#include "filter.h"
+
+namespace luisa {
+
+void Filter::initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) {
+    if (!_decode_radius(param_set)) {
+        LUISA_WARNING("filter radius not specified, using default value (1.0).");
+        _radius = 1.0f;
+    }
+    if (!_decode_mode(param_set)) { _mode = FilterMode::GATHER; }
+    if (!_decode_accumulation(param_set)) { _accumulation = FilterAccumulation::AVERAGE; }
+    if (_mode == FilterMode::SPLAT && pixel_radius() > FILTER_MAX_PIXEL_RADIUS) {
+        THROW_FILTER_ERROR("filter radius ", _radius, " too large to splat, at most ", FILTER_MAX_PIXEL_RADIUS, " pixels are supported.");
+    }
+    _device = &device;
+    _apply_kernel = device.create_kernel("filter_apply");
+    _apply_compact_kernel = device.create_kernel("filter_apply_compact");
+    _accumulate_kernel = device.create_kernel("filter_accumulate");
+    _accumulate_compact_kernel = device.create_kernel("filter_accumulate_compact");
+    _splat_kernel = device.create_kernel("filter_splat");
+    _splat_compact_kernel = device.create_kernel("filter_splat_compact");
+    _splat_merge_kernel = device.create_kernel("filter_splat_merge");
+    _warp_pixel_samples_kernel = device.create_kernel("filter_warp_pixel_samples");
+}
+
+void Filter::_prepare_table() {
+    
+    // tabulated on first use, once the parameters of the derived filter have been decoded
+    if (_table_buffer != nullptr) { return; }
+    
+    std::array<float, FILTER_WEIGHT_TABLE_SIZE> table{};
+    auto step = 1.0f / static_cast<float>(FILTER_WEIGHT_TABLE_SIZE - 1u);
+    if (_mode != FilterMode::IMPORTANCE) {
+        for (auto i = 0u; i < FILTER_WEIGHT_TABLE_SIZE; i++) {
+            table[i] = _weight(_radius * static_cast<float>(i) * step);
+        }
+    } else {
+        
+        // the cumulative distribution of the positive part of the weight over a finer grid, by the trapezoidal rule
+        constexpr auto cdf_size = 16u * FILTER_WEIGHT_TABLE_SIZE;
+        std::vector<float> cdf(cdf_size, 0.0f);
+        auto cdf_step = 1.0f / static_cast<float>(cdf_size - 1u);
+        auto prev_weight = std::max(_weight(0.0f), 0.0f);
+        for (auto i = 1u; i < cdf_size; i++) {
+            auto weight = std::max(_weight(_radius * static_cast<float>(i) * cdf_step), 0.0f);
+            cdf[i] = cdf[i - 1u] + 0.5f * (prev_weight + weight);
+            prev_weight = weight;
+        }
+        if (cdf.back() <= 0.0f) { THROW_FILTER_ERROR("filter has no positive weight to importance sample."); }
+        
+        // inverted at evenly spaced probabilities, giving offsets in units of the radius
+        auto segment = 0u;
+        for (auto i = 0u; i < FILTER_WEIGHT_TABLE_SIZE; i++) {
+            auto target = static_cast<float>(i) * step * cdf.back();
+            while (segment + 2u < cdf_size && cdf[segment + 1u] < target) { segment++; }
+            auto width = cdf[segment + 1u] - cdf[segment];
+            auto t = width > 0.0f ? std::clamp((target - cdf[segment]) / width, 0.0f, 1.0f) : 0.0f;
+            table[i] = (static_cast<float>(segment) + t) * cdf_step;
+        }
+    }
+    _table_buffer = _device->create_buffer(sizeof(table), BufferStorageTag::MANAGED);
+    _table_buffer->upload(table.data(), sizeof(table));
+}
+
+void Filter::warp_pixel_samples(KernelDispatcher &dispatch, Texture &random_texture, math::uint2 frame_size) {
+    
+    if (_mode != FilterMode::IMPORTANCE) { return; }
+    _prepare_table();
+    
+    math::uint2 threadgroup_size{32, 32};
+    auto threadgroups = (frame_size + threadgroup_size - 1u) / threadgroup_size;
+    
+    FilterWarpPixelSamplesUniforms uniforms{frame_size, _radius};
+    
+    dispatch(*_warp_pixel_samples_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+        encoder["uniforms"]->set_bytes(&uniforms, sizeof(FilterWarpPixelSamplesUniforms));
+        encoder["inverse_cdf"]->set_buffer(*_table_buffer);
+        encoder["random"]->set_texture(random_texture);
+    });
+}
+
+void Filter::apply(KernelDispatcher &dispatch, Buffer &gather_ray_buffer, RayEncoding encoding, Texture &result_texture,
+                   Viewport frame, Viewport tile, uint32_t samples_per_pixel, uint32_t frame_index) {
+    
+    math::uint2 threadgroup_size{32, 32};
+    auto threadgroups = (tile.size + threadgroup_size - 1u) / threadgroup_size;
+    
+    auto compensated = _accumulation == FilterAccumulation::COMPENSATED;
+    FilterApplyUniforms uniforms{frame.size, tile.origin - frame.origin, tile.origin, tile.size,
+                                 frame_index, pixel_radius(), 1.0f / _radius, samples_per_pixel, compensated ? 1u : 0u};
+    
+    // the kernels leave the compensation untouched when averaging, so the result stands in for it there
+    if (compensated && (_compensation_texture == nullptr || _compensation_texture->size() != result_texture.size())) {
+        _compensation_texture = _device->create_texture(result_texture.size(), TextureFormatTag::RGBA32F, TextureAccessTag::READ_WRITE);
+    }
+    auto &&compensation_texture = compensated ? *_compensation_texture : result_texture;
+    
+    // the samples of the importance mode already follow the filter, so every pixel takes its own
+    if (_mode == FilterMode::IMPORTANCE) {
+        dispatch(encoding == RayEncoding::FULL ? *_accumulate_kernel : *_accumulate_compact_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+            encoder["uniforms"]->set_bytes(&uniforms, sizeof(FilterApplyUniforms));
+            encoder["rays"]->set_buffer(gather_ray_buffer);
+            encoder["result"]->set_texture(result_texture);
+            encoder["compensation"]->set_texture(compensation_texture);
+        });
+        return;
+    }
+    
+    _prepare_table();
+    if (_mode == FilterMode::SPLAT) {
+        
+        auto block_count = (frame.size + FILTER_SPLAT_BLOCK_SIZE - 1u) / FILTER_SPLAT_BLOCK_SIZE;
+        auto block_width = FILTER_SPLAT_BLOCK_SIZE + 2u * pixel_radius();
+        auto accumulator_size = sizeof(math::float4) * block_width * block_width * block_count.x * block_count.y;
+        if (_accumulator_buffer == nullptr || _accumulator_buffer->capacity() < accumulator_size) {
+            _accumulator_buffer = _device->create_buffer(accumulator_size, BufferStorageTag::DEVICE_PRIVATE);
+        }
+        
+        math::uint2 block_threadgroup_size{8, 8};
+        dispatch(encoding == RayEncoding::FULL ? *_splat_kernel : *_splat_compact_kernel,
+                 (block_count + block_threadgroup_size - 1u) / block_threadgroup_size, block_threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+            encoder["uniforms"]->set_bytes(&uniforms, sizeof(FilterApplyUniforms));
+            encoder["rays"]->set_buffer(gather_ray_buffer);
+            encoder["weights"]->set_buffer(*_table_buffer);
+            encoder["accumulators"]->set_buffer(*_accumulator_buffer);
+        });
+        dispatch(*_splat_merge_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+            encoder["uniforms"]->set_bytes(&uniforms, sizeof(FilterApplyUniforms));
+            encoder["accumulators"]->set_buffer(*_accumulator_buffer);
+            encoder["result"]->set_texture(result_texture);
+            encoder["compensation"]->set_texture(compensation_texture);
+        });
+        return;
+    }
+    
+    dispatch(encoding == RayEncoding::FULL ? *_apply_kernel : *_apply_compact_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+        encoder["uniforms"]->set_bytes(&uniforms, sizeof(FilterApplyUniforms));
+        encoder["rays"]->set_buffer(gather_ray_buffer);
+        encoder["weights"]->set_buffer(*_table_buffer);
+        encoder["result"]->set_texture(result_texture);
+        encoder["compensation"]->set_texture(compensation_texture);
+    });
+}
+
+}
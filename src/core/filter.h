@@ -4,10 +4,41 @@
 
 #pragma once
 
+#include "mathematics.h"
+
+namespace luisa {
+
+constexpr auto FILTER_WEIGHT_TABLE_SIZE = 256u;  // samples of the 1D weight over [0, radius], the last one at the radius
+constexpr auto FILTER_SPLAT_BLOCK_SIZE = 16u;    // pixels on each side of the blocks splatted by one thread
+constexpr auto FILTER_MAX_PIXEL_RADIUS = 8u;     // of splatting, so that a pixel gathers from up to four accumulators
+
+struct alignas(16) FilterApplyUniforms {
+    math::uint2 frame_size;
+    math::uint2 tile_offset;  // of the tile within the frame
+    math::uint2 tile_origin;  // of the tile within the film
+    math::uint2 tile_size;
+    uint32_t frame_index;
+    uint32_t pixel_radius;
+    float inv_radius;
+    uint32_t samples_per_pixel;
+    uint32_t compensated;  // see FilterAccumulation
+};
+
+struct alignas(16) FilterWarpPixelSamplesUniforms {
+    math::uint2 frame_size;
+    float radius;
+};
+
+}
+
+#ifndef DEVICE_COMPATIBLE
+
 #include <util/noncopyable.h>
 
 #include "type_reflection.h"
 #include "device.h"
+#include "ray.h"
+#include "viewport.h"
 
 namespace luisa {
 
@@ -16,8 +47,44 @@ LUISA_MAKE_ERROR_TYPE(FilterError);
 #define THROW_FILTER_ERROR(...)  \
     LUISA_THROW_ERROR(FilterError, __VA_ARGS__)
 
+enum struct FilterMode {
+    GATHER,      // every pixel weights the samples of its neighbourhood by the filter
+    SPLAT,       // every sample adds its weighted radiance to the pixels of its neighbourhood, the same sums as GATHER's
+    IMPORTANCE   // the camera samples are distributed by the filter around their pixels, which take them with unit weights
+};
+
+// Both leave the weighted radiance and the weight sum in the film, which divides one by the other on output.
+enum struct FilterAccumulation {
+    AVERAGE,     // running averages of the frames, whose increments lose precision in 32-bit floats at thousands of frames
+    COMPENSATED  // running sums with Kahan's compensation, in a second film-sized texture
+};
+
+// Separable filters, w(dx, dy) = w(dx) * w(dy). Implementations only give the 1D weight, which is tabulated once into a small
+// buffer, so the filter pass reads and interpolates two table entries per neighbour rather than evaluating the filter.
+// In the importance mode, the inverse of the cumulative distribution of the weight is tabulated instead, the positive lobes
+// only, so filters with negative lobes such as Mitchell-Netravali lose their sharpening there.
 CORE_CLASS(Filter) {
 
+private:
+    Device *_device{nullptr};
+    std::shared_ptr<Kernel> _apply_kernel;
+    std::shared_ptr<Kernel> _apply_compact_kernel;
+    std::shared_ptr<Kernel> _accumulate_kernel;
+    std::shared_ptr<Kernel> _accumulate_compact_kernel;
+    std::shared_ptr<Kernel> _splat_kernel;
+    std::shared_ptr<Kernel> _splat_compact_kernel;
+    std::shared_ptr<Kernel> _splat_merge_kernel;
+    std::shared_ptr<Kernel> _warp_pixel_samples_kernel;
+    std::shared_ptr<Buffer> _table_buffer;
+    // One accumulator per splatting block rather than per worker: no block shares memory with another, so the splat needs no
+    // atomics and the merge sums in a fixed order, which keeps frames reproducible under any schedule. The cost is that the
+    // accumulators cover the frame (1 + 2r / 16)^2 times, r the pixel radius, at 16 bytes per pixel, e.g. 25 bytes per pixel
+    // or about 200 MB at 3840x2160 with r = 2, and up to 64 bytes per pixel with r = FILTER_MAX_PIXEL_RADIUS.
+    std::shared_ptr<Buffer> _accumulator_buffer;  // grown to the largest frame
+    std::shared_ptr<Texture> _compensation_texture;  // of the film, with compensated accumulation
+    
+    void _prepare_table();
+
 protected:
     PROPERTY(float, radius, CoreTypeTag::FLOAT) {
         if (params.size() != 1) {
@@ -25,18 +92,73 @@ protected:
         }
         _radius = params[0];
     }
+    
+    PROPERTY(FilterMode, mode, CoreTypeTag::STRING) {
+        if (params.size() != 1) {
+            THROW_FILTER_ERROR("expected exactly one string value as filter mode.");
+        }
+        if (params[0] == "GATHER") {
+            _mode = FilterMode::GATHER;
+        } else if (params[0] == "SPLAT") {
+            _mode = FilterMode::SPLAT;
+        } else if (params[0] == "IMPORTANCE") {
+            _mode = FilterMode::IMPORTANCE;
+        } else {
+            THROW_FILTER_ERROR("unknown filter mode \"", params[0], "\", expected \"GATHER\", \"SPLAT\" or \"IMPORTANCE\".");
+        }
+    }
+    
+    // the touches of the film can be batched as well, by rendering several samples per frame (see Integrator::samples_per_frame())
+    PROPERTY(FilterAccumulation, accumulation, CoreTypeTag::STRING) {
+        if (params.size() != 1) {
+            THROW_FILTER_ERROR("expected exactly one string value as filter accumulation.");
+        }
+        if (params[0] == "AVERAGE") {
+            _accumulation = FilterAccumulation::AVERAGE;
+        } else if (params[0] == "COMPENSATED") {
+            _accumulation = FilterAccumulation::COMPENSATED;
+        } else {
+            THROW_FILTER_ERROR("unknown filter accumulation \"", params[0], "\", expected \"AVERAGE\" or \"COMPENSATED\".");
+        }
+    }
+    
+    // the 1D weight at offset pixels from the center, for 0 <= offset <= radius()
+    [[nodiscard]] virtual float _weight(float offset) const noexcept = 0;
 
 public:
-    void initialize(Device &device [[maybe_unused]], const CoreTypeInitializerParameterSet &param_set) override {
-        if (!_decode_radius(param_set)) {
-            LUISA_WARNING("filter radius not specified, using default value (1.0).");
-            _radius = 1.0f;
-        }
+    void initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) override;
+    
+    // Moves the camera samples in the first two channels of random_texture, offsets in [0, 1) within their pixels, to offsets
+    // from the pixel corners distributed by the filter around the pixel centers, in the importance mode; nothing otherwise.
+    void warp_pixel_samples(KernelDispatcher &dispatch, Texture &random_texture, math::uint2 frame_size);
+    
+    // gather_ray_buffer holds GatherRay or CompactGatherRay, as told by encoding, per pixel of frame and sample, the samples in
+    // planes of frame.size stacked along y, with the pixel coordinates relative to frame.origin and the top of their plane;
+    // the filtered pixels of tile, which frame must cover along with pixel_radius() pixels around it as far as the film goes,
+    // are accumulated into the film-sized result_texture
+    virtual void apply(KernelDispatcher &dispatch, Buffer &gather_ray_buffer, RayEncoding encoding, Texture &result_texture,
+                       Viewport frame, Viewport tile, uint32_t samples_per_pixel, uint32_t frame_index);
+    
+    void apply(KernelDispatcher &dispatch, Buffer &gather_ray_buffer, RayEncoding encoding,
+               Texture &result_texture, math::uint2 frame_size, uint32_t frame_index) {
+        Viewport frame{math::uint2{0u, 0u}, frame_size};
+        apply(dispatch, gather_ray_buffer, encoding, result_texture, frame, frame, 1u, frame_index);
     }
     
-    virtual void apply(KernelDispatcher &dispatch, Buffer &gather_ray_buffer, Texture &result_texture, math::uint2 frame_size, uint32_t frame_index) = 0;
+    void apply(KernelDispatcher &dispatch, Buffer &gather_ray_buffer, Texture &result_texture, math::uint2 frame_size, uint32_t frame_index) {
+        apply(dispatch, gather_ray_buffer, RayEncoding::FULL, result_texture, frame_size, frame_index);
+    }
     
     [[nodiscard]] float radius() const noexcept { return _radius; }
+    [[nodiscard]] FilterMode mode() const noexcept { return _mode; }
+    [[nodiscard]] FilterAccumulation accumulation() const noexcept { return _accumulation; }
+    
+    // the number of neighbouring pixels on each side whose samples fall within radius() of a pixel center, and are gathered
+    [[nodiscard]] uint32_t pixel_radius() const noexcept {
+        return _mode == FilterMode::IMPORTANCE ? 0u : static_cast<uint32_t>(std::ceil(_radius - 0.5f - 1e-4f));
+    }
 };
 
 }
+
+#endif
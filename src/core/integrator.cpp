@@ -3,3 +3,29 @@
 //
 
 #include "integrator.h"
+
+namespace luisa {
+
+void Integrator::render_frame(KernelDispatcher &dispatch, const Scene &scene, Camera &camera, Filter &filter, Film &film,
+                              Texture &result_texture, uint32_t frame_index, float time) {
+    
+    auto film_size = result_texture.size();
+    auto tile_size = _tile_size.x == 0u ? film_size : math::min(_tile_size, film_size);
+    
+    // Each frame is its tile grown by the filter footprint, shifted back into the film at the borders rather than clipped,
+    // so that every frame is frame_size; the pixels a shifted frame shares with its neighbours are traced in both, with the
+    // same samples, and only filtered into the image with the tile that owns them.
+    auto apron = filter.pixel_radius();
+    auto frame_size = math::min(tile_size + 2u * apron, film_size);
+    
+    for (auto y = 0u; y < film_size.y; y += tile_size.y) {
+        for (auto x = 0u; x < film_size.x; x += tile_size.x) {
+            math::uint2 tile_origin{x, y};
+            Viewport tile{tile_origin, math::min(tile_size, film_size - tile_origin)};
+            auto frame_origin = math::min(tile_origin - math::min(tile_origin, math::uint2{apron, apron}), film_size - frame_size);
+            _render_tile(dispatch, scene, camera, filter, film, result_texture, Viewport{frame_origin, frame_size}, tile, frame_index, time);
+        }
+    }
+}
+
+}
@@ -5,11 +5,23 @@
 #pragma once
 
 #include "type_reflection.h"
+#include "device.h"
+#include "sampler.h"
+#include "camera.h"
+#include "filter.h"
+#include "film.h"
+#include "scene.h"
 
 namespace luisa {
 
+LUISA_MAKE_ERROR_TYPE(IntegratorError);
+
+#define THROW_INTEGRATOR_ERROR(...)  \
+    LUISA_THROW_ERROR(IntegratorError, __VA_ARGS__)
+
 CORE_CLASS(Integrator) {
-    
+
+protected:
     PROPERTY(std::shared_ptr<Sampler>, sampler, CoreTypeTag::SAMPLER) {
         _sampler = params[0];
     }
@@ -18,8 +30,55 @@ CORE_CLASS(Integrator) {
         _spp = params[0];
     }
     
-};
+    // renders frames tile by tile when given, so the per-pixel buffers of the integrator and the sampler only cover a tile
+    PROPERTY(math::uint2, tile_size, CoreTypeTag::INTEGER) {
+        if (params.size() != 2 || params[0] <= 0 || params[1] <= 0) {
+            THROW_INTEGRATOR_ERROR("expected exactly two positive integer values as integrator tile size.");
+        }
+        _tile_size = {params[0], params[1]};
+    }
+    
+    // traced and filtered in a single dispatch of every kernel per bounce, at the cost of that many times the per-pixel buffers
+    PROPERTY(uint32_t, samples_per_frame, CoreTypeTag::INTEGER) {
+        if (params.size() != 1 || params[0] <= 0) {
+            THROW_INTEGRATOR_ERROR("expected exactly one positive integer value as integrator samples per frame.");
+        }
+        _samples_per_frame = static_cast<uint32_t>(params[0]);
+    }
 
-}
+protected:
+    // Traces samples_per_frame() samples per pixel of frame, the pixels of tile grown by the filter footprint within the film, and
+    // accumulates the filtered pixels of tile into result_texture, and the AOVs of film over the pixels of tile. All frames of a
+    // film have the same size, so the buffers are allocated once.
+    virtual void _render_tile(KernelDispatcher &dispatch, const Scene &scene, Camera &camera, Filter &filter, Film &film,
+                              Texture &result_texture, Viewport frame, Viewport tile, uint32_t frame_index, float time) = 0;
 
+public:
+    void initialize(Device &device [[maybe_unused]], const CoreTypeInitializerParameterSet &param_set) override {
+        if (!_decode_sampler(param_set)) { THROW_INTEGRATOR_ERROR("integrator sampler not specified."); }
+        if (!_decode_spp(param_set)) {
+            LUISA_WARNING("integrator spp not specified, using default value (1).");
+            _spp = 1ul;
+        }
+        if (!_decode_tile_size(param_set)) { _tile_size = {0u, 0u}; }  // the whole film at once
+        if (!_decode_samples_per_frame(param_set)) { _samples_per_frame = 1u; }
+    }
+    
+    // Traces samples_per_frame() samples per pixel of result_texture seen through camera at the given time, and accumulates them
+    // into result_texture with filter as the frame_index-th frame, along with the AOVs declared by film; a render is
+    // spp / samples_per_frame() such frames. The film is split into tiles of tile_size() if given, each traced by _render_tile()
+    // along with the pixels the filter needs around it.
+    void render_frame(KernelDispatcher &dispatch, const Scene &scene, Camera &camera, Filter &filter, Film &film,
+                      Texture &result_texture, uint32_t frame_index, float time);
+    
+    void render_frame(KernelDispatcher &dispatch, const Scene &scene, Camera &camera, Filter &filter, Film &film, Texture &result_texture, uint32_t frame_index) {
+        render_frame(dispatch, scene, camera, filter, film, result_texture, frame_index, 0.0f);
+    }
+    
+    [[nodiscard]] Sampler &sampler() const noexcept { return *_sampler; }
+    [[nodiscard]] size_t spp() const noexcept { return _spp; }
+    [[nodiscard]] math::uint2 tile_size() const noexcept { return _tile_size; }
+    [[nodiscard]] uint32_t samples_per_frame() const noexcept { return _samples_per_frame; }
+};
 
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "mathematics.h"
+
+namespace luisa {
+
+// layouts written by AccelerationStructure::trace_nearest() and trace_any(),
+// matching MPSIntersectionDataTypeDistancePrimitiveIndexCoordinates and MPSIntersectionDataTypeDistance;
+// a negative distance means the ray hit nothing
+struct Intersection {
+    float distance;
+    uint32_t triangle_index;
+    math::float2 barycentric;  // weights of the first two vertices, the third one gets 1 - x - y
+};
+
+// written by the structures over instances (Device::create_instance_acceleration_structure()) instead of Intersection,
+// matching MPSIntersectionDataTypeDistancePrimitiveIndexInstanceIndexCoordinates
+struct InstanceIntersection {
+    float distance;
+    uint32_t triangle_index;  // within the mesh referenced by the instance
+    uint32_t instance_index;
+    alignas(8) math::float2 barycentric;
+};
+
+struct ShadowIntersection {
+    float distance;
+};
+
+}
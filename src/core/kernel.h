@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <memory>
+#include <functional>
 #include <string_view>
 #include <util/noncopyable.h>
 
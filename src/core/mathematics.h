@@ -7,9 +7,16 @@
 #ifndef DEVICE_COMPATIBLE
 
 #include <cmath>
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 #include <glm/glm.hpp>
 
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
 namespace luisa::math {
 
 using uint2 = glm::uvec2;
@@ -25,6 +32,7 @@ using float4 = glm::vec4;
 using packed_float2 = glm::vec2;
 using packed_float3 = glm::vec3;
 using packed_float4 = glm::vec4;
+using float4x4 = glm::mat4;
 
 using namespace glm;
 
@@ -42,6 +50,10 @@ inline float dot(float3 lhs, float3 rhs) noexcept {
     return dot(packed_float3(lhs), packed_float3(rhs));
 }
 
+inline float dot(packed_float3 lhs, packed_float3 rhs) noexcept {
+    return glm::dot(lhs, rhs);
+}
+
 }
 
 #endif
@@ -62,3 +74,95 @@ constexpr auto K_1_SQRT_2 [[maybe_unused]] = 0.707106781186547524400844362104849
 }
 
 }
+
+namespace luisa::math {
+
+// Pairs of half-precision floats packed into 32 bits, x in the lower 16 bits; finite magnitudes beyond the half range saturate to
+// its largest finite value, 65504, rather than becoming infinite, while infinities and NaNs are kept.
+
+#ifdef DEVICE_COMPATIBLE
+
+inline uint32_t pack_half2(float x, float y) {
+    auto v = float2(x, y);
+    return as_type<uint32_t>(half2(select(clamp(v, -65504.0f, 65504.0f), v, !isfinite(v))));
+}
+
+inline float2 unpack_half2(uint32_t bits) {
+    return float2(as_type<half2>(bits));
+}
+
+#elif defined(__F16C__)
+
+inline uint32_t pack_half2(float x, float y) noexcept {
+    auto v = _mm_setr_ps(x, y, 0.0f, 0.0f);
+    auto saturated = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-65504.0f)), _mm_set1_ps(65504.0f));
+    auto finite = _mm_cmplt_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), v), _mm_set1_ps(std::numeric_limits<float>::infinity()));  // false for NaNs
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_cvtps_ph(_mm_or_ps(_mm_and_ps(finite, saturated), _mm_andnot_ps(finite, v)), _MM_FROUND_TO_NEAREST_INT)));
+}
+
+inline float2 unpack_half2(uint32_t bits) noexcept {
+    auto v = _mm_cvtph_ps(_mm_cvtsi32_si128(static_cast<int>(bits)));
+    return {_mm_cvtss_f32(v), _mm_cvtss_f32(_mm_shuffle_ps(v, v, 1))};
+}
+
+#else
+
+inline uint32_t pack_half(float x) noexcept {  // rounds to nearest even, following F. Giesen's float_to_half_fast3_rtne
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(float));
+    auto sign = bits & 0x80000000u;
+    if ((bits & 0x7f800000u) == 0x7f800000u) {  // Inf or NaN, which the clamp below would not keep
+        auto mantissa = bits & 0x007fffffu;  // NaNs become quiet and keep the upper payload bits, as F16C converts them
+        return (mantissa == 0u ? 0x7c00u : 0x7e00u | (mantissa >> 13u)) | (sign >> 16u);
+    }
+    x = std::clamp(x, -65504.0f, 65504.0f);
+    std::memcpy(&bits, &x, sizeof(float));
+    bits ^= sign;
+    uint32_t half_bits;
+    if (bits < (113u << 23u)) {  // subnormal or zero
+        constexpr auto denormal_magic_bits = ((127u - 15u) + (23u - 10u) + 1u) << 23u;
+        float denormal_magic;
+        std::memcpy(&denormal_magic, &denormal_magic_bits, sizeof(float));
+        float f;
+        std::memcpy(&f, &bits, sizeof(float));
+        f += denormal_magic;
+        std::memcpy(&bits, &f, sizeof(float));
+        half_bits = bits - denormal_magic_bits;
+    } else {
+        auto odd = (bits >> 13u) & 1u;
+        bits += ((15u - 127u) << 23u) + 0xfffu + odd;
+        half_bits = bits >> 13u;
+    }
+    return (half_bits | (sign >> 16u)) & 0xffffu;
+}
+
+inline float unpack_half(uint32_t half_bits) noexcept {
+    constexpr auto shifted_exponent = 0x7c00u << 13u;
+    auto bits = (half_bits & 0x7fffu) << 13u;
+    auto exponent = shifted_exponent & bits;
+    bits += (127u - 15u) << 23u;
+    float x;
+    if (exponent == shifted_exponent) {  // Inf or NaN
+        bits += (128u - 16u) << 23u;
+        std::memcpy(&x, &bits, sizeof(float));
+    } else if (exponent == 0u) {  // subnormal or zero
+        bits += 1u << 23u;
+        std::memcpy(&x, &bits, sizeof(float));
+        x -= 6.103515625e-05f;  // 2^-14
+    } else {
+        std::memcpy(&x, &bits, sizeof(float));
+    }
+    return (half_bits & 0x8000u) ? -x : x;
+}
+
+inline uint32_t pack_half2(float x, float y) noexcept {
+    return pack_half(x) | (pack_half(y) << 16u);
+}
+
+inline float2 unpack_half2(uint32_t bits) noexcept {
+    return {unpack_half(bits & 0xffffu), unpack_half(bits >> 16u)};
+}
+
+#endif
+
+}
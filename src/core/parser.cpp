@@ -2,6 +2,7 @@
 // Created by Mike Smith on 2019/10/5.
 //
 
+#include <algorithm>
 #include "parser.h"
 
 namespace luisa {
@@ -11,75 +12,92 @@ void Parser::_skip_blanks_and_comments() {
         THROW_PARSER_ERROR(_curr_line, _curr_col, "peeked token \"", _peeked, "\" should not be skipped.");
     }
     _peeked = {};
-    while (!_remaining.empty()) {
-        if (_remaining.front() == '\r') {
-            _remaining = _remaining.substr(1);
-            if (!_remaining.empty() && _remaining.front() == '\n') {
-                _remaining = _remaining.substr(1);
-            }
-            _next_line++;
-            _next_col = 0;
-        } else if (_remaining.front() == '\n') {
-            _remaining = _remaining.substr(1);
+    auto i = 0ul;
+    while (i < _remaining.size()) {
+        if (_remaining[i] == '\r' || _remaining[i] == '\n') {
+            i += _remaining[i] == '\r' && i + 1 < _remaining.size() && _remaining[i + 1] == '\n' ? 2 : 1;
             _next_line++;
             _next_col = 0;
-        } else if (std::isblank(_remaining.front())) {
-            _remaining = _remaining.substr(1);
+        } else if (_remaining[i] == ' ' || _remaining[i] == '\t') {  // std::isblank() in the C locale
+            i++;
             _next_col++;
-        } else if (_remaining.front() == '/') {
-            _remaining = _remaining.substr(1);
+        } else if (_remaining[i] == '/') {
+            i++;
             _next_col++;
-            if (_remaining.empty() || _remaining.front() != '/') {
+            if (i >= _remaining.size() || _remaining[i] != '/') {
                 THROW_PARSER_ERROR(_next_line, _next_col, "expected '/' at the beginning of comments.");
             }
-            for (; !_remaining.empty() && _remaining.front() != '\r' && _remaining.front() != '\n'; _remaining = _remaining.substr(1)) {
-                _next_col++;
-            }
+            auto end = std::min(_remaining.find_first_of("\r\n", i), _remaining.size());
+            _next_col += end - i;
+            i = end;
         } else {
             break;
         }
     }
+    _remaining.remove_prefix(i);
     _curr_line = _next_line;
     _curr_col = _next_col;
 }
 
+size_t Parser::_number_length() const noexcept {
+    auto is_digit = [this](size_t i) { return i < _remaining.size() && _remaining[i] >= '0' && _remaining[i] <= '9'; };
+    if (_remaining.empty() || (_remaining.front() != '+' && _remaining.front() != '-' && _remaining.front() != '.' && !is_digit(0ul))) {
+        return 0ul;
+    }
+    auto i = 1ul;
+    for (; i < _remaining.size() && (_remaining[i] == '.' || is_digit(i)); i++) {}
+    if (i < _remaining.size() && (_remaining[i] == 'e' || _remaining[i] == 'E')) {  // exponents, as printed by %g
+        auto j = i + 1 < _remaining.size() && (_remaining[i + 1] == '+' || _remaining[i + 1] == '-') ? i + 2 : i + 1;
+        if (is_digit(j)) {
+            for (i = j; is_digit(i); i++) {}
+        }
+    }
+    return i;
+}
+
 std::string_view Parser::_peek() {
     if (_peeked.empty()) {
         if (_remaining.empty()) {
             THROW_PARSER_ERROR(_curr_line, _curr_col, "peek at the end of the file.");
         }
+        auto length = 0ul;
         if (_remaining.front() == '{' || _remaining.front() == '}' || _remaining.front() == ':' || _remaining.front() == ',' || _remaining.front() == '@') {  // symbols
-            _peeked = _remaining.substr(0, 1);
-            _remaining = _remaining.substr(1);
-            _next_col++;
+            length = 1;
         } else if (_remaining.front() == '_' || std::isalpha(_remaining.front())) {  // Keywords or identifiers
-            auto i = 1ul;
-            for (; i < _remaining.size() && (_remaining[i] == '_' || std::isalnum(_remaining[i])); i++) {}
-            _peeked = _remaining.substr(0, i);
-            _remaining = _remaining.substr(i);
-            _next_col += i;
-        } else if (_remaining.front() == '+' || _remaining.front() == '-' || _remaining.front() == '.' || std::isdigit(_remaining.front())) {  // numbers
-            auto i = 1ul;
-            for (; i < _remaining.size() && (_remaining[i] == '.' || std::isdigit(_remaining[i])); i++) {}
-            _peeked = _remaining.substr(0, i);
-            _remaining = _remaining.substr(i);
-            _next_col += i;
+            for (length = 1; length < _remaining.size() && (_remaining[length] == '_' || std::isalnum(_remaining[length])); length++) {}
+        } else if (auto number_length = _number_length(); number_length != 0ul) {  // numbers
+            length = number_length;
         } else if (_remaining.front() == '"') {  // strings
             auto i = 1ul;
             for (; i < _remaining.size() && _remaining[i] != '"' && _remaining[i] != '\r' && _remaining[i] != '\n'; i++) {
                 if (_remaining[i] == '\\') { i++; }  // dirty handling for escape characters
             }
-            _next_col += i + 1;
             if (i >= _remaining.size() || _remaining[i] != '"') {
-                THROW_PARSER_ERROR(_next_line, _next_col, "expected '\"'.");
+                THROW_PARSER_ERROR(_next_line, _next_col + i + 1, "expected '\"'.");
             }
-            _peeked = _remaining.substr(0, i + 1);
-            _remaining = _remaining.substr(i + 1);
+            length = i + 1;
         }
+        _peeked = _remaining.substr(0, length);
+        _remaining.remove_prefix(length);
+        _next_col += length;
     }
     return _peeked;
 }
 
+char Parser::_peek_symbol() {
+    if (!_peeked.empty()) { return _peeked.front(); }
+    if (_remaining.empty()) {
+        THROW_PARSER_ERROR(_curr_line, _curr_col, "peek at the end of the file.");
+    }
+    return _remaining.front();
+}
+
+void Parser::_skip(size_t count) {
+    _remaining.remove_prefix(count);
+    _next_col += count;
+    _skip_blanks_and_comments();
+}
+
 void Parser::_pop() {
     if (_peeked.empty()) {
         THROW_PARSER_ERROR(_curr_line, _curr_col, "token not peeked before being popped.");
@@ -133,16 +151,13 @@ std::vector<std::shared_ptr<Task>> Parser::parse(std::filesystem::path file_path
     _curr_col = 0;
     _next_line = 0;
     _next_col = 0;
-    _source.clear();
     _created.clear();
     _peeked = {};
     _remaining = {};
-    std::ifstream file{file_path};
-    if (!file.is_open()) {
+    if (!_source.open(file_path)) {
         THROW_PARSER_ERROR(0, 0, "failed to open file: ", file_path);
     }
-    _source = std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
-    _remaining = _source;
+    _remaining = _source.contents();
     _skip_blanks_and_comments();
     return _parse_top_level();
 }
@@ -179,7 +194,18 @@ CoreTypeInitializerParameterSet Parser::_parse_creator_parameter_set(CoreTypeTag
 }
 
 CoreTypeVectorVariant Parser::_parse_property_decoder_parameter_list(CoreTypeTag tag) {
-    return _parse_property_decoder_parameter_list(tag, std::make_index_sequence<non_value_core_type_count>{});
+    switch (tag) {  // value types are not indexed, see CoreTypeTag
+        case CoreTypeTag::STRING:
+            return _parse_property_decoder_parameter_list_impl<CoreTypeTag::STRING>();
+        case CoreTypeTag::BOOL:
+            return _parse_property_decoder_parameter_list_impl<CoreTypeTag::BOOL>();
+        case CoreTypeTag::FLOAT:
+            return _parse_number_list<TypeOfCoreTypeTag<CoreTypeTag::FLOAT>>();
+        case CoreTypeTag::INTEGER:
+            return _parse_number_list<TypeOfCoreTypeTag<CoreTypeTag::INTEGER>>();
+        default:
+            return _parse_property_decoder_parameter_list(tag, std::make_index_sequence<non_value_core_type_count>{});
+    }
 }
 
 }
\ No newline at end of file
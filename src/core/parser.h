@@ -6,12 +6,14 @@
 
 #include <vector>
 #include <variant>
-#include <fstream>
-#include <streambuf>
 #include <iostream>
 #include <charconv>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 
 #include <util/string_manipulation.h>
+#include <util/mapped_file.h>
 
 #include "type_reflection.h"
 
@@ -67,7 +69,7 @@ private:
     size_t _curr_col{};
     size_t _next_line{};
     size_t _next_col{};
-    std::string _source;
+    util::MappedFile _source;  // the names in _created point into it
     std::string_view _peeked;
     std::string_view _remaining;
     std::unordered_map<std::string_view, std::shared_ptr<CoreTypeBase>> _created;
@@ -75,10 +77,69 @@ private:
     void _skip_blanks_and_comments();
     [[nodiscard]] std::string_view _peek();
     void _pop();
+    [[nodiscard]] size_t _number_length() const noexcept;
+    [[nodiscard]] char _peek_symbol();
+    void _skip(size_t count);
     void _match(std::string_view token);
     [[nodiscard]] std::vector<std::shared_ptr<Task>> _parse_top_level();
     [[nodiscard]] bool _finished() const noexcept;
     
+    // The whole token has to be consumed. Floating-point from_chars() is missing from older standard libraries, notably Apple's libc++,
+    // so there a null-terminated copy of the token is converted by strtof() instead.
+    template<typename T>
+    [[nodiscard]] static bool _convert_number(std::string_view token, T &value) noexcept {
+        if (token.empty()) { return false; }
+        auto first = token.data() + (token.front() == '+');  // unlike stof(), from_chars() takes no plus sign
+        auto last = token.data() + token.size();
+        if (first != token.data() && first != last && (*first == '+' || *first == '-')) { return false; }  // "+-1" or "++1"
+#ifndef __cpp_lib_to_chars
+        if constexpr (std::is_floating_point_v<T>) {
+            char buffer[64];
+            auto length = static_cast<size_t>(last - first);
+            if (length >= sizeof(buffer)) { return false; }  // far more digits than a float holds
+            std::memcpy(buffer, first, length);
+            buffer[length] = '\0';
+            char *end = nullptr;
+            errno = 0;
+            if constexpr (std::is_same_v<T, float>) {
+                value = std::strtof(buffer, &end);
+            } else {
+                value = static_cast<T>(std::strtod(buffer, &end));
+            }
+            return errno != ERANGE && end == buffer + length;
+        } else
+#endif
+        {
+            auto [end, error] = std::from_chars(first, last, value);
+            return error == std::errc{} && end == last;
+        }
+    }
+    
+    // Numbers are converted right where they lie in the source, and the commas between them skipped without being peeked
+    // as tokens, since generated scenes may carry millions of them.
+    template<typename T>
+    [[nodiscard]] std::vector<T> _parse_number_list() {
+        std::vector<T> v;
+        _match("{");
+        while (_peek_symbol() != '}') {
+            auto token = _remaining.substr(0, _number_length());
+            T value{};
+            if (!_convert_number(token, value)) {
+                THROW_PARSER_ERROR(_curr_line, _curr_col, "failed to convert \"", token.empty() ? _remaining.substr(0, 1) : token, "\" into ",
+                                   std::is_integral_v<T> ? "integer." : "float.");
+            }
+            v.emplace_back(value);
+            _skip(token.size());
+            if (auto symbol = _peek_symbol(); symbol == ',') {
+                _skip(1u);
+            } else if (symbol != '}') {
+                THROW_PARSER_ERROR(_curr_line, _curr_col, "expected \",\", got \"", _peek(), "\".");
+            }
+        }
+        _match("}");
+        return v;
+    }
+    
     template<CoreTypeTag tag>
     [[nodiscard]] auto _parse_property_decoder_parameter_list_impl() {
         
@@ -116,24 +177,6 @@ private:
                     THROW_PARSER_ERROR(_curr_line, _curr_col, "unexpected value \"", token, "\" for bool type (expected true or false).");
                 }
                 _pop();
-            } else if constexpr (tag == CoreTypeTag::FLOAT) {  // special handling for floats
-                auto token = _peek();
-                auto count = 0ul;
-                auto value = stof(std::string{token}, &count);
-                if (count != token.size()) {
-                    THROW_PARSER_ERROR(_curr_line, _curr_col, "failed to convert \"", token, "\" into float.");
-                }
-                _pop();
-                v.emplace_back(value);
-            } else if constexpr (tag == CoreTypeTag::INTEGER) {  // special handling for integers
-                auto token = _peek();
-                auto count = 0ul;
-                auto value = stoi(std::string{token}, &count);
-                if (count != token.size()) {
-                    THROW_PARSER_ERROR(_curr_line, _curr_col, "failed to convert \"", token, "\" into integer.");
-                }
-                _pop();
-                v.emplace_back(value);
             } else {  // non-value core types
                 if (_peek() == "@") {  // reference
                     _pop();  // @
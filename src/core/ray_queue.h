@@ -0,0 +1,39 @@
+#pragma once
+
+#include <util/noncopyable.h>
+#include "ray.h"
+#include "device.h"
+
+namespace luisa {
+
+// Structure-of-arrays storage for up to capacity rays, one buffer per stream of ray.h. Stages bind only the streams they use,
+// where a buffer of Ray would have them read and write whole 80-byte records; the traces read the geometry stream, and the
+// time in the pixel stream for motion blur. The other streams hold the types of encoding(), see FullRayStreams and CompactRayStreams.
+class RayQueue : util::Noncopyable {
+
+private:
+    std::shared_ptr<Buffer> _geometry_buffer;
+    std::shared_ptr<Buffer> _throughput_buffer;
+    std::shared_ptr<Buffer> _radiance_buffer;
+    std::shared_ptr<Buffer> _pixel_buffer;
+    uint32_t _capacity;
+    RayEncoding _encoding;
+
+public:
+    RayQueue(Device &device, uint32_t capacity, RayEncoding encoding = RayEncoding::FULL, BufferStorageTag storage = BufferStorageTag::DEVICE_PRIVATE)
+        : _geometry_buffer{device.create_buffer(sizeof(RayGeometry) * capacity, storage)},
+          _throughput_buffer{device.create_buffer((encoding == RayEncoding::FULL ? sizeof(RayThroughput) : sizeof(CompactRayThroughput)) * capacity, storage)},
+          _radiance_buffer{device.create_buffer((encoding == RayEncoding::FULL ? sizeof(RayRadiance) : sizeof(CompactRayRadiance)) * capacity, storage)},
+          _pixel_buffer{device.create_buffer((encoding == RayEncoding::FULL ? sizeof(RayPixel) : sizeof(CompactRayPixel)) * capacity, storage)},
+          _capacity{capacity},
+          _encoding{encoding} {}
+    
+    [[nodiscard]] Buffer &geometry_buffer() const noexcept { return *_geometry_buffer; }
+    [[nodiscard]] Buffer &throughput_buffer() const noexcept { return *_throughput_buffer; }
+    [[nodiscard]] Buffer &radiance_buffer() const noexcept { return *_radiance_buffer; }
+    [[nodiscard]] Buffer &pixel_buffer() const noexcept { return *_pixel_buffer; }
+    [[nodiscard]] uint32_t capacity() const noexcept { return _capacity; }
+    [[nodiscard]] RayEncoding encoding() const noexcept { return _encoding; }
+};
+
+}
@@ -0,0 +1,154 @@
+#include <cmath>
+#include <random>
+#include <vector>
+#include "sampler.h"
+
+namespace luisa {
+
+namespace {
+
+// Ulichney's void-and-cluster method on the torus, ranking the pixels of the mask so that those below any rank are spread
+// out evenly, with the ranks scaled to the centers of [0, 1) in as many steps
+[[nodiscard]] std::vector<float> generate_blue_noise_mask() {
+    
+    constexpr auto size = SAMPLER_BLUE_NOISE_MASK_SIZE;
+    constexpr auto count = size * size;
+    constexpr auto sigma = 1.5f;
+    
+    // the energy a pixel of the pattern adds to the others, by their offsets wrapped around
+    std::vector<float> kernel(count);
+    for (auto y = 0u; y < size; y++) {
+        for (auto x = 0u; x < size; x++) {
+            auto dx = static_cast<float>(std::min(x, size - x));
+            auto dy = static_cast<float>(std::min(y, size - y));
+            kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+        }
+    }
+    
+    std::vector<uint8_t> pattern(count, 0u);
+    std::vector<float> energy(count, 0.0f);
+    auto toggle = [&](uint32_t p) {
+        auto sign = pattern[p] ? -1.0f : 1.0f;
+        pattern[p] = !pattern[p];
+        auto px = p % size;
+        auto py = p / size;
+        for (auto y = 0u; y < size; y++) {
+            auto row = ((y - py) & (size - 1u)) * size;
+            for (auto x = 0u; x < size; x++) { energy[y * size + x] += sign * kernel[row + ((x - px) & (size - 1u))]; }
+        }
+    };
+    auto tightest_cluster = [&] {
+        auto best = 0u;
+        for (auto p = 0u; p < count; p++) {
+            if (pattern[p] && (!pattern[best] || energy[p] > energy[best])) { best = p; }
+        }
+        return best;
+    };
+    // as the energies of all pixels sum to the same everywhere, the tightest cluster of the minority zeros is found here too
+    auto largest_void = [&] {
+        auto best = 0u;
+        for (auto p = 0u; p < count; p++) {
+            if (!pattern[p] && (pattern[best] || energy[p] < energy[best])) { best = p; }
+        }
+        return best;
+    };
+    
+    // a tenth of the pixels at random, then moved from their tightest cluster to the largest void until that changes nothing
+    constexpr auto initial_count = count / 10u;
+    std::mt19937 random{0u};
+    for (auto ones = 0u; ones < initial_count;) {
+        auto p = static_cast<uint32_t>(random() % count);
+        if (!pattern[p]) {
+            toggle(p);
+            ones++;
+        }
+    }
+    for (auto i = 0u; i < count; i++) {
+        auto cluster = tightest_cluster();
+        toggle(cluster);
+        auto void_ = largest_void();
+        toggle(void_);
+        if (void_ == cluster) { break; }
+    }
+    
+    // ranked downwards by removing the tightest clusters of the initial pattern, then upwards by filling the largest voids
+    std::vector<uint32_t> ranks(count);
+    auto initial_pattern = pattern;
+    auto initial_energy = energy;
+    for (auto rank = initial_count; rank-- > 0u;) {
+        auto cluster = tightest_cluster();
+        toggle(cluster);
+        ranks[cluster] = rank;
+    }
+    pattern = std::move(initial_pattern);
+    energy = std::move(initial_energy);
+    for (auto rank = initial_count; rank < count; rank++) {
+        auto void_ = largest_void();
+        toggle(void_);
+        ranks[void_] = rank;
+    }
+    
+    std::vector<float> mask(count);
+    for (auto p = 0u; p < count; p++) { mask[p] = (static_cast<float>(ranks[p]) + 0.5f) / static_cast<float>(count); }
+    return mask;
+}
+
+}
+
+void Sampler::initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) {
+    if (!_decode_distribution(param_set)) { _distribution = SamplerDistribution::WHITE_NOISE; }
+    _device = &device;
+    _generate_samples_kernel = device.create_kernel("sampler_generate_samples");
+    _dimension_buffer = device.create_buffer(16u, BufferStorageTag::DEVICE_PRIVATE);
+    _table_buffer = device.create_buffer(16u, BufferStorageTag::DEVICE_PRIVATE);
+    if (_distribution == SamplerDistribution::BLUE_NOISE) {
+        static const auto mask = generate_blue_noise_mask();  // the same for all samplers, made once
+        _blue_noise_buffer = device.create_buffer(sizeof(float) * mask.size(), BufferStorageTag::MANAGED);
+        _blue_noise_buffer->upload(mask.data(), sizeof(float) * mask.size());
+    } else {
+        _blue_noise_buffer = device.create_buffer(16u, BufferStorageTag::DEVICE_PRIVATE);
+    }
+    _uniforms.kind = _kind();
+    _uniforms.distribution = _distribution == SamplerDistribution::BLUE_NOISE ? SAMPLER_BLUE_NOISE : SAMPLER_WHITE_NOISE;
+}
+
+void Sampler::prepare_for_frame(Viewport frame, uint samples_per_pixel, uint frame_index, uint total_dimensions) {
+    _current_dimension = 0u;
+    _uniforms.frame_origin = frame.origin;
+    _uniforms.frame_size = frame.size;
+    _uniforms.frame_index = frame_index;
+    _uniforms.samples_per_pixel = samples_per_pixel;
+    _prepare_tables(total_dimensions);
+}
+
+uint32_t Sampler::reserve_dimensions(uint32_t dimensions) {
+    if (_current_dimension % SAMPLER_GROUP_DIMENSIONS + dimensions > SAMPLER_GROUP_DIMENSIONS) {
+        _current_dimension = (_current_dimension + SAMPLER_GROUP_DIMENSIONS - 1u) / SAMPLER_GROUP_DIMENSIONS * SAMPLER_GROUP_DIMENSIONS;
+    }
+    auto dimension = _current_dimension;
+    _current_dimension += dimensions;
+    return dimension;
+}
+
+void Sampler::generate_samples(KernelDispatcher &dispatch, Texture &random_texture, uint dimensions) {
+    
+    math::uint2 frame_size{_uniforms.frame_size.x, _uniforms.frame_size.y * _uniforms.samples_per_pixel};
+    math::uint2 threadgroup_size{32, 32};
+    auto threadgroups = (frame_size + threadgroup_size - 1u) / threadgroup_size;
+    
+    SamplerGenerateSamplesUniforms uniforms{_uniforms, reserve_dimensions(dimensions), dimensions};
+    
+    dispatch(*_generate_samples_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+        encoder["uniforms"]->set_bytes(&uniforms, sizeof(SamplerGenerateSamplesUniforms));
+        bind_tables(encoder);
+        encoder["random"]->set_texture(random_texture);
+    });
+}
+
+void Sampler::bind_tables(KernelArgumentEncoder &encoder) {
+    encoder["sampler_dimensions"]->set_buffer(*_dimension_buffer);
+    encoder["sampler_table"]->set_buffer(*_table_buffer);
+    encoder["sampler_blue_noise"]->set_buffer(*_blue_noise_buffer);
+}
+
+}
@@ -4,20 +4,130 @@
 
 #pragma once
 
+#include "mathematics.h"
+
+namespace luisa {
+
+// Zhou et al.'s TEA-based hash from "GPU Random Numbers via the Tiny Encryption Algorithm", seeding samplers per pixel.
+template<uint32_t N>
+inline uint32_t tea(uint32_t v0, uint32_t v1) {
+    auto s0 = 0u;
+    for (auto n = 0u; n < N; n++) {
+        s0 += 0x9e3779b9u;
+        v0 += ((v1 << 4u) + 0xa341316cu) ^ (v1 + s0) ^ ((v1 >> 5u) + 0xc8013ea4u);
+        v1 += ((v0 << 4u) + 0xad90777du) ^ (v0 + s0) ^ ((v0 >> 5u) + 0x7e95761eu);
+    }
+    return v0;
+}
+
+constexpr auto SAMPLER_HALTON = 0u;
+constexpr auto SAMPLER_SOBOL = 1u;
+constexpr auto SAMPLER_GROUP_DIMENSIONS = 4u;  // of the aligned groups the samples taken together must keep within
+
+constexpr auto SAMPLER_WHITE_NOISE = 0u;
+constexpr auto SAMPLER_BLUE_NOISE = 1u;
+constexpr auto SAMPLER_BLUE_NOISE_MASK_SHIFT = 6u;  // log2 of the pixels on each side of the blue-noise mask, which tiles the film
+constexpr auto SAMPLER_BLUE_NOISE_MASK_SIZE = 1u << SAMPLER_BLUE_NOISE_MASK_SHIFT;
+
+// What sampler_sample() in sampling.h of the kernels needs to evaluate the samples of a frame, see Sampler::uniforms().
+struct alignas(16) SamplerUniforms {
+    math::uint2 frame_origin;
+    math::uint2 frame_size;  // of a plane of samples
+    uint32_t frame_index;
+    uint32_t samples_per_pixel;
+    uint32_t kind;              // SAMPLER_HALTON or SAMPLER_SOBOL
+    uint32_t table_dimensions;  // tabulated by the Halton sampler
+    uint32_t distribution;      // SAMPLER_WHITE_NOISE or SAMPLER_BLUE_NOISE, see SamplerDistribution
+};
+
+struct alignas(16) SamplerGenerateSamplesUniforms {
+    SamplerUniforms sampler;
+    uint32_t dimension;
+    uint32_t dimensions;
+};
+
+}
+
+#ifndef DEVICE_COMPATIBLE
+
 #include "device.h"
 #include "type_reflection.h"
+#include "viewport.h"
 
 namespace luisa {
 
+LUISA_MAKE_ERROR_TYPE(SamplerError);
+
+#define THROW_SAMPLER_ERROR(...)  \
+    LUISA_THROW_ERROR(SamplerError, __VA_ARGS__)
+
+// How the errors of neighbouring pixels relate at low sample counts.
+enum struct SamplerDistribution {
+    WHITE_NOISE,  // independently scrambled sequences per pixel, so the errors are uncorrelated
+    BLUE_NOISE    // one sequence per tile of the blue-noise mask, shifted per pixel and dimension by the ranks of the mask
+};
+
+// Samples are stateless: any kernel evaluates a dimension of a sample wherever it needs it with sampler_sample() of sampling.h,
+// given uniforms() in its own uniforms and the buffers bound by bind_tables(), without anything written per pixel before.
+// Kernels reading their samples from a texture instead, such as the camera's after Filter::warp_pixel_samples(), get them
+// written by generate_samples(). Samplers only differ by the kind of samples and the tables they set up.
 CORE_CLASS(Sampler) {
 
+private:
+    std::shared_ptr<Kernel> _generate_samples_kernel;
+    std::shared_ptr<Buffer> _blue_noise_buffer;  // a small stand-in for white noise
+    uint32_t _current_dimension{0u};
+
 protected:
-    uint32_t _current_dimension;
+    Device *_device{nullptr};
+    SamplerUniforms _uniforms{};
+    std::shared_ptr<Buffer> _dimension_buffer;  // see HaltonSamplerDimension, a small stand-in for samplers without tables
+    std::shared_ptr<Buffer> _table_buffer;
+    
+    PROPERTY(SamplerDistribution, distribution, CoreTypeTag::STRING) {
+        if (params.size() != 1) {
+            THROW_SAMPLER_ERROR("expected exactly one string value as sampler distribution.");
+        }
+        if (params[0] == "WHITE_NOISE") {
+            _distribution = SamplerDistribution::WHITE_NOISE;
+        } else if (params[0] == "BLUE_NOISE") {
+            _distribution = SamplerDistribution::BLUE_NOISE;
+        } else {
+            THROW_SAMPLER_ERROR("unknown sampler distribution \"", params[0], "\", expected \"WHITE_NOISE\" or \"BLUE_NOISE\".");
+        }
+    }
+    
+    [[nodiscard]] virtual uint32_t _kind() const noexcept = 0;
+    
+    // called by prepare_for_frame(), setting up the tables and _uniforms.table_dimensions for the dimensions of a frame
+    virtual void _prepare_tables(uint32_t total_dimensions [[maybe_unused]]) {}
 
 public:
-    void initialize(Device &device [[maybe_unused]], const CoreTypeInitializerParameterSet &param_set [[maybe_unused]]) override { _current_dimension = 0u; }
-    virtual void prepare_for_frame(KernelDispatcher &dispatch, math::uint2 frame_size, uint frame_index, uint total_dimensions) = 0;
-    virtual void generate_samples(KernelDispatcher &dispatch, Texture &random_texture, uint dimensions) = 0;
+    void initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) override;
+    
+    // samples are taken for the pixels of frame, a viewport of the film, the pixel at frame.origin being (0, 0) of the
+    // random texture; with samples_per_pixel samples, the s-th ones of all pixels are s * frame.size.y rows further down,
+    // and taken as the (frame_index * samples_per_pixel + s)-th of their pixels, which do not depend on the viewports
+    void prepare_for_frame(Viewport frame, uint samples_per_pixel, uint frame_index, uint total_dimensions);
+    
+    void prepare_for_frame(math::uint2 frame_size, uint frame_index, uint total_dimensions) {
+        prepare_for_frame(Viewport{math::uint2{0u, 0u}, frame_size}, 1u, frame_index, total_dimensions);
+    }
+    
+    // Takes the next dimensions, at most SAMPLER_GROUP_DIMENSIONS of them, moving on to the next group if they would straddle
+    // two, and returns the first one for sampler_sample().
+    [[nodiscard]] uint32_t reserve_dimensions(uint32_t dimensions);
+    
+    // writes the next dimensions, at most four, into the channels of random_texture
+    void generate_samples(KernelDispatcher &dispatch, Texture &random_texture, uint dimensions);
+    
+    // to the "sampler_dimensions", "sampler_table" and "sampler_blue_noise" arguments of a kernel calling sampler_sample()
+    void bind_tables(KernelArgumentEncoder &encoder);
+    
+    [[nodiscard]] const SamplerUniforms &uniforms() const noexcept { return _uniforms; }
+    [[nodiscard]] SamplerDistribution distribution() const noexcept { return _distribution; }
 };
 
 }
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "mathematics.h"
+
+namespace luisa {
+
+struct alignas(16) MaterialData {
+    math::float3 albedo;  // linear sRGB
+    uint32_t is_mirror;
+};
+
+struct alignas(16) LightData {  // point lights
+    math::float3 position;
+    math::float3 emission;  // linear sRGB
+};
+
+}
+
+#ifndef DEVICE_COMPATIBLE
+
+#include <memory>
+#include "acceleration_structure.h"
+
+namespace luisa {
+
+// What the integrators see of the scene: triangle i has the vertices 3i to 3i + 2 in the position and normal buffers
+// (math::float3, the positions being the ones the acceleration structure is built over, so it is not instanced), and the material
+// material_buffer[material_id_buffer[i]]; light_buffer holds light_count LightData.
+struct Scene {
+    std::shared_ptr<AccelerationStructure> acceleration_structure;
+    std::shared_ptr<Buffer> position_buffer;
+    std::shared_ptr<Buffer> normal_buffer;
+    std::shared_ptr<Buffer> material_id_buffer;
+    std::shared_ptr<Buffer> material_buffer;
+    std::shared_ptr<Buffer> light_buffer;
+    uint32_t light_count{0u};
+};
+
+}
+
+#endif
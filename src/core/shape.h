@@ -5,13 +5,40 @@
 #pragma once
 
 #include "type_reflection.h"
+#include "device.h"
 
 namespace luisa {
 
-CORE_CLASS(Shape) {
+LUISA_MAKE_ERROR_TYPE(ShapeError);
 
+#define THROW_SHAPE_ERROR(...)  \
+    LUISA_THROW_ERROR(ShapeError, __VA_ARGS__)
 
+CORE_CLASS(Shape) {
 
+protected:
+    // "SAH" for static geometry, "LBVH" for geometry rebuilt every frame, or "TRBVH" in between (see AccelerationStructureBuildMode)
+    PROPERTY(AccelerationStructureBuildMode, build_mode, CoreTypeTag::STRING) {
+        if (params.size() != 1) {
+            THROW_SHAPE_ERROR("expected exactly one string value as acceleration structure build mode.");
+        }
+        if (params[0] == "SAH") {
+            _build_mode = AccelerationStructureBuildMode::SAH;
+        } else if (params[0] == "LBVH") {
+            _build_mode = AccelerationStructureBuildMode::LBVH;
+        } else if (params[0] == "TRBVH") {
+            _build_mode = AccelerationStructureBuildMode::TRBVH;
+        } else {
+            THROW_SHAPE_ERROR("unknown acceleration structure build mode \"", params[0], "\", expected \"SAH\", \"LBVH\" or \"TRBVH\".");
+        }
+    }
+
+public:
+    void initialize(Device &device [[maybe_unused]], const CoreTypeInitializerParameterSet &param_set) override {
+        if (!_decode_build_mode(param_set)) { _build_mode = AccelerationStructureBuildMode::SAH; }
+    }
+
+    [[nodiscard]] AccelerationStructureBuildMode build_mode() const noexcept { return _build_mode; }
 };
 
 }
@@ -3,3 +3,17 @@
 //
 
 #include "transform.h"
+
+namespace luisa {
+
+std::vector<glm::mat4> Transform::keyframes(float shutter_open, float shutter_close, uint32_t count) {
+    std::vector<glm::mat4> transforms;
+    transforms.reserve(count);
+    for (auto i = 0u; i < count; i++) {
+        auto t = count == 1u ? 0.0f : static_cast<float>(i) / static_cast<float>(count - 1u);
+        transforms.emplace_back(at(shutter_open + (shutter_close - shutter_open) * t));
+    }
+    return transforms;
+}
+
+}
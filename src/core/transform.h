@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <vector>
 #include <glm/glm.hpp>
 #include "type_reflection.h"
 
@@ -13,6 +14,9 @@ CORE_CLASS(Transform) {
     
 public:
     virtual glm::mat4 at(float time) = 0;
+    
+    // evenly spaced over the shutter interval, as taken by Device::create_motion_instance_acceleration_structure()
+    [[nodiscard]] std::vector<glm::mat4> keyframes(float shutter_open, float shutter_close, uint32_t count);
 };
 
 }
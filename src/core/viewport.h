@@ -0,0 +1,13 @@
+#pragma once
+
+#include "mathematics.h"
+
+namespace luisa {
+
+// A rectangle of film pixels, from origin to origin + size.
+struct Viewport {
+    math::uint2 origin;
+    math::uint2 size;
+};
+
+}
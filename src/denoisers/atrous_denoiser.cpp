@@ -0,0 +1,148 @@
+#include <atomic>
+#include <util/thread_pool.h>
+#include <devices/cpu/cpu_simd.h>
+#include "atrous_denoiser.h"
+
+namespace luisa {
+
+namespace {
+
+using cpu::CPUFloat8;
+
+constexpr float ATROUS_KERNEL[5]{1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+constexpr auto ATROUS_MIN_ALBEDO = 1e-2f;  // of the demodulation, so black surfaces and the sky keep their colours
+
+enum ATrousPlane : uint32_t {
+    COLOR_R, COLOR_G, COLOR_B,
+    NORMAL_X, NORMAL_Y, NORMAL_Z,
+    ALBEDO_R, ALBEDO_G, ALBEDO_B,
+    OUTPUT_R, OUTPUT_G, OUTPUT_B,
+    PLANE_COUNT
+};
+
+// calls row(y) for every row, spread over the workers of the thread pool
+template<typename F>
+void for_each_row(uint32_t height, F &&row) {
+    std::atomic<uint32_t> next_row{0u};
+    util::ThreadPool::instance().run([&](uint32_t) {
+        for (auto y = next_row++; y < height; y = next_row++) { row(y); }
+    });
+}
+
+}
+
+void ATrousDenoiser::initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) {
+    Denoiser::initialize(device, param_set);
+    if (!_decode_iterations(param_set)) {
+        LUISA_WARNING("parameter 'iterations' not specified, using default value (5).");
+        _iterations = 5u;
+    }
+    if (!_decode_color_sigma(param_set)) {
+        LUISA_WARNING("parameter 'color_sigma' not specified, using default value (4.0).");
+        _color_sigma = 4.0f;
+    }
+    if (!_decode_normal_sigma(param_set)) {
+        LUISA_WARNING("parameter 'normal_sigma' not specified, using default value (0.2).");
+        _normal_sigma = 0.2f;
+    }
+    if (!_decode_albedo_sigma(param_set)) {
+        LUISA_WARNING("parameter 'albedo_sigma' not specified, using default value (0.1).");
+        _albedo_sigma = 0.1f;
+    }
+}
+
+void ATrousDenoiser::_denoise(math::float4 *colors, const math::packed_float3 *normals, const math::packed_float3 *albedos, math::uint2 size) {
+    
+    // the rows of each plane hold the pixels from margin on, with the border pixels repeated over the margins on both sides;
+    // the vectors of the last pixels spill into the right margin, whose results are never read
+    auto margin = 2u << (_iterations - 1u);
+    auto width = (size.x + 7u) & ~7u;
+    auto stride = width + 2u * margin;
+    auto plane_size = static_cast<size_t>(stride) * size.y;
+    _planes.resize(plane_size * PLANE_COUNT);
+    auto plane = [this, plane_size, stride, margin](uint32_t p, uint32_t y) { return _planes.data() + p * plane_size + y * stride + margin; };
+    auto pad = [plane, size, margin, stride](uint32_t p, uint32_t y) {
+        auto row = plane(p, y);
+        std::fill(row - margin, row, row[0]);
+        std::fill(row + size.x, row + stride - margin, row[size.x - 1u]);
+    };
+    
+    for_each_row(size.y, [&](uint32_t y) {
+        for (auto x = 0u; x < size.x; x++) {
+            auto i = y * size.x + x;
+            math::packed_float3 albedo{albedos[i]};
+            math::packed_float3 normal{normals[i]};
+            for (auto c = 0u; c < 3u; c++) {
+                plane(COLOR_R + c, y)[x] = colors[i][c] / std::max(albedo[c], ATROUS_MIN_ALBEDO);
+                plane(NORMAL_X + c, y)[x] = normal[c];
+                plane(ALBEDO_R + c, y)[x] = albedo[c];
+            }
+        }
+        for (auto p = 0u; p < static_cast<uint32_t>(OUTPUT_R); p++) { pad(p, y); }
+    });
+    
+    auto color_plane = static_cast<uint32_t>(COLOR_R);
+    auto output_plane = static_cast<uint32_t>(OUTPUT_R);
+    for (auto iteration = 0u; iteration < _iterations; iteration++) {
+        
+        auto step = 1u << iteration;
+        auto color_sigma = _color_sigma / static_cast<float>(step);
+        auto inv_color_sigma2 = CPUFloat8::broadcast(-1.0f / (color_sigma * color_sigma));
+        auto inv_normal_sigma2 = CPUFloat8::broadcast(-1.0f / (_normal_sigma * _normal_sigma));
+        auto inv_albedo_sigma2 = CPUFloat8::broadcast(-1.0f / (_albedo_sigma * _albedo_sigma));
+        
+        for_each_row(size.y, [&](uint32_t y) {
+            for (auto x = 0u; x < width; x += 8u) {
+                
+                CPUFloat8 center[9];
+                for (auto c = 0u; c < 3u; c++) {
+                    center[c] = CPUFloat8::load_unaligned(plane(color_plane + c, y) + x);
+                    center[3u + c] = CPUFloat8::load_unaligned(plane(NORMAL_X + c, y) + x);
+                    center[6u + c] = CPUFloat8::load_unaligned(plane(ALBEDO_R + c, y) + x);
+                }
+                
+                auto zero = CPUFloat8::broadcast(0.0f);
+                CPUFloat8 sum[3]{zero, zero, zero};
+                auto weight_sum = zero;
+                for (auto ky = 0u; ky < 5u; ky++) {
+                    auto qy = std::clamp(static_cast<int32_t>(y) + (static_cast<int32_t>(ky) - 2) * static_cast<int32_t>(step), 0, static_cast<int32_t>(size.y) - 1);
+                    for (auto kx = 0u; kx < 5u; kx++) {
+                        auto qx = static_cast<int32_t>(x) + (static_cast<int32_t>(kx) - 2) * static_cast<int32_t>(step);
+                        CPUFloat8 tap[9];
+                        for (auto c = 0u; c < 3u; c++) {
+                            tap[c] = CPUFloat8::load_unaligned(plane(color_plane + c, qy) + qx);
+                            tap[3u + c] = CPUFloat8::load_unaligned(plane(NORMAL_X + c, qy) + qx);
+                            tap[6u + c] = CPUFloat8::load_unaligned(plane(ALBEDO_R + c, qy) + qx);
+                        }
+                        CPUFloat8 distance[3]{zero, zero, zero};
+                        for (auto c = 0u; c < 9u; c++) {
+                            auto d = tap[c] - center[c];
+                            distance[c / 3u] = distance[c / 3u] + d * d;
+                        }
+                        auto exponent = distance[0] * inv_color_sigma2 + distance[1] * inv_normal_sigma2 + distance[2] * inv_albedo_sigma2;
+                        auto weight = CPUFloat8::broadcast(ATROUS_KERNEL[ky] * ATROUS_KERNEL[kx]) * cpu::exp_non_positive(exponent);
+                        for (auto c = 0u; c < 3u; c++) { sum[c] = sum[c] + weight * tap[c]; }
+                        weight_sum = weight_sum + weight;
+                    }
+                }
+                
+                // the center tap keeps a weight of 9/64, so the sum never vanishes
+                auto inv_weight_sum = cpu::reciprocal(weight_sum);
+                for (auto c = 0u; c < 3u; c++) { (sum[c] * inv_weight_sum).store_unaligned(plane(output_plane + c, y) + x); }
+            }
+            for (auto c = 0u; c < 3u; c++) { pad(output_plane + c, y); }
+        });
+        std::swap(color_plane, output_plane);
+    }
+    
+    for_each_row(size.y, [&](uint32_t y) {
+        for (auto x = 0u; x < size.x; x++) {
+            auto i = y * size.x + x;
+            for (auto c = 0u; c < 3u; c++) {
+                colors[i][c] = plane(color_plane + c, y)[x] * std::max(plane(ALBEDO_R + c, y)[x], ATROUS_MIN_ALBEDO);
+            }
+        }
+    });
+}
+
+}
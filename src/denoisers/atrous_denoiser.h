@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <core/denoiser.h>
+
+namespace luisa {
+
+// The edge-avoiding a-trous wavelet filter of Dammertz et al., "Edge-Avoiding A-Trous Wavelet Transform for fast Global
+// Illumination Filtering": iterations() passes of a 5x5 B3-spline kernel with taps 2^i pixels apart, each tap weighted down
+// by its differences in colour, normal and albedo from the center pixel, the colour tolerance halved every pass. Colours
+// are divided by the albedo while filtering, so textures stay sharp. The passes run on eight pixels of a row at a time
+// (see cpu::CPUFloat8) over all the workers of util::ThreadPool.
+DERIVED_CLASS(ATrousDenoiser, Denoiser) {
+
+private:
+    std::vector<float> _planes;  // rows of every channel, padded for the taps reaching out of the image, kept for the next call
+
+protected:
+    PROPERTY(uint32_t, iterations, CoreTypeTag::INTEGER) {
+        if (params.size() != 1 || params[0] <= 0 || params[0] > 10) {
+            THROW_DENOISER_ERROR("expected exactly one integer value between 1 and 10 as a-trous denoiser iterations.");
+        }
+        _iterations = static_cast<uint32_t>(params[0]);
+    }
+    
+    PROPERTY(float, color_sigma, CoreTypeTag::FLOAT) {
+        if (params.size() != 1 || params[0] <= 0.0f) {
+            THROW_DENOISER_ERROR("expected exactly one positive float value as a-trous denoiser colour sigma.");
+        }
+        _color_sigma = params[0];
+    }
+    
+    PROPERTY(float, normal_sigma, CoreTypeTag::FLOAT) {
+        if (params.size() != 1 || params[0] <= 0.0f) {
+            THROW_DENOISER_ERROR("expected exactly one positive float value as a-trous denoiser normal sigma.");
+        }
+        _normal_sigma = params[0];
+    }
+    
+    PROPERTY(float, albedo_sigma, CoreTypeTag::FLOAT) {
+        if (params.size() != 1 || params[0] <= 0.0f) {
+            THROW_DENOISER_ERROR("expected exactly one positive float value as a-trous denoiser albedo sigma.");
+        }
+        _albedo_sigma = params[0];
+    }
+    
+    void _denoise(math::float4 *colors, const math::packed_float3 *normals, const math::packed_float3 *albedos, math::uint2 size) override;
+
+public:
+    CREATOR("ATrous") noexcept { return std::make_shared<ATrousDenoiser>(); }
+    void initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) override;
+};
+
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "atrous_denoiser.h"
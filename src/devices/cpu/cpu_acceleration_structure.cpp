@@ -0,0 +1,780 @@
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+#include <core/ray.h>
+
+#include "cpu_acceleration_structure.h"
+#include "cpu_simd.h"
+#include "cpu_sort.h"
+
+namespace luisa::cpu {
+
+static_assert(sizeof(CPURay) == 32ul && sizeof(RayGeometry) == sizeof(CPURay));
+static_assert(sizeof(Intersection) == 16ul);
+static_assert(sizeof(InstanceIntersection) == 24ul);
+
+namespace {
+
+constexpr auto RAYS_PER_TASK = 256u;
+constexpr auto TRIANGLES_PER_TASK = 16ul * 1024ul;
+constexpr auto PACKET_SIZE = 8u;
+constexpr auto ROUNDING_SCALE = 1.00000024f;  // keeps box tests conservative against rounding
+constexpr auto RAY_KEYS_PER_TASK = 16u * 1024u;
+constexpr auto COHERENCE_ORIGIN_BITS = 7u;  // per axis, below the three sign bits of the direction
+
+// Order in which to visit the rays so that neighbours start close to each other and head the same way: they are keyed by the
+// octant of their direction above the Morton code of their origin, quantized within the bounds of the structure (origins outside
+// fall into the border cells), and radix-sorted. Rays that will not be traced go last.
+template<typename RayAt>
+[[nodiscard]] std::vector<uint32_t> sort_rays_by_coherence(CPUScheduler &scheduler, uint32_t ray_count, const RayAt &ray_at, const CPUBoundingBox &bounds) {
+    constexpr auto max_cell = static_cast<float>((1u << COHERENCE_ORIGIN_BITS) - 1u);
+    math::packed_float3 scale{0.0f};
+    for (auto axis = 0u; axis < 3u; axis++) {
+        if (auto extent = bounds.max[axis] - bounds.min[axis]; extent > 0.0f) { scale[axis] = (max_cell + 1.0f) * (1.0f - 1e-5f) / extent; }
+    }
+    std::vector<uint32_t> keys(ray_count);
+    std::vector<uint32_t> order(ray_count);
+    scheduler.dispatch((ray_count + RAY_KEYS_PER_TASK - 1u) / RAY_KEYS_PER_TASK, CPUSchedulingPolicy::STATIC, [&](uint32_t task) {
+        auto end = std::min((task + 1u) * RAY_KEYS_PER_TASK, ray_count);
+        for (auto i = task * RAY_KEYS_PER_TASK; i < end; i++) {
+            auto &&ray = *ray_at(i);
+            auto key = ~0u;
+            if (ray.max_distance >= 0.0f) {
+                key = 0u;
+                for (auto axis = 0u; axis < 3u; axis++) {
+                    auto cell = std::min(std::max(0.0f, (ray.origin[axis] - bounds.min[axis]) * scale[axis]), max_cell);  // NaN-safe order
+                    key |= spread_morton_bits(static_cast<uint32_t>(cell)) << (2u - axis);
+                    key |= (ray.direction[axis] < 0.0f ? 1u : 0u) << (COHERENCE_ORIGIN_BITS * 3u + axis);
+                }
+            }
+            keys[i] = key;
+            order[i] = i;
+        }
+    });
+    radix_sort(scheduler, keys, order, COHERENCE_ORIGIN_BITS * 3u + 3u);
+    return order;
+}
+
+template<typename Record>
+[[nodiscard]] CPURayStream record_stream(const Buffer &buffer) noexcept {
+    auto records = static_cast<const std::byte *>(buffer.data());
+    return {records, sizeof(Record), records + offsetof(Record, time), sizeof(Record)};
+}
+
+[[nodiscard]] CPURayStream queue_stream(const RayQueue &queue) noexcept {
+    auto pixels = static_cast<const std::byte *>(queue.pixel_buffer().data());
+    auto rays = static_cast<const std::byte *>(queue.geometry_buffer().data());
+    return queue.encoding() == RayEncoding::FULL ?
+           CPURayStream{rays, sizeof(RayGeometry), pixels + offsetof(RayPixel, time), sizeof(RayPixel)} :
+           CPURayStream{rays, sizeof(RayGeometry), pixels + offsetof(CompactRayPixel, time), sizeof(CompactRayPixel)};
+}
+
+[[nodiscard]] inline math::packed_float3 safe_reciprocal(math::packed_float3 d) noexcept {
+    auto safe = [](float x) noexcept { return std::abs(x) < 1e-20f ? std::copysign(1e-20f, x) : x; };
+    return 1.0f / math::packed_float3{safe(d.x), safe(d.y), safe(d.z)};
+}
+
+[[nodiscard]] inline bool intersect_box(const CPUBVHNode &node, math::packed_float3 origin, math::packed_float3 inv_dir,
+                                        float t_min, float t_max, float &t_near) noexcept {
+    auto tx0 = (node.min.x - origin.x) * inv_dir.x;
+    auto tx1 = (node.max.x - origin.x) * inv_dir.x;
+    auto ty0 = (node.min.y - origin.y) * inv_dir.y;
+    auto ty1 = (node.max.y - origin.y) * inv_dir.y;
+    auto tz0 = (node.min.z - origin.z) * inv_dir.z;
+    auto tz1 = (node.max.z - origin.z) * inv_dir.z;
+    t_near = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), t_min));
+    auto t_far = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), t_max));
+    return t_near <= t_far * ROUNDING_SCALE;
+}
+
+// Closest-first traversal of a binary BVH whose nodes are given by node_at(index), so that moving geometry can interpolate
+// them; intersect_primitive(index, t_max) is called for the primitives in the leaves it reaches.
+template<bool any_hit, typename NodeAt, typename IntersectPrimitive>
+[[nodiscard]] bool traverse_bvh(NodeAt &&node_at, const CPURay &ray, IntersectPrimitive &&intersect_primitive) noexcept {
+
+    auto inv_dir = safe_reciprocal(ray.direction);
+    auto t_max = ray.max_distance;
+    auto hit = false;
+
+    struct StackEntry {
+        uint32_t node;
+        float t_near;
+    };
+    StackEntry stack[CPU_BVH_MAX_DEPTH];
+    auto stack_size = 0u;
+    if (float t_near; intersect_box(node_at(0u), ray.origin, inv_dir, ray.min_distance, t_max, t_near)) {
+        stack[stack_size++] = {0u, t_near};
+    }
+
+    while (stack_size != 0u) {
+        auto entry = stack[--stack_size];
+        if (entry.t_near > t_max) { continue; }
+        for (;;) {
+            auto &&node = node_at(entry.node);
+            if (node.count != 0u) {
+                for (auto i = node.index; i < node.index + node.count; i++) {
+                    if (intersect_primitive(i, t_max)) {
+                        hit = true;
+                        if constexpr (any_hit) { return true; }
+                    }
+                }
+                break;
+            }
+            auto first = node.index;
+            auto second = node.index + 1u;
+            auto t_first = 0.0f;
+            auto t_second = 0.0f;
+            auto hit_first = intersect_box(node_at(first), ray.origin, inv_dir, ray.min_distance, t_max, t_first);
+            auto hit_second = intersect_box(node_at(second), ray.origin, inv_dir, ray.min_distance, t_max, t_second);
+            if (hit_first && hit_second) {  // descend into the nearer child first
+                if (t_second < t_first) {
+                    std::swap(first, second);
+                    std::swap(t_first, t_second);
+                }
+                stack[stack_size++] = {second, t_second};
+                entry.node = first;
+            } else if (hit_first) {
+                entry.node = first;
+            } else if (hit_second) {
+                entry.node = second;
+            } else {
+                break;
+            }
+        }
+    }
+    return hit;
+}
+
+}
+
+CPUAccelerationStructure::CPUAccelerationStructure(CPUScheduler &scheduler, Buffer &position_buffer, size_t stride, size_t triangle_count,
+                                                   AccelerationStructureBuildMode build_mode, CPUTraversalMode mode)
+    : _position_buffer{position_buffer}, _stride{stride}, _triangle_count{triangle_count}, _build_mode{build_mode}, _traversal_mode{mode} { _build(scheduler); }
+
+math::packed_float3 CPUAccelerationStructure::_vertex(size_t index) const noexcept {
+    return *reinterpret_cast<const math::packed_float3 *>(static_cast<const std::byte *>(_position_buffer.data()) + index * _stride);
+}
+
+void CPUAccelerationStructure::_gather_triangles(CPUScheduler &scheduler) {
+    _triangles.resize(_triangle_count);
+    auto chunk_count = static_cast<uint32_t>((_triangle_count + TRIANGLES_PER_TASK - 1u) / TRIANGLES_PER_TASK);
+    scheduler.dispatch(chunk_count, CPUSchedulingPolicy::STATIC, [this](uint32_t chunk) {
+        auto end = std::min((chunk + 1ul) * TRIANGLES_PER_TASK, _triangle_count);
+        for (auto i = chunk * TRIANGLES_PER_TASK; i < end; i++) {
+            auto index = _triangle_indices[i];
+            auto v0 = _vertex(index * 3ul);
+            _triangles[i] = {v0, _vertex(index * 3ul + 1ul) - v0, _vertex(index * 3ul + 2ul) - v0};
+        }
+    });
+}
+
+void CPUAccelerationStructure::_build(CPUScheduler &scheduler) {
+
+    std::vector<CPUBoundingBox> bounds(_triangle_count);
+    auto chunk_count = static_cast<uint32_t>((_triangle_count + TRIANGLES_PER_TASK - 1u) / TRIANGLES_PER_TASK);
+    scheduler.dispatch(chunk_count, CPUSchedulingPolicy::STATIC, [this, &bounds](uint32_t chunk) {
+        auto end = std::min((chunk + 1ul) * TRIANGLES_PER_TASK, _triangle_count);
+        for (auto i = chunk * TRIANGLES_PER_TASK; i < end; i++) {
+            for (auto j = 0ul; j < 3ul; j++) { bounds[i].extend(_vertex(i * 3ul + j)); }
+        }
+    });
+    auto bvh = _build_mode == AccelerationStructureBuildMode::SAH ?
+               build_bvh(scheduler, bounds) :
+               build_linear_bvh(scheduler, bounds, _build_mode == AccelerationStructureBuildMode::TRBVH);
+    _wide_nodes = collapse_bvh(bvh, _wide_slot_nodes);
+    _nodes = std::move(bvh.nodes);
+    _triangle_indices = std::move(bvh.primitive_indices);
+    _build_cost = bvh_cost(_nodes);
+    _gather_triangles(scheduler);
+}
+
+void CPUAccelerationStructure::_refit(CPUScheduler &scheduler, float rebuild_cost_ratio) {
+    if (_triangle_count == 0ul) { return; }
+    refit_bvh(scheduler, _nodes, [this](uint32_t first, uint32_t count) noexcept {
+        CPUBoundingBox bounds;
+        for (auto i = first; i < first + count; i++) {
+            for (auto j = 0ul; j < 3ul; j++) { bounds.extend(_vertex(_triangle_indices[i] * 3ul + j)); }
+        }
+        return bounds;
+    });
+    if (rebuild_cost_ratio > 0.0f && bvh_cost(_nodes) > rebuild_cost_ratio * _build_cost) {
+        _build(scheduler);
+        return;
+    }
+    refit_wide_bvh(scheduler, _wide_nodes, _wide_slot_nodes, _nodes);
+    _gather_triangles(scheduler);
+}
+
+void CPUAccelerationStructure::refit(KernelDispatcher &dispatch, float rebuild_cost_ratio) {
+    auto &&dispatcher = dynamic_cast<CPUKernelDispatcher &>(dispatch);
+    dispatcher.enqueue([this, &dispatcher, rebuild_cost_ratio] { _refit(dispatcher.scheduler(), rebuild_cost_ratio); });
+}
+
+bool CPUAccelerationStructure::_intersect_triangle(const CPURay &ray, uint32_t index, float &t_max, Intersection &intersection) const noexcept {
+    auto &&triangle = _triangles[index];
+    auto p = math::cross(ray.direction, triangle.e2);
+    auto det = math::dot(triangle.e1, p);
+    if (std::abs(det) < 1e-12f) { return false; }
+    auto inv_det = 1.0f / det;
+    auto s = ray.origin - triangle.v0;
+    auto u = math::dot(s, p) * inv_det;
+    if (u < 0.0f || u > 1.0f) { return false; }
+    auto q = math::cross(s, triangle.e1);
+    auto v = math::dot(ray.direction, q) * inv_det;
+    if (v < 0.0f || u + v > 1.0f) { return false; }
+    auto t = math::dot(triangle.e2, q) * inv_det;
+    if (t < ray.min_distance || t > t_max) { return false; }
+    t_max = t;
+    intersection.distance = t;
+    intersection.triangle_index = _triangle_indices[index];
+    intersection.barycentric = math::float2{1.0f - u - v, u};
+    return true;
+}
+
+CPUBoundingBox CPUAccelerationStructure::bounds() const noexcept {
+    if (_nodes.empty()) { return {}; }
+    return {_nodes.front().min, _nodes.front().max};
+}
+
+template<bool any_hit>
+bool CPUAccelerationStructure::intersect(const CPURay &ray, CPUTraversalMode mode, Intersection &intersection) const noexcept {
+    if (_triangles.empty()) { return false; }
+    return mode == CPUTraversalMode::SCALAR ? _intersect_scalar<any_hit>(ray, intersection) : _intersect_wide<any_hit>(ray, intersection);
+}
+
+template<bool any_hit>
+bool CPUAccelerationStructure::_intersect_scalar(const CPURay &ray, Intersection &intersection) const noexcept {
+    auto node_at = [this](uint32_t index) noexcept -> const CPUBVHNode & { return _nodes[index]; };
+    return traverse_bvh<any_hit>(node_at, ray, [&](uint32_t index, float &t_max) noexcept {
+        return _intersect_triangle(ray, index, t_max, intersection);
+    });
+}
+
+template<bool any_hit, typename Float8>
+bool CPUAccelerationStructure::_traverse_wide(const CPURay &ray, Intersection &intersection) const noexcept {
+
+    using CPUFloat8 = Float8;
+    auto inv_dir = safe_reciprocal(ray.direction);
+    auto inv_x = CPUFloat8::broadcast(inv_dir.x);
+    auto inv_y = CPUFloat8::broadcast(inv_dir.y);
+    auto inv_z = CPUFloat8::broadcast(inv_dir.z);
+    auto o_x = CPUFloat8::broadcast(ray.origin.x);
+    auto o_y = CPUFloat8::broadcast(ray.origin.y);
+    auto o_z = CPUFloat8::broadcast(ray.origin.z);
+    auto t_min = CPUFloat8::broadcast(ray.min_distance);
+    auto rounding_scale = CPUFloat8::broadcast(ROUNDING_SCALE);
+    auto infinity = CPUFloat8::broadcast(std::numeric_limits<float>::infinity());
+    auto t_max = ray.max_distance;
+    auto hit = false;
+
+    // leaves are pushed as well, so that children are visited strictly front to back
+    struct StackEntry {
+        uint32_t index;
+        uint32_t count;
+        float t_near;
+    };
+    StackEntry stack[CPU_BVH_MAX_DEPTH * 7u + 1u];
+    auto stack_size = 0u;
+    stack[stack_size++] = {0u, 0u, ray.min_distance};
+
+    while (stack_size != 0u) {
+        auto entry = stack[--stack_size];
+        if (entry.t_near > t_max) { continue; }
+        if (entry.count != 0u) {
+            for (auto i = entry.index; i < entry.index + entry.count; i++) {
+                if (_intersect_triangle(ray, i, t_max, intersection)) {
+                    hit = true;
+                    if constexpr (any_hit) { return true; }
+                }
+            }
+            continue;
+        }
+        auto &&node = _wide_nodes[entry.index];
+        auto tx0 = (CPUFloat8::load(node.min_x) - o_x) * inv_x;
+        auto tx1 = (CPUFloat8::load(node.max_x) - o_x) * inv_x;
+        auto ty0 = (CPUFloat8::load(node.min_y) - o_y) * inv_y;
+        auto ty1 = (CPUFloat8::load(node.max_y) - o_y) * inv_y;
+        auto tz0 = (CPUFloat8::load(node.min_z) - o_z) * inv_z;
+        auto tz1 = (CPUFloat8::load(node.max_z) - o_z) * inv_z;
+        auto t_near = max(max(min(tx0, tx1), min(ty0, ty1)), max(min(tz0, tz1), t_min));
+        auto t_far = min(min(max(tx0, tx1), max(ty0, ty1)), min(max(tz0, tz1), CPUFloat8::broadcast(t_max)));
+        // the boxes of empty slots are at infinity, which rays without a maximum distance would otherwise reach
+        auto mask = ((t_near <= t_far * rounding_scale) & (t_near < infinity)).bits();
+        if (mask == 0u) { continue; }
+
+        alignas(32) float distances[8];
+        t_near.store(distances);
+        auto first = stack_size;
+        for (; mask != 0u; mask &= mask - 1u) {  // keep the hit children sorted with the nearest one on top
+            auto i = static_cast<uint32_t>(__builtin_ctz(mask));
+            StackEntry child{node.children[i], node.counts[i], distances[i]};
+            auto j = stack_size++;
+            for (; j > first && stack[j - 1u].t_near < child.t_near; j--) { stack[j] = stack[j - 1u]; }
+            stack[j] = child;
+        }
+    }
+    return hit;
+}
+
+template<bool any_hit, typename Float8>
+void CPUAccelerationStructure::_traverse_packet(const CPURay *const *rays, uint32_t ray_count, Intersection *intersections) const noexcept {
+
+    using CPUFloat8 = Float8;
+    using CPUBool8 = typename Float8::Mask;
+    alignas(32) float origin_x[PACKET_SIZE]{};
+    alignas(32) float origin_y[PACKET_SIZE]{};
+    alignas(32) float origin_z[PACKET_SIZE]{};
+    alignas(32) float direction_x[PACKET_SIZE]{};
+    alignas(32) float direction_y[PACKET_SIZE]{};
+    alignas(32) float direction_z[PACKET_SIZE]{};
+    alignas(32) float inv_direction_x[PACKET_SIZE]{};
+    alignas(32) float inv_direction_y[PACKET_SIZE]{};
+    alignas(32) float inv_direction_z[PACKET_SIZE]{};
+    alignas(32) float min_distance[PACKET_SIZE]{};
+    alignas(32) float max_distance[PACKET_SIZE]{};
+
+    auto active = 0u;
+    for (auto i = 0u; i < PACKET_SIZE; i++) {
+        auto &&ray = i < ray_count ? *rays[i] : CPURay{{}, 0.0f, math::packed_float3{1.0f}, -1.0f};
+        auto inv_dir = safe_reciprocal(ray.direction);
+        origin_x[i] = ray.origin.x;
+        origin_y[i] = ray.origin.y;
+        origin_z[i] = ray.origin.z;
+        direction_x[i] = ray.direction.x;
+        direction_y[i] = ray.direction.y;
+        direction_z[i] = ray.direction.z;
+        inv_direction_x[i] = inv_dir.x;
+        inv_direction_y[i] = inv_dir.y;
+        inv_direction_z[i] = inv_dir.z;
+        min_distance[i] = ray.min_distance;
+        max_distance[i] = ray.max_distance;
+        if (ray.max_distance >= 0.0f) { active |= 1u << i; }
+    }
+
+    auto o_x = CPUFloat8::load(origin_x);
+    auto o_y = CPUFloat8::load(origin_y);
+    auto o_z = CPUFloat8::load(origin_z);
+    auto d_x = CPUFloat8::load(direction_x);
+    auto d_y = CPUFloat8::load(direction_y);
+    auto d_z = CPUFloat8::load(direction_z);
+    auto inv_x = CPUFloat8::load(inv_direction_x);
+    auto inv_y = CPUFloat8::load(inv_direction_y);
+    auto inv_z = CPUFloat8::load(inv_direction_z);
+    auto t_min = CPUFloat8::load(min_distance);
+    auto t_max = CPUFloat8::load(max_distance);
+    auto rounding_scale = CPUFloat8::broadcast(ROUNDING_SCALE);
+    auto zero = CPUFloat8::broadcast(0.0f);
+    auto one = CPUFloat8::broadcast(1.0f);
+    auto epsilon = CPUFloat8::broadcast(1e-12f);
+
+    uint32_t stack[CPU_BVH_MAX_DEPTH + 1u];
+    auto stack_size = 0u;
+    stack[stack_size++] = 0u;
+
+    while (stack_size != 0u && active != 0u) {
+
+        auto &&node = _nodes[stack[--stack_size]];
+        auto tx0 = (CPUFloat8::broadcast(node.min.x) - o_x) * inv_x;
+        auto tx1 = (CPUFloat8::broadcast(node.max.x) - o_x) * inv_x;
+        auto ty0 = (CPUFloat8::broadcast(node.min.y) - o_y) * inv_y;
+        auto ty1 = (CPUFloat8::broadcast(node.max.y) - o_y) * inv_y;
+        auto tz0 = (CPUFloat8::broadcast(node.min.z) - o_z) * inv_z;
+        auto tz1 = (CPUFloat8::broadcast(node.max.z) - o_z) * inv_z;
+        auto t_near = max(max(min(tx0, tx1), min(ty0, ty1)), max(min(tz0, tz1), t_min));
+        auto t_far = min(min(max(tx0, tx1), max(ty0, ty1)), min(max(tz0, tz1), t_max));
+        auto lanes = (t_near <= t_far * rounding_scale).bits() & active;
+        if (lanes == 0u) { continue; }
+
+        if (node.count == 0u) {  // push the child lying ahead along the first active ray last, so it is visited first
+            auto lane = static_cast<uint32_t>(__builtin_ctz(lanes));
+            auto &&first = _nodes[node.index];
+            auto &&second = _nodes[node.index + 1u];
+            auto offset = (second.min + second.max) - (first.min + first.max);
+            auto second_ahead = offset.x * direction_x[lane] + offset.y * direction_y[lane] + offset.z * direction_z[lane] < 0.0f;
+            stack[stack_size++] = second_ahead ? node.index : node.index + 1u;
+            stack[stack_size++] = second_ahead ? node.index + 1u : node.index;
+            continue;
+        }
+
+        auto lane_mask = CPUBool8::from_bits(lanes);
+        for (auto i = node.index; i < node.index + node.count; i++) {
+            auto &&triangle = _triangles[i];
+            auto e1_x = CPUFloat8::broadcast(triangle.e1.x);
+            auto e1_y = CPUFloat8::broadcast(triangle.e1.y);
+            auto e1_z = CPUFloat8::broadcast(triangle.e1.z);
+            auto e2_x = CPUFloat8::broadcast(triangle.e2.x);
+            auto e2_y = CPUFloat8::broadcast(triangle.e2.y);
+            auto e2_z = CPUFloat8::broadcast(triangle.e2.z);
+            auto p_x = d_y * e2_z - d_z * e2_y;
+            auto p_y = d_z * e2_x - d_x * e2_z;
+            auto p_z = d_x * e2_y - d_y * e2_x;
+            auto det = e1_x * p_x + e1_y * p_y + e1_z * p_z;
+            auto inv_det = reciprocal(det);
+            auto s_x = o_x - CPUFloat8::broadcast(triangle.v0.x);
+            auto s_y = o_y - CPUFloat8::broadcast(triangle.v0.y);
+            auto s_z = o_z - CPUFloat8::broadcast(triangle.v0.z);
+            auto u = (s_x * p_x + s_y * p_y + s_z * p_z) * inv_det;
+            auto q_x = s_y * e1_z - s_z * e1_y;
+            auto q_y = s_z * e1_x - s_x * e1_z;
+            auto q_z = s_x * e1_y - s_y * e1_x;
+            auto v = (d_x * q_x + d_y * q_y + d_z * q_z) * inv_det;
+            auto t = (e2_x * q_x + e2_y * q_y + e2_z * q_z) * inv_det;
+            auto hit_mask = lane_mask & (abs(det) >= epsilon) & (u >= zero) & (v >= zero) & (u + v <= one) & (t >= t_min) & (t <= t_max);
+            auto hits = hit_mask.bits();
+            if (hits == 0u) { continue; }
+            t_max = select(hit_mask, t, t_max);
+            alignas(32) float distances[PACKET_SIZE];
+            alignas(32) float barycentric_u[PACKET_SIZE];
+            alignas(32) float barycentric_v[PACKET_SIZE];
+            t.store(distances);
+            u.store(barycentric_u);
+            v.store(barycentric_v);
+            for (auto bits = hits; bits != 0u; bits &= bits - 1u) {
+                auto lane = static_cast<uint32_t>(__builtin_ctz(bits));
+                intersections[lane] = {distances[lane], _triangle_indices[i],
+                                       math::float2{1.0f - barycentric_u[lane] - barycentric_v[lane], barycentric_u[lane]}};
+            }
+            if constexpr (any_hit) {  // rays that found an occluder leave the packet
+                active &= ~hits;
+                lanes &= ~hits;
+                if (lanes == 0u) { break; }
+                lane_mask = CPUBool8::from_bits(lanes);
+            }
+        }
+    }
+}
+
+#ifdef LUISA_CPU_AVX2_AVAILABLE
+
+// flattened, so that the traversals and the lane operations they call are all compiled for AVX2 in here
+template<bool any_hit>
+[[gnu::flatten]] bool CPUAccelerationStructure::_intersect_wide_avx2(const CPURay &ray, Intersection &intersection) const noexcept {
+    return _traverse_wide<any_hit, avx2::CPUFloat8>(ray, intersection);
+}
+
+template<bool any_hit>
+[[gnu::flatten]] void CPUAccelerationStructure::_intersect_packet_avx2(const CPURay *const *rays, uint32_t ray_count, Intersection *intersections) const noexcept {
+    _traverse_packet<any_hit, avx2::CPUFloat8>(rays, ray_count, intersections);
+}
+
+#endif
+
+template<bool any_hit>
+bool CPUAccelerationStructure::_intersect_wide(const CPURay &ray, Intersection &intersection) const noexcept {
+#ifdef LUISA_CPU_AVX2_AVAILABLE
+    if (cpu_has_avx2()) { return _intersect_wide_avx2<any_hit>(ray, intersection); }
+#endif
+    return _traverse_wide<any_hit, portable::CPUFloat8>(ray, intersection);
+}
+
+template<bool any_hit>
+void CPUAccelerationStructure::_intersect_packet(const CPURay *const *rays, uint32_t ray_count, Intersection *intersections) const noexcept {
+#ifdef LUISA_CPU_AVX2_AVAILABLE
+    if (cpu_has_avx2()) {
+        _intersect_packet_avx2<any_hit>(rays, ray_count, intersections);
+        return;
+    }
+#endif
+    _traverse_packet<any_hit, portable::CPUFloat8>(rays, ray_count, intersections);
+}
+
+template<bool any_hit>
+void CPUAccelerationStructure::_trace(CPUKernelDispatcher &dispatcher, CPUTraversalMode mode, uint32_t sort_threshold,
+                                      CPURayStream rays, Buffer &intersection_buffer, uint32_t ray_count) const {
+    using Output = std::conditional_t<any_hit, ShadowIntersection, Intersection>;
+    auto outputs = static_cast<Output *>(intersection_buffer.data());
+    auto ray_at = [&rays](uint32_t index) noexcept { return &rays.ray(index); };
+    auto store = [outputs](uint32_t index, const Intersection &intersection) noexcept {
+        if constexpr (any_hit) { outputs[index] = {intersection.distance}; } else { outputs[index] = intersection; }
+    };
+    std::vector<uint32_t> order;
+    if (!any_hit && ray_count > sort_threshold) { order = sort_rays_by_coherence(dispatcher.scheduler(), ray_count, ray_at, bounds()); }
+    auto ray_index = [&order](uint32_t i) noexcept { return order.empty() ? i : order[i]; };
+    dispatcher.parallel_for((ray_count + RAYS_PER_TASK - 1u) / RAYS_PER_TASK, [&](uint32_t task) {
+        auto begin = task * RAYS_PER_TASK;
+        auto end = std::min(begin + RAYS_PER_TASK, ray_count);
+        if (mode == CPUTraversalMode::PACKET) {
+            for (auto first = begin; first < end; first += PACKET_SIZE) {
+                auto count = std::min(end - first, PACKET_SIZE);
+                const CPURay *packet[PACKET_SIZE];
+                Intersection intersections[PACKET_SIZE];
+                for (auto i = 0u; i < count; i++) {
+                    packet[i] = ray_at(ray_index(first + i));
+                    intersections[i].distance = -1.0f;
+                }
+                if (!_triangles.empty()) { _intersect_packet<any_hit>(packet, count, intersections); }
+                for (auto i = 0u; i < count; i++) { store(ray_index(first + i), intersections[i]); }
+            }
+        } else {
+            for (auto i = begin; i < end; i++) {
+                auto index = ray_index(i);
+                auto &&ray = *ray_at(index);
+                Intersection intersection{};
+                auto hit = !_triangles.empty() && ray.max_distance >= 0.0f &&
+                           (mode == CPUTraversalMode::WIDE ? _intersect_wide<any_hit>(ray, intersection) : _intersect_scalar<any_hit>(ray, intersection));
+                if (!hit) { intersection.distance = -1.0f; }
+                store(index, intersection);
+            }
+        }
+    });
+}
+
+void CPUAccelerationStructure::trace_any(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, size_t ray_count) {
+    auto &&dispatcher = dynamic_cast<CPUKernelDispatcher &>(dispatch);
+    dispatcher.enqueue([this, &dispatcher, mode = _traversal_mode, sort_threshold = _coherence_sort_threshold, &ray_buffer, &intersection_buffer, ray_count] {
+        _trace<true>(dispatcher, mode, sort_threshold, record_stream<ShadowRay>(ray_buffer), intersection_buffer, static_cast<uint32_t>(ray_count));
+    });
+}
+
+void CPUAccelerationStructure::trace_nearest(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, size_t ray_count) {
+    auto &&dispatcher = dynamic_cast<CPUKernelDispatcher &>(dispatch);
+    dispatcher.enqueue([this, &dispatcher, mode = _traversal_mode, sort_threshold = _coherence_sort_threshold, &ray_buffer, &intersection_buffer, ray_count] {
+        _trace<false>(dispatcher, mode, sort_threshold, record_stream<Ray>(ray_buffer), intersection_buffer, static_cast<uint32_t>(ray_count));
+    });
+}
+
+// the ray count is read when the command executes, after the kernels encoded before it have written it
+void CPUAccelerationStructure::trace_any(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) {
+    auto &&dispatcher = dynamic_cast<CPUKernelDispatcher &>(dispatch);
+    dispatcher.enqueue([this, &dispatcher, mode = _traversal_mode, sort_threshold = _coherence_sort_threshold, &ray_buffer, &intersection_buffer, &ray_count_buffer, ray_count_buffer_offset] {
+        auto ray_count = *reinterpret_cast<const uint32_t *>(static_cast<const std::byte *>(ray_count_buffer.data()) + ray_count_buffer_offset);
+        _trace<true>(dispatcher, mode, sort_threshold, record_stream<ShadowRay>(ray_buffer), intersection_buffer, ray_count);
+    });
+}
+
+void CPUAccelerationStructure::trace_nearest(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) {
+    auto &&dispatcher = dynamic_cast<CPUKernelDispatcher &>(dispatch);
+    dispatcher.enqueue([this, &dispatcher, mode = _traversal_mode, sort_threshold = _coherence_sort_threshold, &ray_buffer, &intersection_buffer, &ray_count_buffer, ray_count_buffer_offset] {
+        auto ray_count = *reinterpret_cast<const uint32_t *>(static_cast<const std::byte *>(ray_count_buffer.data()) + ray_count_buffer_offset);
+        _trace<false>(dispatcher, mode, sort_threshold, record_stream<Ray>(ray_buffer), intersection_buffer, ray_count);
+    });
+}
+
+void CPUAccelerationStructure::trace_any(KernelDispatcher &dispatch, RayQueue &ray_queue, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) {
+    auto &&dispatcher = dynamic_cast<CPUKernelDispatcher &>(dispatch);
+    dispatcher.enqueue([this, &dispatcher, mode = _traversal_mode, sort_threshold = _coherence_sort_threshold, &ray_queue, &intersection_buffer, &ray_count_buffer, ray_count_buffer_offset] {
+        auto ray_count = *reinterpret_cast<const uint32_t *>(static_cast<const std::byte *>(ray_count_buffer.data()) + ray_count_buffer_offset);
+        _trace<true>(dispatcher, mode, sort_threshold, queue_stream(ray_queue), intersection_buffer, ray_count);
+    });
+}
+
+void CPUAccelerationStructure::trace_nearest(KernelDispatcher &dispatch, RayQueue &ray_queue, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) {
+    auto &&dispatcher = dynamic_cast<CPUKernelDispatcher &>(dispatch);
+    dispatcher.enqueue([this, &dispatcher, mode = _traversal_mode, sort_threshold = _coherence_sort_threshold, &ray_queue, &intersection_buffer, &ray_count_buffer, ray_count_buffer_offset] {
+        auto ray_count = *reinterpret_cast<const uint32_t *>(static_cast<const std::byte *>(ray_count_buffer.data()) + ray_count_buffer_offset);
+        _trace<false>(dispatcher, mode, sort_threshold, queue_stream(ray_queue), intersection_buffer, ray_count);
+    });
+}
+
+CPUInstanceAccelerationStructure::CPUInstanceAccelerationStructure(CPUScheduler &scheduler, std::vector<std::shared_ptr<CPUAccelerationStructure>> meshes,
+                                                                   Buffer &mesh_index_buffer, Buffer &transform_buffer, size_t instance_count,
+                                                                   uint32_t keyframe_count, float shutter_open, float shutter_close, CPUTraversalMode mode)
+    : _meshes{std::move(meshes)}, _mesh_index_buffer{mesh_index_buffer}, _transform_buffer{transform_buffer}, _instance_count{instance_count},
+      _keyframe_count{keyframe_count}, _shutter_open{shutter_open}, _shutter_close{shutter_close}, _traversal_mode{mode} { _build(scheduler); }
+
+void CPUInstanceAccelerationStructure::_build(CPUScheduler &scheduler) {
+
+    auto instance_count = _instance_count;
+    auto mesh_indices = static_cast<const uint32_t *>(_mesh_index_buffer.data());
+    auto transforms = static_cast<const math::float4x4 *>(_transform_buffer.data());
+    for (auto i = 0ul; i < instance_count; i++) {
+        if (mesh_indices[i] >= _meshes.size()) {
+            THROW_DEVICE_ERROR("instance #", i, " references mesh #", mesh_indices[i], ", but only ", _meshes.size(), " meshes are given.");
+        }
+    }
+
+    // Within a keyframe interval every point of an instance moves linearly, so its bounds at any time are contained in the
+    // interpolation of the bounds at the keyframes. Open and close bounds are fitted to contain those at all keyframes.
+    std::vector<CPUBoundingBox> open_bounds(instance_count);
+    std::vector<CPUBoundingBox> close_bounds(instance_count);
+    std::vector<CPUBoundingBox> swept_bounds(instance_count);
+    for (auto i = 0ul; i < instance_count; i++) {
+        auto mesh_bounds = _meshes[mesh_indices[i]]->bounds();
+        if (mesh_bounds.empty()) { continue; }
+        std::vector<CPUBoundingBox> keyframe_bounds(_keyframe_count);
+        for (auto k = 0u; k < _keyframe_count; k++) {
+            for (auto corner = 0u; corner < 8u; corner++) {
+                math::float4 p{(corner & 1u) ? mesh_bounds.max.x : mesh_bounds.min.x,
+                               (corner & 2u) ? mesh_bounds.max.y : mesh_bounds.min.y,
+                               (corner & 4u) ? mesh_bounds.max.z : mesh_bounds.min.z, 1.0f};
+                auto q = transforms[i * _keyframe_count + k] * p;
+                keyframe_bounds[k].extend(math::packed_float3{q.x, q.y, q.z});
+            }
+        }
+        auto &&first = keyframe_bounds.front();
+        auto &&last = keyframe_bounds.back();
+        for (auto axis = 0; axis < 3; axis++) {
+            auto lower_slack = 0.0f;
+            auto upper_slack = 0.0f;
+            for (auto k = 1u; k + 1u < _keyframe_count; k++) {
+                auto t = static_cast<float>(k) / static_cast<float>(_keyframe_count - 1u);
+                lower_slack = std::max(lower_slack, first.min[axis] + (last.min[axis] - first.min[axis]) * t - keyframe_bounds[k].min[axis]);
+                upper_slack = std::max(upper_slack, keyframe_bounds[k].max[axis] - first.max[axis] - (last.max[axis] - first.max[axis]) * t);
+            }
+            open_bounds[i].min[axis] = first.min[axis] - lower_slack;
+            open_bounds[i].max[axis] = first.max[axis] + upper_slack;
+            close_bounds[i].min[axis] = last.min[axis] - lower_slack;
+            close_bounds[i].max[axis] = last.max[axis] + upper_slack;
+        }
+        swept_bounds[i] = open_bounds[i];
+        swept_bounds[i].extend(close_bounds[i]);
+    }
+    auto bvh = build_bvh(scheduler, swept_bounds);
+    _nodes = std::move(bvh.nodes);
+    _instance_indices = std::move(bvh.primitive_indices);
+
+    _instances.resize(instance_count);
+    for (auto i = 0ul; i < instance_count; i++) {
+        auto index = _instance_indices[i];
+        _instances[i] = {math::inverse(transforms[index * _keyframe_count]), mesh_indices[index]};
+    }
+    if (!_moving()) { return; }
+
+    _object_to_world.resize(instance_count * _keyframe_count);
+    for (auto i = 0ul; i < instance_count; i++) {
+        auto first = transforms + _instance_indices[i] * _keyframe_count;
+        std::copy(first, first + _keyframe_count, _object_to_world.begin() + i * _keyframe_count);
+    }
+
+    // children are always allocated after their parents, so a backward sweep sees them first
+    _close_bounds.resize(_nodes.size());
+    for (auto i = _nodes.size(); i-- != 0ul;) {
+        auto &&node = _nodes[i];
+        CPUBoundingBox open;
+        CPUBoundingBox close;
+        if (node.count != 0u) {
+            for (auto j = node.index; j < node.index + node.count; j++) {
+                open.extend(open_bounds[_instance_indices[j]]);
+                close.extend(close_bounds[_instance_indices[j]]);
+            }
+        } else {
+            open.extend(CPUBoundingBox{_nodes[node.index].min, _nodes[node.index].max});
+            open.extend(CPUBoundingBox{_nodes[node.index + 1u].min, _nodes[node.index + 1u].max});
+            close.extend(_close_bounds[node.index]);
+            close.extend(_close_bounds[node.index + 1u]);
+        }
+        node.min = open.min;
+        node.max = open.max;
+        _close_bounds[i] = close;
+    }
+}
+
+void CPUInstanceAccelerationStructure::refit(KernelDispatcher &dispatch, float rebuild_cost_ratio [[maybe_unused]]) {
+    auto &&dispatcher = dynamic_cast<CPUKernelDispatcher &>(dispatch);
+    dispatcher.enqueue([this, &dispatcher] { _build(dispatcher.scheduler()); });
+}
+
+template<bool any_hit, bool moving>
+bool CPUInstanceAccelerationStructure::_intersect(const CPURay &ray, float time, CPUTraversalMode mode, InstanceIntersection &intersection) const noexcept {
+
+    auto shutter_time = 0.0f;  // in [0, 1] over the shutter interval
+    if constexpr (moving) { shutter_time = std::clamp((time - _shutter_open) / (_shutter_close - _shutter_open), 0.0f, 1.0f); }
+
+    auto node_at = [this, shutter_time](uint32_t index) noexcept -> std::conditional_t<moving, CPUBVHNode, const CPUBVHNode &> {
+        if constexpr (moving) {
+            auto &&node = _nodes[index];
+            auto &&close = _close_bounds[index];
+            return CPUBVHNode{node.min + (close.min - node.min) * shutter_time, node.index,
+                              node.max + (close.max - node.max) * shutter_time, node.count};
+        } else {
+            return _nodes[index];
+        }
+    };
+
+    auto world_to_object = [this, shutter_time](uint32_t index) noexcept -> std::conditional_t<moving, math::float4x4, const math::float4x4 &> {
+        if constexpr (moving) {
+            auto keyframe = shutter_time * static_cast<float>(_keyframe_count - 1u);
+            auto k = std::min(static_cast<uint32_t>(keyframe), _keyframe_count - 2u);
+            auto f = keyframe - static_cast<float>(k);
+            return math::inverse(_object_to_world[index * _keyframe_count + k] * (1.0f - f) + _object_to_world[index * _keyframe_count + k + 1u] * f);
+        } else {
+            return _instances[index].world_to_object;
+        }
+    };
+
+    return traverse_bvh<any_hit>(node_at, ray, [&](uint32_t index, float &t_max) noexcept {
+        auto &&m = world_to_object(index);
+        auto o = m * math::float4{ray.origin, 1.0f};
+        auto d = m * math::float4{ray.direction, 0.0f};
+        CPURay object_ray{{o.x, o.y, o.z}, ray.min_distance, {d.x, d.y, d.z}, t_max};  // direction left unnormalized to keep distances
+        Intersection hit{};
+        if (!_meshes[_instances[index].mesh_index]->intersect<any_hit>(object_ray, mode, hit)) { return false; }
+        t_max = hit.distance;
+        intersection = {hit.distance, hit.triangle_index, _instance_indices[index], hit.barycentric};
+        return true;
+    });
+}
+
+template<bool any_hit>
+void CPUInstanceAccelerationStructure::_trace(CPUKernelDispatcher &dispatcher, CPUTraversalMode mode, uint32_t sort_threshold,
+                                              CPURayStream rays, Buffer &intersection_buffer, uint32_t ray_count) const {
+    using Output = std::conditional_t<any_hit, ShadowIntersection, InstanceIntersection>;
+    auto outputs = static_cast<Output *>(intersection_buffer.data());
+    std::vector<uint32_t> order;
+    if (!any_hit && ray_count > sort_threshold && !_nodes.empty()) {
+        auto ray_at = [&rays](uint32_t index) noexcept { return &rays.ray(index); };
+        order = sort_rays_by_coherence(dispatcher.scheduler(), ray_count, ray_at, CPUBoundingBox{_nodes.front().min, _nodes.front().max});
+    }
+    dispatcher.parallel_for((ray_count + RAYS_PER_TASK - 1u) / RAYS_PER_TASK, [&](uint32_t task) {
+        auto end = std::min((task + 1u) * RAYS_PER_TASK, ray_count);
+        for (auto t = task * RAYS_PER_TASK; t < end; t++) {
+            auto i = order.empty() ? t : order[t];
+            auto &&ray = rays.ray(i);
+            auto time = rays.time(i);
+            InstanceIntersection intersection{};
+            auto hit = !_nodes.empty() && ray.max_distance >= 0.0f &&
+                       (_moving() ? _intersect<any_hit, true>(ray, time, mode, intersection) : _intersect<any_hit, false>(ray, time, mode, intersection));
+            if (!hit) { intersection.distance = -1.0f; }
+            if constexpr (any_hit) { outputs[i] = {intersection.distance}; } else { outputs[i] = intersection; }
+        }
+    });
+}
+
+void CPUInstanceAccelerationStructure::trace_any(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, size_t ray_count) {
+    auto &&dispatcher = dynamic_cast<CPUKernelDispatcher &>(dispatch);
+    dispatcher.enqueue([this, &dispatcher, mode = _traversal_mode, sort_threshold = _coherence_sort_threshold, &ray_buffer, &intersection_buffer, ray_count] {
+        _trace<true>(dispatcher, mode, sort_threshold, record_stream<ShadowRay>(ray_buffer), intersection_buffer, static_cast<uint32_t>(ray_count));
+    });
+}
+
+void CPUInstanceAccelerationStructure::trace_nearest(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, size_t ray_count) {
+    auto &&dispatcher = dynamic_cast<CPUKernelDispatcher &>(dispatch);
+    dispatcher.enqueue([this, &dispatcher, mode = _traversal_mode, sort_threshold = _coherence_sort_threshold, &ray_buffer, &intersection_buffer, ray_count] {
+        _trace<false>(dispatcher, mode, sort_threshold, record_stream<Ray>(ray_buffer), intersection_buffer, static_cast<uint32_t>(ray_count));
+    });
+}
+
+void CPUInstanceAccelerationStructure::trace_any(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) {
+    auto &&dispatcher = dynamic_cast<CPUKernelDispatcher &>(dispatch);
+    dispatcher.enqueue([this, &dispatcher, mode = _traversal_mode, sort_threshold = _coherence_sort_threshold, &ray_buffer, &intersection_buffer, &ray_count_buffer, ray_count_buffer_offset] {
+        auto ray_count = *reinterpret_cast<const uint32_t *>(static_cast<const std::byte *>(ray_count_buffer.data()) + ray_count_buffer_offset);
+        _trace<true>(dispatcher, mode, sort_threshold, record_stream<ShadowRay>(ray_buffer), intersection_buffer, ray_count);
+    });
+}
+
+void CPUInstanceAccelerationStructure::trace_nearest(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) {
+    auto &&dispatcher = dynamic_cast<CPUKernelDispatcher &>(dispatch);
+    dispatcher.enqueue([this, &dispatcher, mode = _traversal_mode, sort_threshold = _coherence_sort_threshold, &ray_buffer, &intersection_buffer, &ray_count_buffer, ray_count_buffer_offset] {
+        auto ray_count = *reinterpret_cast<const uint32_t *>(static_cast<const std::byte *>(ray_count_buffer.data()) + ray_count_buffer_offset);
+        _trace<false>(dispatcher, mode, sort_threshold, record_stream<Ray>(ray_buffer), intersection_buffer, ray_count);
+    });
+}
+
+void CPUInstanceAccelerationStructure::trace_any(KernelDispatcher &dispatch, RayQueue &ray_queue, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) {
+    auto &&dispatcher = dynamic_cast<CPUKernelDispatcher &>(dispatch);
+    dispatcher.enqueue([this, &dispatcher, mode = _traversal_mode, sort_threshold = _coherence_sort_threshold, &ray_queue, &intersection_buffer, &ray_count_buffer, ray_count_buffer_offset] {
+        auto ray_count = *reinterpret_cast<const uint32_t *>(static_cast<const std::byte *>(ray_count_buffer.data()) + ray_count_buffer_offset);
+        _trace<true>(dispatcher, mode, sort_threshold, queue_stream(ray_queue), intersection_buffer, ray_count);
+    });
+}
+
+void CPUInstanceAccelerationStructure::trace_nearest(KernelDispatcher &dispatch, RayQueue &ray_queue, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) {
+    auto &&dispatcher = dynamic_cast<CPUKernelDispatcher &>(dispatch);
+    dispatcher.enqueue([this, &dispatcher, mode = _traversal_mode, sort_threshold = _coherence_sort_threshold, &ray_queue, &intersection_buffer, &ray_count_buffer, ray_count_buffer_offset] {
+        auto ray_count = *reinterpret_cast<const uint32_t *>(static_cast<const std::byte *>(ray_count_buffer.data()) + ray_count_buffer_offset);
+        _trace<false>(dispatcher, mode, sort_threshold, queue_stream(ray_queue), intersection_buffer, ray_count);
+    });
+}
+
+}
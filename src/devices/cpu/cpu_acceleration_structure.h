@@ -0,0 +1,189 @@
+#pragma once
+
+#include <memory>
+#include <limits>
+#include <core/acceleration_structure.h>
+#include <core/intersection.h>
+#include <core/ray_queue.h>
+
+#include "cpu_bvh.h"
+#include "cpu_kernel.h"
+#include "cpu_simd.h"
+
+namespace luisa::cpu {
+
+// the part of Ray and ShadowRay read by the intersectors (MPSRayDataTypeOriginMinDistanceDirectionMaxDistance)
+struct CPURay {
+    math::packed_float3 origin;
+    float min_distance;
+    math::packed_float3 direction;
+    float max_distance;
+};
+
+// Where the traces find their rays: a CPURay at the start of every record of one stream and the time of every ray in another,
+// possibly the same, so that buffers of Ray or ShadowRay and the streams of a RayQueue are traced alike.
+struct CPURayStream {
+    const std::byte *rays;
+    size_t ray_stride;
+    const std::byte *times;
+    size_t time_stride;
+    [[nodiscard]] const CPURay &ray(uint32_t index) const noexcept { return *reinterpret_cast<const CPURay *>(rays + index * ray_stride); }
+    [[nodiscard]] float time(uint32_t index) const noexcept { return *reinterpret_cast<const float *>(times + index * time_stride); }
+};
+
+// pre-transformed for the Moller-Trumbore test and stored in leaf order
+struct CPUTriangle {
+    math::packed_float3 v0;
+    math::packed_float3 e1;
+    math::packed_float3 e2;
+};
+
+constexpr auto CPU_COHERENCE_SORT_DISABLED = std::numeric_limits<uint32_t>::max();
+
+enum struct CPUTraversalMode {
+    SCALAR,  // one ray at a time through the binary BVH
+    WIDE,    // one ray at a time through the 8-wide BVH, testing all children boxes at once
+    PACKET   // eight consecutive rays at a time through the binary BVH, for coherent camera and shadow rays
+};
+
+class CPUAccelerationStructure : public AccelerationStructure {
+
+private:
+    Buffer &_position_buffer;
+    size_t _stride;
+    size_t _triangle_count;
+    std::vector<CPUBVHNode> _nodes;
+    std::vector<CPUWideBVHNode> _wide_nodes;
+    std::vector<uint32_t> _wide_slot_nodes;
+    std::vector<CPUTriangle> _triangles;
+    std::vector<uint32_t> _triangle_indices;
+    float _build_cost{0.0f};
+    AccelerationStructureBuildMode _build_mode;
+    CPUTraversalMode _traversal_mode;
+    uint32_t _coherence_sort_threshold{CPU_COHERENCE_SORT_DISABLED};
+
+    [[nodiscard]] math::packed_float3 _vertex(size_t index) const noexcept;
+    void _gather_triangles(CPUScheduler &scheduler);
+    void _build(CPUScheduler &scheduler);
+    void _refit(CPUScheduler &scheduler, float rebuild_cost_ratio);
+
+    [[nodiscard]] bool _intersect_triangle(const CPURay &ray, uint32_t index, float &t_max, Intersection &intersection) const noexcept;
+
+    template<bool any_hit>
+    [[nodiscard]] bool _intersect_scalar(const CPURay &ray, Intersection &intersection) const noexcept;
+
+    // the wide and packet traversals, written once over the lanes of cpu_simd.h
+    template<bool any_hit, typename Float8>
+    [[nodiscard]] bool _traverse_wide(const CPURay &ray, Intersection &intersection) const noexcept;
+
+    template<bool any_hit, typename Float8>
+    void _traverse_packet(const CPURay *const *rays, uint32_t ray_count, Intersection *intersections) const noexcept;
+
+#ifdef LUISA_CPU_AVX2_AVAILABLE
+    template<bool any_hit>
+    [[nodiscard]] LUISA_CPU_AVX2 bool _intersect_wide_avx2(const CPURay &ray, Intersection &intersection) const noexcept;
+
+    template<bool any_hit>
+    LUISA_CPU_AVX2 void _intersect_packet_avx2(const CPURay *const *rays, uint32_t ray_count, Intersection *intersections) const noexcept;
+#endif
+
+    // run the traversals above with AVX2 if the host has it (see cpu_has_avx2()), and with the portable lanes otherwise
+    template<bool any_hit>
+    [[nodiscard]] bool _intersect_wide(const CPURay &ray, Intersection &intersection) const noexcept;
+
+    template<bool any_hit>
+    void _intersect_packet(const CPURay *const *rays, uint32_t ray_count, Intersection *intersections) const noexcept;
+
+    template<bool any_hit>
+    void _trace(CPUKernelDispatcher &dispatcher, CPUTraversalMode mode, uint32_t sort_threshold,
+                CPURayStream rays, Buffer &intersection_buffer, uint32_t ray_count) const;
+
+public:
+    // rebuilds triggered by refit() use the same build mode
+    CPUAccelerationStructure(CPUScheduler &scheduler, Buffer &position_buffer, size_t stride, size_t triangle_count,
+                             AccelerationStructureBuildMode build_mode, CPUTraversalMode mode);
+
+    // object-space queries of a single ray, used by CPUInstanceAccelerationStructure; PACKET falls back to WIDE here
+    [[nodiscard]] CPUBoundingBox bounds() const noexcept;
+    template<bool any_hit>
+    [[nodiscard]] bool intersect(const CPURay &ray, CPUTraversalMode mode, Intersection &intersection) const noexcept;
+
+    // applies to traces encoded afterwards, so that the modes can be compared on the same structure
+    void set_traversal_mode(CPUTraversalMode mode) noexcept { _traversal_mode = mode; }
+    [[nodiscard]] CPUTraversalMode traversal_mode() const noexcept { return _traversal_mode; }
+
+    // nearest-hit traces of more rays than the threshold visit them sorted by origin and direction (see sort_rays_by_coherence())
+    void set_coherence_sort_threshold(uint32_t ray_count) noexcept { _coherence_sort_threshold = ray_count; }
+    [[nodiscard]] uint32_t coherence_sort_threshold() const noexcept { return _coherence_sort_threshold; }
+
+    void trace_any(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, size_t ray_count) override;
+    void trace_nearest(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, size_t ray_count) override;
+    void trace_any(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) override;
+    void trace_nearest(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) override;
+    void trace_any(KernelDispatcher &dispatch, RayQueue &ray_queue, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) override;
+    void trace_nearest(KernelDispatcher &dispatch, RayQueue &ray_queue, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) override;
+    void refit(KernelDispatcher &dispatch, float rebuild_cost_ratio) override;
+};
+
+struct CPUInstance {
+    math::float4x4 world_to_object;  // at the first keyframe, moving instances interpolate their keyframes instead
+    uint32_t mesh_index;
+};
+
+// Top-level BVH over instances whose meshes are shared; rays are moved into the object space of each instance
+// they reach, so the distances along them stay comparable across instances. Moving instances interpolate their
+// transforms between keyframes at the time of each ray, and the nodes their bounds between shutter open and close.
+class CPUInstanceAccelerationStructure : public AccelerationStructure {
+
+private:
+    std::vector<std::shared_ptr<CPUAccelerationStructure>> _meshes;
+    Buffer &_mesh_index_buffer;
+    Buffer &_transform_buffer;
+    size_t _instance_count;
+    std::vector<CPUBVHNode> _nodes;  // bounds at shutter open
+    std::vector<CPUBoundingBox> _close_bounds;  // of the nodes at shutter close, moving instances only
+    std::vector<CPUInstance> _instances;  // in leaf order
+    std::vector<uint32_t> _instance_indices;
+    std::vector<math::float4x4> _object_to_world;  // keyframes in leaf order, moving instances only
+    uint32_t _keyframe_count;
+    float _shutter_open;
+    float _shutter_close;
+    CPUTraversalMode _traversal_mode;
+    uint32_t _coherence_sort_threshold{CPU_COHERENCE_SORT_DISABLED};
+
+    [[nodiscard]] bool _moving() const noexcept { return _keyframe_count > 1u && _shutter_close > _shutter_open; }
+    void _build(CPUScheduler &scheduler);
+
+    template<bool any_hit, bool moving>
+    [[nodiscard]] bool _intersect(const CPURay &ray, float time, CPUTraversalMode mode, InstanceIntersection &intersection) const noexcept;
+
+    template<bool any_hit>
+    void _trace(CPUKernelDispatcher &dispatcher, CPUTraversalMode mode, uint32_t sort_threshold,
+                CPURayStream rays, Buffer &intersection_buffer, uint32_t ray_count) const;
+
+public:
+    // transform_buffer holds keyframe_count transforms per instance, evenly spaced over [shutter_open, shutter_close]
+    CPUInstanceAccelerationStructure(CPUScheduler &scheduler, std::vector<std::shared_ptr<CPUAccelerationStructure>> meshes,
+                                     Buffer &mesh_index_buffer, Buffer &transform_buffer, size_t instance_count,
+                                     uint32_t keyframe_count, float shutter_open, float shutter_close, CPUTraversalMode mode);
+
+    // the mode used inside the meshes; the instances themselves are always traversed one ray at a time
+    void set_traversal_mode(CPUTraversalMode mode) noexcept { _traversal_mode = mode; }
+    [[nodiscard]] CPUTraversalMode traversal_mode() const noexcept { return _traversal_mode; }
+
+    void set_coherence_sort_threshold(uint32_t ray_count) noexcept { _coherence_sort_threshold = ray_count; }
+    [[nodiscard]] uint32_t coherence_sort_threshold() const noexcept { return _coherence_sort_threshold; }
+
+    void trace_any(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, size_t ray_count) override;
+    void trace_nearest(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, size_t ray_count) override;
+    void trace_any(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) override;
+    void trace_nearest(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) override;
+    void trace_any(KernelDispatcher &dispatch, RayQueue &ray_queue, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) override;
+    void trace_nearest(KernelDispatcher &dispatch, RayQueue &ray_queue, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) override;
+
+    // the top level only holds the instances and is always rebuilt, after the meshes encoded before it have been refitted
+    void refit(KernelDispatcher &dispatch, float rebuild_cost_ratio) override;
+    [[nodiscard]] bool instanced() const noexcept override { return true; }
+};
+
+}
@@ -0,0 +1,21 @@
+#include <cstring>
+#include <stdexcept>
+#include "cpu_buffer.h"
+
+namespace luisa::cpu {
+
+void CPUBuffer::upload(const void *host_data, size_t size, size_t offset) {
+    if (_storage != BufferStorageTag::MANAGED) { throw std::runtime_error{"only managed buffers can be update."}; }
+    if (offset + size > _capacity) { throw std::runtime_error{"buffer data overflowed"}; }
+    std::memmove(_memory.get() + offset, host_data, size);
+}
+
+void CPUBuffer::upload(size_t begin [[maybe_unused]], size_t end [[maybe_unused]]) {
+    // host memory is shared with the kernels, nothing to flush
+}
+
+void CPUBuffer::synchronize(KernelDispatcher &dispatch [[maybe_unused]]) {
+    // kernel results are already visible to the host when the launch completes
+}
+
+}
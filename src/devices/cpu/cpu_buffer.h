@@ -0,0 +1,39 @@
+#pragma once
+
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <core/buffer.h>
+
+namespace luisa::cpu {
+
+// cache-line aligned so that workers writing neighbouring ranges do not share lines with other allocations
+constexpr auto CPU_MEMORY_ALIGNMENT = 64ul;
+
+struct CPUMemoryDeleter {
+    void operator()(std::byte *p) const noexcept { ::operator delete[](p, std::align_val_t{CPU_MEMORY_ALIGNMENT}); }
+};
+
+using CPUMemory = std::unique_ptr<std::byte[], CPUMemoryDeleter>;
+
+// memory is left untouched here so that pages get first-touched by the workers that write them
+[[nodiscard]] inline CPUMemory allocate_cpu_memory(size_t size) {
+    return CPUMemory{new(std::align_val_t{CPU_MEMORY_ALIGNMENT}) std::byte[size]};
+}
+
+class CPUBuffer : public Buffer {
+
+private:
+    CPUMemory _memory;
+
+public:
+    CPUBuffer(size_t capacity, BufferStorageTag storage) : Buffer{capacity, storage}, _memory{allocate_cpu_memory(capacity)} {}
+    void upload(size_t begin, size_t end) override;
+    void upload(const void *host_data, size_t size, size_t offset) override;
+    void synchronize(struct KernelDispatcher &dispatch) override;
+    [[nodiscard]] void *data() override { return _memory.get(); }
+    [[nodiscard]] const void *data() const override { return _memory.get(); }
+    
+};
+
+}
@@ -0,0 +1,726 @@
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <util/thread_pool.h>
+
+#include "cpu_bvh.h"
+#include "cpu_sort.h"
+
+namespace luisa::cpu {
+
+namespace {
+
+constexpr auto BIN_COUNT = 32u;  // upper bound, small nodes use fewer bins
+constexpr auto TRAVERSAL_COST = 1.0f;  // relative to a single primitive intersection
+constexpr auto BINNING_CHUNK_SIZE = 16u * 1024u;
+constexpr auto REFIT_CHUNK_SIZE = 4u * 1024u;
+constexpr auto MORTON_BITS_PER_AXIS = 10u;
+constexpr auto TREELET_SIZE = 7u;  // leaves per treelet, the subsets of which are enumerated when restructuring
+constexpr auto TREELET_MIN_PRIMITIVE_COUNT = 16u;  // smaller subtrees are left as emitted, restructuring them barely pays off
+
+// primitives are moved around by value during the build, so that every pass streams through memory
+struct PrimitiveReference {
+    CPUBoundingBox bounds;
+    uint32_t primitive;
+    [[nodiscard]] math::packed_float3 centroid() const noexcept { return bounds.centroid(); }
+};
+
+struct BuildTask {
+    uint32_t node;
+    uint32_t begin;
+    uint32_t end;
+    uint32_t depth;
+};
+
+struct RangeBounds {
+    CPUBoundingBox bounds;
+    CPUBoundingBox centroid_bounds;
+};
+
+struct Bins {
+    CPUBoundingBox bounds[3][BIN_COUNT];
+    uint32_t counts[3][BIN_COUNT]{};
+};
+
+class BVHBuilder {
+
+private:
+    CPUScheduler &_scheduler;
+    const std::vector<CPUBoundingBox> &_primitive_bounds;
+    std::vector<PrimitiveReference> _references;
+    CPUBVH &_bvh;
+    std::atomic<uint32_t> _node_count{1u};
+    uint32_t _subtree_threshold;
+
+    // splits [begin, end) into chunks evaluated on the workers when the range is large enough
+    template<typename T, typename Evaluate, typename Merge>
+    [[nodiscard]] T _reduce(uint32_t begin, uint32_t end, bool parallel, Evaluate &&evaluate, Merge &&merge) {
+        if (!parallel || end - begin <= BINNING_CHUNK_SIZE) { return evaluate(begin, end); }
+        auto chunk_count = (end - begin + BINNING_CHUNK_SIZE - 1u) / BINNING_CHUNK_SIZE;
+        std::vector<T> partials(chunk_count);
+        _scheduler.dispatch(chunk_count, CPUSchedulingPolicy::WORK_STEALING, [&](uint32_t chunk) {
+            auto chunk_begin = begin + chunk * BINNING_CHUNK_SIZE;
+            partials[chunk] = evaluate(chunk_begin, std::min(chunk_begin + BINNING_CHUNK_SIZE, end));
+        });
+        for (auto i = 1u; i < chunk_count; i++) { merge(partials.front(), partials[i]); }
+        return partials.front();
+    }
+
+    [[nodiscard]] RangeBounds _compute_bounds(uint32_t begin, uint32_t end, bool parallel) {
+        return _reduce<RangeBounds>(begin, end, parallel, [this](uint32_t b, uint32_t e) {
+            RangeBounds result;
+            for (auto i = b; i < e; i++) {
+                result.bounds.extend(_references[i].bounds);
+                result.centroid_bounds.extend(_references[i].centroid());
+            }
+            return result;
+        }, [](RangeBounds &lhs, const RangeBounds &rhs) {
+            lhs.bounds.extend(rhs.bounds);
+            lhs.centroid_bounds.extend(rhs.centroid_bounds);
+        });
+    }
+
+    [[nodiscard]] Bins _compute_bins(uint32_t begin, uint32_t end, math::packed_float3 origin, math::packed_float3 scale, uint32_t bin_count, bool parallel) {
+        return _reduce<Bins>(begin, end, parallel, [&](uint32_t b, uint32_t e) {
+            Bins bins;
+            for (auto i = b; i < e; i++) {
+                auto &&reference = _references[i];
+                auto centroid = reference.centroid();
+                for (auto axis = 0u; axis < 3u; axis++) {
+                    auto bin = _bin_index(centroid[axis], origin[axis], scale[axis], bin_count);
+                    bins.bounds[axis][bin].extend(reference.bounds);
+                    bins.counts[axis][bin]++;
+                }
+            }
+            return bins;
+        }, [](Bins &lhs, const Bins &rhs) {
+            for (auto axis = 0u; axis < 3u; axis++) {
+                for (auto i = 0u; i < BIN_COUNT; i++) {
+                    lhs.bounds[axis][i].extend(rhs.bounds[axis][i]);
+                    lhs.counts[axis][i] += rhs.counts[axis][i];
+                }
+            }
+        });
+    }
+
+    [[nodiscard]] static uint32_t _bin_index(float centroid, float origin, float scale, uint32_t bin_count) noexcept {
+        return std::min(static_cast<uint32_t>((centroid - origin) * scale), bin_count - 1u);
+    }
+
+    // returns false if the node has been turned into a leaf
+    bool _split(const BuildTask &task, bool parallel, BuildTask &left, BuildTask &right) {
+
+        auto [bounds, centroid_bounds] = _compute_bounds(task.begin, task.end, parallel);
+        auto &&node = _bvh.nodes[task.node];
+        node.min = bounds.min;
+        node.max = bounds.max;
+
+        auto count = task.end - task.begin;
+        auto make_leaf = [&] {
+            node.index = task.begin;
+            node.count = count;
+            return false;
+        };
+        if (count <= 1u || task.depth + 1u >= CPU_BVH_MAX_DEPTH) { return make_leaf(); }
+
+        auto references = _references.data();
+        auto extent = centroid_bounds.max - centroid_bounds.min;
+        auto middle = task.begin + count / 2u;
+        if (math::max(extent.x, math::max(extent.y, extent.z)) <= 0.0f) {  // coincident centroids, any split is as good as another
+            if (count <= CPU_BVH_MAX_LEAF_SIZE) { return make_leaf(); }
+        } else {
+            auto bin_count = std::clamp(count, 4u, BIN_COUNT);
+            math::packed_float3 scale{0.0f};
+            for (auto axis = 0u; axis < 3u; axis++) {
+                if (extent[axis] > 0.0f) { scale[axis] = static_cast<float>(bin_count) * (1.0f - 1e-5f) / extent[axis]; }
+            }
+            auto bins = _compute_bins(task.begin, task.end, centroid_bounds.min, scale, bin_count, parallel);
+
+            auto best_cost = std::numeric_limits<float>::max();
+            auto best_axis = 0u;
+            auto best_bin = 0u;
+            for (auto axis = 0u; axis < 3u; axis++) {
+                if (extent[axis] <= 0.0f) { continue; }
+                float right_costs[BIN_COUNT]{};
+                CPUBoundingBox right_bounds;
+                auto right_count = 0u;
+                for (auto i = bin_count - 1u; i > 0u; i--) {
+                    right_bounds.extend(bins.bounds[axis][i]);
+                    right_count += bins.counts[axis][i];
+                    right_costs[i] = right_bounds.surface_area() * static_cast<float>(right_count);
+                }
+                CPUBoundingBox left_bounds;
+                auto left_count = 0u;
+                for (auto i = 1u; i < bin_count; i++) {
+                    left_bounds.extend(bins.bounds[axis][i - 1u]);
+                    left_count += bins.counts[axis][i - 1u];
+                    if (left_count == 0u || left_count == count) { continue; }
+                    if (auto cost = left_bounds.surface_area() * static_cast<float>(left_count) + right_costs[i]; cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_bin = i;
+                    }
+                }
+            }
+
+            auto split_cost = TRAVERSAL_COST + best_cost / std::max(bounds.surface_area(), std::numeric_limits<float>::min());
+            if (count <= CPU_BVH_MAX_LEAF_SIZE && static_cast<float>(count) <= split_cost) { return make_leaf(); }
+
+            if (best_cost < std::numeric_limits<float>::max()) {
+                auto iter = std::partition(references + task.begin, references + task.end, [&](const PrimitiveReference &reference) {
+                    return _bin_index(reference.centroid()[best_axis], centroid_bounds.min[best_axis], scale[best_axis], bin_count) < best_bin;
+                });
+                middle = static_cast<uint32_t>(iter - references);
+            }
+        }
+
+        auto children = _node_count.fetch_add(2u, std::memory_order_relaxed);
+        node.index = children;
+        node.count = 0u;
+        left = {children, task.begin, middle, task.depth + 1u};
+        right = {children + 1u, middle, task.end, task.depth + 1u};
+        return true;
+    }
+
+    void _build_subtree(const BuildTask &task) {
+        if (BuildTask left{}, right{}; _split(task, false, left, right)) {
+            _build_subtree(left);
+            _build_subtree(right);
+        }
+    }
+
+public:
+    BVHBuilder(CPUScheduler &scheduler, const std::vector<CPUBoundingBox> &primitive_bounds, CPUBVH &bvh)
+        : _scheduler{scheduler}, _primitive_bounds{primitive_bounds}, _bvh{bvh} {
+        auto primitive_count = static_cast<uint32_t>(primitive_bounds.size());
+        _subtree_threshold = std::max(primitive_count / (util::ThreadPool::instance().worker_count() * 8u), 4096u);
+    }
+
+    void build() {
+
+        auto primitive_count = static_cast<uint32_t>(_primitive_bounds.size());
+        _references.resize(primitive_count);
+        _bvh.nodes.resize(std::max(primitive_count * 2u, 2u) - 1u);
+
+        auto chunk_count = (primitive_count + BINNING_CHUNK_SIZE - 1u) / BINNING_CHUNK_SIZE;
+        _scheduler.dispatch(chunk_count, CPUSchedulingPolicy::STATIC, [&](uint32_t chunk) {
+            auto end = std::min((chunk + 1u) * BINNING_CHUNK_SIZE, primitive_count);
+            for (auto i = chunk * BINNING_CHUNK_SIZE; i < end; i++) {
+                _references[i] = {_primitive_bounds[i], i};
+            }
+        });
+
+        // split the upper levels in place with parallel binning until the remaining subtrees are small enough
+        std::vector<BuildTask> pending{{0u, 0u, primitive_count, 0u}};
+        std::vector<BuildTask> subtrees;
+        while (!pending.empty()) {
+            auto task = pending.back();
+            pending.pop_back();
+            if (task.end - task.begin <= _subtree_threshold) {
+                subtrees.emplace_back(task);
+            } else if (BuildTask left{}, right{}; _split(task, true, left, right)) {
+                pending.emplace_back(left);
+                pending.emplace_back(right);
+            }
+        }
+        _scheduler.dispatch(static_cast<uint32_t>(subtrees.size()), CPUSchedulingPolicy::WORK_STEALING, [&](uint32_t index) {
+            _build_subtree(subtrees[index]);
+        });
+        _bvh.nodes.resize(_node_count.load());
+
+        _bvh.primitive_indices.resize(primitive_count);
+        _scheduler.dispatch(chunk_count, CPUSchedulingPolicy::STATIC, [&](uint32_t chunk) {
+            auto end = std::min((chunk + 1u) * BINNING_CHUNK_SIZE, primitive_count);
+            for (auto i = chunk * BINNING_CHUNK_SIZE; i < end; i++) {
+                _bvh.primitive_indices[i] = _references[i].primitive;
+            }
+        });
+    }
+};
+
+// whether the highest set bit of a is lower than the one of b, i.e. (x ^ a) shares more leading bits with x than (x ^ b) does
+[[nodiscard]] constexpr bool lower_highest_bit(uint32_t a, uint32_t b) noexcept { return a < b && a < (a ^ b); }
+
+class LinearBVHBuilder {
+
+private:
+    CPUScheduler &_scheduler;
+    const std::vector<CPUBoundingBox> &_primitive_bounds;
+    std::vector<uint32_t> _codes;  // sorted along with the primitive indices of the BVH
+    CPUBVH &_bvh;
+    std::atomic<uint32_t> _node_count{1u};
+    uint32_t _subtree_threshold;
+
+    template<typename F>
+    void _dispatch_chunks(uint32_t count, CPUSchedulingPolicy policy, F &&f) {
+        auto chunk_count = (count + BINNING_CHUNK_SIZE - 1u) / BINNING_CHUNK_SIZE;
+        _scheduler.dispatch(chunk_count, policy, [&](uint32_t chunk) {
+            f(chunk, chunk * BINNING_CHUNK_SIZE, std::min((chunk + 1u) * BINNING_CHUNK_SIZE, count));
+        });
+    }
+
+    void _compute_morton_codes() {
+
+        auto primitive_count = static_cast<uint32_t>(_primitive_bounds.size());
+        std::vector<CPUBoundingBox> partial_bounds((primitive_count + BINNING_CHUNK_SIZE - 1u) / BINNING_CHUNK_SIZE);
+        _dispatch_chunks(primitive_count, CPUSchedulingPolicy::STATIC, [&](uint32_t chunk, uint32_t begin, uint32_t end) {
+            for (auto i = begin; i < end; i++) { partial_bounds[chunk].extend(_primitive_bounds[i].centroid()); }
+        });
+        CPUBoundingBox centroid_bounds;
+        for (auto &&bounds : partial_bounds) { centroid_bounds.extend(bounds); }
+
+        math::packed_float3 scale{0.0f};
+        for (auto axis = 0u; axis < 3u; axis++) {
+            if (auto extent = centroid_bounds.max[axis] - centroid_bounds.min[axis]; extent > 0.0f) {
+                scale[axis] = static_cast<float>(1u << MORTON_BITS_PER_AXIS) * (1.0f - 1e-5f) / extent;
+            }
+        }
+        _codes.resize(primitive_count);
+        _bvh.primitive_indices.resize(primitive_count);
+        _dispatch_chunks(primitive_count, CPUSchedulingPolicy::STATIC, [&](uint32_t, uint32_t begin, uint32_t end) {
+            for (auto i = begin; i < end; i++) {
+                auto centroid = _primitive_bounds[i].centroid();
+                auto code = 0u;
+                for (auto axis = 0u; axis < 3u; axis++) {
+                    auto cell = std::min(static_cast<uint32_t>((centroid[axis] - centroid_bounds.min[axis]) * scale[axis]), (1u << MORTON_BITS_PER_AXIS) - 1u);
+                    code |= spread_morton_bits(cell) << (2u - axis);
+                }
+                _codes[i] = code;
+                _bvh.primitive_indices[i] = i;
+            }
+        });
+    }
+
+    // the first primitive of the right child: past the last code sharing the highest differing bit of the range with the first one,
+    // found by binary search; ranges of duplicated codes are split in the middle
+    [[nodiscard]] uint32_t _find_split(uint32_t begin, uint32_t end) const noexcept {
+        auto first = _codes[begin];
+        auto last = _codes[end - 1u];
+        if (first == last) { return begin + (end - begin) / 2u; }
+        auto split = begin;
+        auto step = end - 1u - begin;
+        do {
+            step = (step + 1u) / 2u;
+            if (auto candidate = split + step; candidate < end - 1u && lower_highest_bit(first ^ _codes[candidate], first ^ last)) {
+                split = candidate;
+            }
+        } while (step > 1u);
+        return split + 1u;
+    }
+
+    // returns false if the node has been turned into a leaf
+    bool _split(const BuildTask &task, BuildTask &left, BuildTask &right) {
+        auto &&node = _bvh.nodes[task.node];
+        if (task.end - task.begin <= CPU_BVH_MAX_LEAF_SIZE || task.depth + 1u >= CPU_BVH_MAX_DEPTH) {
+            node.index = task.begin;
+            node.count = task.end - task.begin;
+            return false;
+        }
+        auto middle = _find_split(task.begin, task.end);
+        auto children = _node_count.fetch_add(2u, std::memory_order_relaxed);
+        node.index = children;
+        node.count = 0u;
+        left = {children, task.begin, middle, task.depth + 1u};
+        right = {children + 1u, middle, task.end, task.depth + 1u};
+        return true;
+    }
+
+    void _emit_subtree(const BuildTask &task) {
+        if (BuildTask left{}, right{}; _split(task, left, right)) {
+            _emit_subtree(left);
+            _emit_subtree(right);
+        }
+    }
+
+public:
+    LinearBVHBuilder(CPUScheduler &scheduler, const std::vector<CPUBoundingBox> &primitive_bounds, CPUBVH &bvh)
+        : _scheduler{scheduler}, _primitive_bounds{primitive_bounds}, _bvh{bvh} {
+        auto primitive_count = static_cast<uint32_t>(primitive_bounds.size());
+        _subtree_threshold = std::max(primitive_count / (util::ThreadPool::instance().worker_count() * 8u), 4096u);
+    }
+
+    void build() {
+
+        auto primitive_count = static_cast<uint32_t>(_primitive_bounds.size());
+        _bvh.nodes.resize(std::max(primitive_count * 2u, 2u) - 1u);
+        if (primitive_count == 0u) {
+            CPUBoundingBox empty;
+            _bvh.nodes.front() = {empty.min, 0u, empty.max, 0u};
+            return;
+        }
+        _compute_morton_codes();
+        radix_sort(_scheduler, _codes, _bvh.primitive_indices, MORTON_BITS_PER_AXIS * 3u);  // stable, primitives sharing a code keep their order
+
+        // every split is a binary search, so only the subtrees are worth emitting in parallel
+        std::vector<BuildTask> pending{{0u, 0u, primitive_count, 0u}};
+        std::vector<BuildTask> subtrees;
+        while (!pending.empty()) {
+            auto task = pending.back();
+            pending.pop_back();
+            if (task.end - task.begin <= _subtree_threshold) {
+                subtrees.emplace_back(task);
+            } else if (BuildTask left{}, right{}; _split(task, left, right)) {
+                pending.emplace_back(left);
+                pending.emplace_back(right);
+            }
+        }
+        _scheduler.dispatch(static_cast<uint32_t>(subtrees.size()), CPUSchedulingPolicy::WORK_STEALING, [&](uint32_t index) {
+            _emit_subtree(subtrees[index]);
+        });
+        _bvh.nodes.resize(_node_count.load());
+
+        refit_bvh(_scheduler, _bvh.nodes, [this](uint32_t first, uint32_t count) noexcept {
+            CPUBoundingBox bounds;
+            for (auto i = first; i < first + count; i++) { bounds.extend(_primitive_bounds[_bvh.primitive_indices[i]]); }
+            return bounds;
+        });
+    }
+};
+
+// Restructures the treelets of a BVH with its bounds up to date, after Karras and Aila: walking up from the leaves in parallel,
+// the last child to arrive at a node grows a treelet below it by opening its largest interior leaf until there are seven of them,
+// and rearranges it into the topology with the lowest SAH cost, found by dynamic programming over the subsets of its leaves.
+// Nodes only move between the slots the treelet already occupies, so that the children of every node stay allocated in pairs.
+// Topologies that would push leaves deeper than CPU_BVH_MAX_DEPTH - 1 are rejected, since the traversal stacks are sized for it.
+class TreeletOptimizer {
+
+private:
+    struct Treelet {
+        uint32_t leaves[TREELET_SIZE];  // nodes kept along with their subtrees
+        uint32_t leaf_count;
+        uint32_t pairs[TREELET_SIZE - 1u];  // children slots of the interior nodes, reused in the new topology
+        uint32_t pair_count;
+        CPUBVHNode leaf_nodes[TREELET_SIZE];
+        float leaf_costs[TREELET_SIZE];
+        uint32_t leaf_primitive_counts[TREELET_SIZE];
+        uint32_t leaf_heights[TREELET_SIZE];
+        CPUBoundingBox bounds[1u << TREELET_SIZE];
+        float costs[1u << TREELET_SIZE];
+        uint32_t heights[1u << TREELET_SIZE];  // of the best topology of every subset
+        uint32_t partitions[1u << TREELET_SIZE];  // the part of every subset holding its lowest leaf in the best split
+    };
+
+    CPUScheduler &_scheduler;
+    std::vector<CPUBVHNode> &_nodes;
+    std::vector<uint32_t> _parents;
+    std::vector<float> _costs;  // SAH cost of the subtree below every node, not normalized
+    std::vector<uint32_t> _primitive_counts;
+    std::vector<uint32_t> _depths;   // of the slots before restructuring, still exact for a node when it is reached by the walk
+    std::vector<uint32_t> _heights;  // longest path from every node down to a leaf
+
+    [[nodiscard]] float _area(uint32_t index) const noexcept { return CPUBoundingBox{_nodes[index].min, _nodes[index].max}.surface_area(); }
+
+    void _update(uint32_t index) noexcept {
+        auto first = _nodes[index].index;
+        _costs[index] = TRAVERSAL_COST * _area(index) + _costs[first] + _costs[first + 1u];
+        _primitive_counts[index] = _primitive_counts[first] + _primitive_counts[first + 1u];
+        _heights[index] = std::max(_heights[first], _heights[first + 1u]) + 1u;
+    }
+
+    void _place(Treelet &treelet, uint32_t subset, uint32_t slot) noexcept {
+        if ((subset & (subset - 1u)) == 0u) {  // a single leaf of the treelet, moved along with the subtree below it
+            auto leaf = 0u;
+            while ((subset >> leaf) != 1u) { leaf++; }
+            auto &&node = _nodes[slot] = treelet.leaf_nodes[leaf];
+            _costs[slot] = treelet.leaf_costs[leaf];
+            _primitive_counts[slot] = treelet.leaf_primitive_counts[leaf];
+            _heights[slot] = treelet.leaf_heights[leaf];
+            if (node.count == 0u) {
+                _parents[node.index] = slot;
+                _parents[node.index + 1u] = slot;
+            }
+            return;
+        }
+        auto first = treelet.pairs[treelet.pair_count++];
+        auto partition = treelet.partitions[subset];
+        _place(treelet, partition, first);
+        _place(treelet, subset ^ partition, first + 1u);
+        _parents[first] = slot;
+        _parents[first + 1u] = slot;
+        auto &&bounds = treelet.bounds[subset];
+        _nodes[slot] = {bounds.min, first, bounds.max, 0u};
+        _costs[slot] = treelet.costs[subset];
+        _primitive_counts[slot] = _primitive_counts[first] + _primitive_counts[first + 1u];
+        _heights[slot] = treelet.heights[subset];
+    }
+
+    void _restructure(uint32_t root) noexcept {
+
+        Treelet treelet;
+        auto first = _nodes[root].index;
+        treelet.leaves[0] = first;
+        treelet.leaves[1] = first + 1u;
+        treelet.leaf_count = 2u;
+        treelet.pairs[0] = first;
+        treelet.pair_count = 1u;
+        while (treelet.leaf_count < TREELET_SIZE) {
+            auto best = treelet.leaf_count;
+            auto best_area = -1.0f;
+            for (auto i = 0u; i < treelet.leaf_count; i++) {
+                if (auto leaf = treelet.leaves[i]; _nodes[leaf].count == 0u && _area(leaf) > best_area) {
+                    best = i;
+                    best_area = _area(leaf);
+                }
+            }
+            if (best == treelet.leaf_count) { break; }
+            auto opened = _nodes[treelet.leaves[best]].index;
+            treelet.pairs[treelet.pair_count++] = opened;
+            treelet.leaves[best] = opened;
+            treelet.leaves[treelet.leaf_count++] = opened + 1u;
+        }
+        if (treelet.leaf_count < 3u) { return; }
+
+        for (auto i = 0u; i < treelet.leaf_count; i++) {
+            auto leaf = treelet.leaves[i];
+            treelet.leaf_nodes[i] = _nodes[leaf];
+            treelet.leaf_costs[i] = _costs[leaf];
+            treelet.leaf_primitive_counts[i] = _primitive_counts[leaf];
+            treelet.leaf_heights[i] = _heights[leaf];
+        }
+
+        // subsets are visited in increasing order, after all their parts
+        auto full = (1u << treelet.leaf_count) - 1u;
+        for (auto subset = 1u; subset <= full; subset++) {
+            auto lowest = subset & (~subset + 1u);
+            if (subset == lowest) {
+                auto leaf = 0u;
+                while ((subset >> leaf) != 1u) { leaf++; }
+                treelet.bounds[subset] = {treelet.leaf_nodes[leaf].min, treelet.leaf_nodes[leaf].max};
+                treelet.costs[subset] = treelet.leaf_costs[leaf];
+                treelet.heights[subset] = treelet.leaf_heights[leaf];
+                continue;
+            }
+            treelet.bounds[subset] = treelet.bounds[subset ^ lowest];
+            treelet.bounds[subset].extend(treelet.bounds[lowest]);
+            auto best_cost = std::numeric_limits<float>::max();
+            auto best_partition = lowest;
+            for (auto part = (subset - 1u) & subset; part != 0u; part = (part - 1u) & subset) {
+                if ((part & lowest) == 0u) { continue; }  // every split once
+                if (auto cost = treelet.costs[part] + treelet.costs[subset ^ part]; cost < best_cost) {
+                    best_cost = cost;
+                    best_partition = part;
+                }
+            }
+            treelet.costs[subset] = TRAVERSAL_COST * treelet.bounds[subset].surface_area() + best_cost;
+            treelet.partitions[subset] = best_partition;
+            treelet.heights[subset] = std::max(treelet.heights[best_partition], treelet.heights[subset ^ best_partition]) + 1u;
+        }
+
+        // the emitted topology is one of the candidates, so it is only kept when nothing is better;
+        // the current topology always fits under the depth cap, so a cheaper one that does not is dropped
+        if (treelet.costs[full] < _costs[root] && _depths[root] + treelet.heights[full] < CPU_BVH_MAX_DEPTH) {
+            treelet.pair_count = 0u;
+            _place(treelet, full, root);
+        }
+    }
+
+public:
+    TreeletOptimizer(CPUScheduler &scheduler, std::vector<CPUBVHNode> &nodes) noexcept
+        : _scheduler{scheduler}, _nodes{nodes} {}
+
+    void optimize() {
+
+        auto node_count = static_cast<uint32_t>(_nodes.size());
+        if (node_count <= 1u) { return; }
+
+        _parents.resize(node_count);
+        _costs.resize(node_count);
+        _primitive_counts.resize(node_count);
+        _heights.resize(node_count);
+        _depths.resize(node_count);
+        _depths.front() = 0u;
+        for (auto i = 0u; i < node_count; i++) {  // children are always allocated after their parent
+            if (auto &&node = _nodes[i]; node.count == 0u) {
+                _depths[node.index] = _depths[i] + 1u;
+                _depths[node.index + 1u] = _depths[i] + 1u;
+            }
+        }
+        auto arrivals = std::make_unique<std::atomic<uint32_t>[]>(node_count);
+        auto chunk_count = (node_count + REFIT_CHUNK_SIZE - 1u) / REFIT_CHUNK_SIZE;
+        _scheduler.dispatch(chunk_count, CPUSchedulingPolicy::STATIC, [&](uint32_t chunk) {
+            auto end = std::min((chunk + 1u) * REFIT_CHUNK_SIZE, node_count);
+            for (auto i = chunk * REFIT_CHUNK_SIZE; i < end; i++) {
+                arrivals[i].store(0u, std::memory_order_relaxed);
+                if (auto &&node = _nodes[i]; node.count == 0u) {
+                    _parents[node.index] = i;
+                    _parents[node.index + 1u] = i;
+                }
+            }
+        });
+
+        // a node only moves once both of its children have arrived, so the walks never run into a moved slot
+        _scheduler.dispatch(chunk_count, CPUSchedulingPolicy::WORK_STEALING, [&](uint32_t chunk) {
+            auto end = std::min((chunk + 1u) * REFIT_CHUNK_SIZE, node_count);
+            for (auto i = chunk * REFIT_CHUNK_SIZE; i < end; i++) {
+                auto &&leaf = _nodes[i];
+                if (leaf.count == 0u) { continue; }
+                _costs[i] = _area(i) * static_cast<float>(leaf.count);
+                _primitive_counts[i] = leaf.count;
+                _heights[i] = 0u;
+                for (auto index = i; index != 0u;) {
+                    index = _parents[index];
+                    if (arrivals[index].fetch_add(1u, std::memory_order_acq_rel) == 0u) { break; }  // the sibling is still on its way up
+                    _update(index);
+                    if (_primitive_counts[index] >= TREELET_MIN_PRIMITIVE_COUNT) { _restructure(index); }
+                }
+            }
+        });
+    }
+};
+
+uint32_t collapse_node(const CPUBVH &bvh, uint32_t index, std::vector<CPUWideBVHNode> &wide_nodes, std::vector<uint32_t> &slot_nodes) {
+
+    auto area = [&bvh](uint32_t node) noexcept { return CPUBoundingBox{bvh.nodes[node].min, bvh.nodes[node].max}.surface_area(); };
+
+    uint32_t children[8];
+    auto child_count = 0u;
+    if (auto &&node = bvh.nodes[index]; node.count != 0u) {
+        children[child_count++] = index;
+    } else {
+        children[child_count++] = node.index;
+        children[child_count++] = node.index + 1u;
+    }
+    while (child_count < 8u) {
+        auto best = child_count;
+        auto best_area = -1.0f;
+        for (auto i = 0u; i < child_count; i++) {
+            if (bvh.nodes[children[i]].count == 0u && area(children[i]) > best_area) {
+                best = i;
+                best_area = area(children[i]);
+            }
+        }
+        if (best == child_count) { break; }
+        auto first = bvh.nodes[children[best]].index;
+        children[best] = first;
+        children[child_count++] = first + 1u;
+    }
+
+    auto wide_index = static_cast<uint32_t>(wide_nodes.size());
+    auto &&empty = wide_nodes.emplace_back();
+    std::fill_n(empty.min_x, 8u, std::numeric_limits<float>::infinity());
+    std::fill_n(empty.max_x, 8u, std::numeric_limits<float>::infinity());
+    std::fill_n(empty.min_y, 8u, std::numeric_limits<float>::infinity());
+    std::fill_n(empty.max_y, 8u, std::numeric_limits<float>::infinity());
+    std::fill_n(empty.min_z, 8u, std::numeric_limits<float>::infinity());
+    std::fill_n(empty.max_z, 8u, std::numeric_limits<float>::infinity());
+    std::fill_n(empty.children, 8u, 0u);
+    std::fill_n(empty.counts, 8u, 0u);
+    slot_nodes.resize(wide_nodes.size() * 8u, ~0u);
+
+    for (auto i = 0u; i < child_count; i++) {
+        auto &&child = bvh.nodes[children[i]];
+        auto child_index = child.count == 0u ? collapse_node(bvh, children[i], wide_nodes, slot_nodes) : child.index;
+        auto &&wide_node = wide_nodes[wide_index];  // the recursion above may have reallocated the nodes
+        wide_node.min_x[i] = child.min.x;
+        wide_node.max_x[i] = child.max.x;
+        wide_node.min_y[i] = child.min.y;
+        wide_node.max_y[i] = child.max.y;
+        wide_node.min_z[i] = child.min.z;
+        wide_node.max_z[i] = child.max.z;
+        wide_node.children[i] = child_index;
+        wide_node.counts[i] = child.count;
+        slot_nodes[wide_index * 8u + i] = children[i];
+    }
+    return wide_index;
+}
+
+}
+
+std::vector<CPUWideBVHNode> collapse_bvh(const CPUBVH &bvh, std::vector<uint32_t> &slot_nodes) {
+    std::vector<CPUWideBVHNode> wide_nodes;
+    slot_nodes.clear();
+    if (!bvh.primitive_indices.empty()) {
+        wide_nodes.reserve(bvh.nodes.size() / 4u + 1u);
+        slot_nodes.reserve(wide_nodes.capacity() * 8u);
+        collapse_node(bvh, 0u, wide_nodes, slot_nodes);
+    }
+    return wide_nodes;
+}
+
+void refit_bvh(CPUScheduler &scheduler, std::vector<CPUBVHNode> &nodes, const std::function<CPUBoundingBox(uint32_t, uint32_t)> &leaf_bounds) {
+
+    auto node_count = static_cast<uint32_t>(nodes.size());
+    if (node_count == 0u) { return; }
+
+    std::vector<uint32_t> parents(node_count);
+    auto arrivals = std::make_unique<std::atomic<uint32_t>[]>(node_count);
+    auto chunk_count = (node_count + REFIT_CHUNK_SIZE - 1u) / REFIT_CHUNK_SIZE;
+    scheduler.dispatch(chunk_count, CPUSchedulingPolicy::STATIC, [&](uint32_t chunk) {
+        auto end = std::min((chunk + 1u) * REFIT_CHUNK_SIZE, node_count);
+        for (auto i = chunk * REFIT_CHUNK_SIZE; i < end; i++) {
+            arrivals[i].store(0u, std::memory_order_relaxed);
+            if (auto &&node = nodes[i]; node.count == 0u) {
+                parents[node.index] = i;
+                parents[node.index + 1u] = i;
+            }
+        }
+    });
+
+    scheduler.dispatch(chunk_count, CPUSchedulingPolicy::WORK_STEALING, [&](uint32_t chunk) {
+        auto end = std::min((chunk + 1u) * REFIT_CHUNK_SIZE, node_count);
+        for (auto i = chunk * REFIT_CHUNK_SIZE; i < end; i++) {
+            auto &&leaf = nodes[i];
+            if (leaf.count == 0u) { continue; }
+            auto bounds = leaf_bounds(leaf.index, leaf.count);
+            leaf.min = bounds.min;
+            leaf.max = bounds.max;
+            for (auto index = i; index != 0u;) {
+                index = parents[index];
+                if (arrivals[index].fetch_add(1u, std::memory_order_acq_rel) == 0u) { break; }  // the sibling is still on its way up
+                auto &&node = nodes[index];
+                CPUBoundingBox box{nodes[node.index].min, nodes[node.index].max};
+                box.extend(CPUBoundingBox{nodes[node.index + 1u].min, nodes[node.index + 1u].max});
+                node.min = box.min;
+                node.max = box.max;
+            }
+        }
+    });
+}
+
+void refit_wide_bvh(CPUScheduler &scheduler, std::vector<CPUWideBVHNode> &wide_nodes, const std::vector<uint32_t> &slot_nodes, const std::vector<CPUBVHNode> &nodes) {
+    auto wide_node_count = static_cast<uint32_t>(wide_nodes.size());
+    auto chunk_count = (wide_node_count + REFIT_CHUNK_SIZE - 1u) / REFIT_CHUNK_SIZE;
+    scheduler.dispatch(chunk_count, CPUSchedulingPolicy::STATIC, [&](uint32_t chunk) {
+        auto end = std::min((chunk + 1u) * REFIT_CHUNK_SIZE, wide_node_count);
+        for (auto i = chunk * REFIT_CHUNK_SIZE; i < end; i++) {
+            auto &&wide_node = wide_nodes[i];
+            for (auto slot = 0u; slot < 8u; slot++) {
+                if (auto index = slot_nodes[i * 8u + slot]; index != ~0u) {
+                    auto &&node = nodes[index];
+                    wide_node.min_x[slot] = node.min.x;
+                    wide_node.max_x[slot] = node.max.x;
+                    wide_node.min_y[slot] = node.min.y;
+                    wide_node.max_y[slot] = node.max.y;
+                    wide_node.min_z[slot] = node.min.z;
+                    wide_node.max_z[slot] = node.max.z;
+                }
+            }
+        }
+    });
+}
+
+float bvh_cost(const std::vector<CPUBVHNode> &nodes) noexcept {
+    if (nodes.empty()) { return 0.0f; }
+    auto cost = 0.0;
+    for (auto &&node : nodes) {
+        auto area = CPUBoundingBox{node.min, node.max}.surface_area();
+        cost += area * (node.count == 0u ? TRAVERSAL_COST : static_cast<float>(node.count));
+    }
+    auto root_area = CPUBoundingBox{nodes.front().min, nodes.front().max}.surface_area();
+    return root_area == 0.0f ? 0.0f : static_cast<float>(cost / root_area);
+}
+
+CPUBVH build_bvh(CPUScheduler &scheduler, const std::vector<CPUBoundingBox> &primitive_bounds) {
+    CPUBVH bvh;
+    BVHBuilder{scheduler, primitive_bounds, bvh}.build();
+    return bvh;
+}
+
+CPUBVH build_linear_bvh(CPUScheduler &scheduler, const std::vector<CPUBoundingBox> &primitive_bounds, bool restructure_treelets) {
+    CPUBVH bvh;
+    LinearBVHBuilder{scheduler, primitive_bounds, bvh}.build();
+    if (restructure_treelets) { TreeletOptimizer{scheduler, bvh.nodes}.optimize(); }
+    return bvh;
+}
+
+}
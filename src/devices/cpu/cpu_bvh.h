@@ -0,0 +1,105 @@
+#pragma once
+
+#include <limits>
+#include <algorithm>
+#include <vector>
+#include <functional>
+#include <core/mathematics.h>
+
+#include "cpu_scheduler.h"
+
+namespace luisa::cpu {
+
+// extended per component, so the build loops compile to plain min/max instructions
+struct CPUBoundingBox {
+
+    math::packed_float3 min{std::numeric_limits<float>::max()};
+    math::packed_float3 max{std::numeric_limits<float>::lowest()};
+
+    void extend(math::packed_float3 p) noexcept {
+        for (auto i = 0; i < 3; i++) {
+            min[i] = std::min(min[i], p[i]);
+            max[i] = std::max(max[i], p[i]);
+        }
+    }
+
+    void extend(const CPUBoundingBox &box) noexcept {
+        for (auto i = 0; i < 3; i++) {
+            min[i] = std::min(min[i], box.min[i]);
+            max[i] = std::max(max[i], box.max[i]);
+        }
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return min.x > max.x || min.y > max.y || min.z > max.z; }
+    [[nodiscard]] math::packed_float3 centroid() const noexcept { return {0.5f * (min.x + max.x), 0.5f * (min.y + max.y), 0.5f * (min.z + max.z)}; }
+
+    [[nodiscard]] float surface_area() const noexcept {
+        if (empty()) { return 0.0f; }
+        auto dx = max.x - min.x;
+        auto dy = max.y - min.y;
+        auto dz = max.z - min.z;
+        return 2.0f * (dx * dy + dy * dz + dz * dx);
+    }
+};
+
+// 32 bytes, two nodes per cache line; the children of an interior node are always allocated
+// as a pair, so a single index addresses both of them
+struct CPUBVHNode {
+    math::packed_float3 min;
+    uint32_t index;  // interior nodes: first child (the second one is index + 1); leaves: first primitive
+    math::packed_float3 max;
+    uint32_t count;  // number of primitives in leaves, 0 for interior nodes
+};
+
+static_assert(sizeof(CPUBVHNode) == 32ul);
+
+struct CPUBVH {
+    std::vector<CPUBVHNode> nodes;
+    std::vector<uint32_t> primitive_indices;  // leaves reference contiguous ranges of this array
+};
+
+constexpr auto CPU_BVH_MAX_LEAF_SIZE = 4u;
+constexpr auto CPU_BVH_MAX_DEPTH = 64u;
+
+// 8-wide node collapsed from the binary BVH, with the children boxes stored per axis so that
+// all of them are tested against a ray in a single pass; empty slots have boxes no ray can hit
+struct alignas(32) CPUWideBVHNode {
+    float min_x[8];
+    float max_x[8];
+    float min_y[8];
+    float max_y[8];
+    float min_z[8];
+    float max_z[8];
+    uint32_t children[8];  // wide node index for interior children, first primitive for leaves
+    uint32_t counts[8];    // number of primitives in leaf children, 0 for interior children and empty slots
+};
+
+static_assert(sizeof(CPUWideBVHNode) == 256ul);
+
+// Binned SAH builder over arbitrary primitive bounds. Large nodes are split one after another with
+// their binning passes spread over the workers; once nodes get small, whole subtrees are built in parallel.
+[[nodiscard]] CPUBVH build_bvh(CPUScheduler &scheduler, const std::vector<CPUBoundingBox> &primitive_bounds);
+
+// Linear BVH builder: the primitives are sorted along a Morton curve through their centroids by a parallel radix sort, and every
+// node is split at the highest bit differing within its range, with the subtrees emitted in parallel. Much faster to build than
+// build_bvh() but slower to trace; restructuring the treelets afterwards closes part of the gap, though children may then be
+// allocated before their parents.
+[[nodiscard]] CPUBVH build_linear_bvh(CPUScheduler &scheduler, const std::vector<CPUBoundingBox> &primitive_bounds, bool restructure_treelets);
+
+// Greedily opens the interior child with the largest surface area until every wide node holds up to
+// eight children; leaves keep referencing the primitive ranges of the binary BVH. The binary node behind
+// every child slot (eight per wide node, ~0u for empty slots) is written to slot_nodes for refitting.
+[[nodiscard]] std::vector<CPUWideBVHNode> collapse_bvh(const CPUBVH &bvh, std::vector<uint32_t> &slot_nodes);
+
+// Updates the bounds of the nodes after their primitives moved, keeping the topology and the primitive ranges of the
+// leaves, whose bounds are given by leaf_bounds(first, count). Every leaf walks up towards the root in parallel, and
+// the last child to arrive at a node updates it.
+void refit_bvh(CPUScheduler &scheduler, std::vector<CPUBVHNode> &nodes, const std::function<CPUBoundingBox(uint32_t, uint32_t)> &leaf_bounds);
+
+// copies the bounds of refitted binary nodes into the wide slots they were collapsed into
+void refit_wide_bvh(CPUScheduler &scheduler, std::vector<CPUWideBVHNode> &wide_nodes, const std::vector<uint32_t> &slot_nodes, const std::vector<CPUBVHNode> &nodes);
+
+// SAH cost relative to a single primitive intersection, normalized by the area of the root, to judge refitted trees against their builds
+[[nodiscard]] float bvh_cost(const std::vector<CPUBVHNode> &nodes) noexcept;
+
+}
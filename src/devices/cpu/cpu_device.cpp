@@ -0,0 +1,117 @@
+#include <future>
+
+#include "cpu_device.h"
+#include "cpu_buffer.h"
+#include "cpu_kernel.h"
+#include "cpu_texture.h"
+#include "cpu_acceleration_structure.h"
+
+namespace luisa::cpu {
+
+CPUDevice::CPUDevice() {
+    _queue_thread = std::thread{[this] {
+        for (;;) {
+            CommandBuffer command_buffer;
+            {
+                std::unique_lock lock{_queue_mutex};
+                _queue_cv.wait(lock, [this] { return _should_stop || !_command_buffers.empty(); });
+                if (_command_buffers.empty()) { return; }
+                command_buffer = std::move(_command_buffers.front());
+                _command_buffers.pop();
+            }
+            command_buffer.dispatcher->commit();
+            command_buffer.callback();
+        }
+    }};
+}
+
+CPUDevice::~CPUDevice() noexcept {
+    {
+        std::lock_guard lock{_queue_mutex};
+        _should_stop = true;
+    }
+    _queue_cv.notify_one();
+    _queue_thread.join();
+}
+
+void CPUDevice::_commit(std::unique_ptr<CPUKernelDispatcher> dispatcher, std::function<void()> callback) {
+    {
+        std::lock_guard lock{_queue_mutex};
+        _command_buffers.push({std::move(dispatcher), std::move(callback)});
+    }
+    _queue_cv.notify_one();
+}
+
+std::shared_ptr<Kernel> CPUDevice::create_kernel(std::string_view function_name) {
+    auto function = cpu_kernel_function(function_name);
+    if (function == nullptr) {
+        THROW_DEVICE_ERROR("kernel \"", function_name, "\" is not available on the CPU device.");
+    }
+    return std::make_shared<CPUKernel>(*function);
+}
+
+std::shared_ptr<Texture> CPUDevice::create_texture(math::uint2 size, TextureFormatTag format_tag, TextureAccessTag access_tag) {
+    return std::make_shared<CPUTexture>(size, format_tag, access_tag);
+}
+
+std::shared_ptr<Buffer> CPUDevice::create_buffer(size_t capacity, BufferStorageTag storage) {
+    return std::make_shared<CPUBuffer>(capacity, storage);
+}
+
+std::shared_ptr<AccelerationStructure> CPUDevice::create_acceleration_structure(
+    Buffer &position_buffer, size_t stride, size_t triangle_count, AccelerationStructureBuildMode build_mode) {
+    // built on the calling thread, which may overlap with kernels the queue thread runs on the device scheduler
+    CPUScheduler build_scheduler;
+    auto structure = std::make_shared<CPUAccelerationStructure>(build_scheduler, position_buffer, stride, triangle_count, build_mode, _traversal_mode);
+    structure->set_coherence_sort_threshold(_coherence_sort_threshold);
+    return structure;
+}
+
+std::shared_ptr<AccelerationStructure> CPUDevice::create_instance_acceleration_structure(
+    const std::vector<std::shared_ptr<AccelerationStructure>> &meshes, Buffer &mesh_index_buffer, Buffer &transform_buffer, size_t instance_count) {
+    return create_motion_instance_acceleration_structure(meshes, mesh_index_buffer, transform_buffer, instance_count, 1u, 0.0f, 0.0f);
+}
+
+std::shared_ptr<AccelerationStructure> CPUDevice::create_motion_instance_acceleration_structure(
+    const std::vector<std::shared_ptr<AccelerationStructure>> &meshes, Buffer &mesh_index_buffer, Buffer &transform_buffer, size_t instance_count,
+    uint32_t keyframe_count, float shutter_open, float shutter_close) {
+
+    if (keyframe_count == 0u) {
+        THROW_DEVICE_ERROR("instances should have at least one keyframe.");
+    }
+    std::vector<std::shared_ptr<CPUAccelerationStructure>> cpu_meshes;
+    cpu_meshes.reserve(meshes.size());
+    for (auto &&mesh : meshes) {
+        auto cpu_mesh = std::dynamic_pointer_cast<CPUAccelerationStructure>(mesh);
+        if (cpu_mesh == nullptr) {
+            THROW_DEVICE_ERROR("instanced meshes should be triangle acceleration structures created by the CPU device.");
+        }
+        cpu_meshes.emplace_back(std::move(cpu_mesh));
+    }
+    CPUScheduler build_scheduler;
+    auto structure = std::make_shared<CPUInstanceAccelerationStructure>(build_scheduler, std::move(cpu_meshes), mesh_index_buffer, transform_buffer, instance_count,
+                                                                        keyframe_count, shutter_open, shutter_close, _traversal_mode);
+    structure->set_coherence_sort_threshold(_coherence_sort_threshold);
+    return structure;
+}
+
+void CPUDevice::launch(std::function<void(KernelDispatcher &)> dispatch) {
+    auto dispatcher = std::make_unique<CPUKernelDispatcher>(_scheduler, _scheduling_policy);
+    dispatch(*dispatcher);
+    std::promise<void> completed;
+    auto future = completed.get_future();
+    _commit(std::move(dispatcher), [&completed] { completed.set_value(); });
+    future.wait();
+}
+
+void CPUDevice::launch_async(std::function<void(KernelDispatcher &)> dispatch, std::function<void()> callback) {
+    auto dispatcher = std::make_unique<CPUKernelDispatcher>(_scheduler, _scheduling_policy);
+    dispatch(*dispatcher);
+    _commit(std::move(dispatcher), std::move(callback));
+}
+
+[[nodiscard]] std::shared_ptr<Device> CPUDevice::create() {
+    return std::make_shared<CPUDevice>();
+}
+
+}
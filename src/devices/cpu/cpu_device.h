@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <core/device.h>
+
+#include "cpu_kernel.h"
+#include "cpu_acceleration_structure.h"
+
+namespace luisa::cpu {
+
+class CPUDevice : public Device {
+
+private:
+    struct CommandBuffer {
+        std::unique_ptr<CPUKernelDispatcher> dispatcher;
+        std::function<void()> callback;
+    };
+    
+    // launches are executed in submission order by a single queue thread,
+    // which in turn spreads every kernel over the shared worker pool
+    std::queue<CommandBuffer> _command_buffers;
+    std::mutex _queue_mutex;
+    std::condition_variable _queue_cv;
+    bool _should_stop{false};
+    std::thread _queue_thread;
+    CPUScheduler _scheduler;
+    CPUSchedulingPolicy _scheduling_policy{CPUSchedulingPolicy::WORK_STEALING};
+    CPUTraversalMode _traversal_mode{CPUTraversalMode::WIDE};
+    uint32_t _coherence_sort_threshold{CPU_COHERENCE_SORT_DISABLED};
+    
+    void _commit(std::unique_ptr<CPUKernelDispatcher> dispatcher, std::function<void()> callback);
+
+public:
+    CPUDevice();
+    ~CPUDevice() noexcept;
+    DEVICE_CREATOR("CPU");
+    
+    std::shared_ptr<Kernel> create_kernel(std::string_view function_name) override;
+    std::shared_ptr<Texture> create_texture(math::uint2 size, TextureFormatTag format_tag, TextureAccessTag access_tag) override;
+    std::shared_ptr<AccelerationStructure> create_acceleration_structure(
+        Buffer &position_buffer, size_t stride, size_t triangle_count, AccelerationStructureBuildMode build_mode) override;
+    std::shared_ptr<AccelerationStructure> create_instance_acceleration_structure(
+        const std::vector<std::shared_ptr<AccelerationStructure>> &meshes, Buffer &mesh_index_buffer, Buffer &transform_buffer, size_t instance_count) override;
+    std::shared_ptr<AccelerationStructure> create_motion_instance_acceleration_structure(
+        const std::vector<std::shared_ptr<AccelerationStructure>> &meshes, Buffer &mesh_index_buffer, Buffer &transform_buffer, size_t instance_count,
+        uint32_t keyframe_count, float shutter_open, float shutter_close) override;
+    std::shared_ptr<Buffer> create_buffer(size_t capacity, BufferStorageTag storage) override;
+    
+    void launch(std::function<void(KernelDispatcher &)> dispatch) override;
+    void launch_async(std::function<void(KernelDispatcher &)> dispatch, std::function<void()> callback) override;
+    
+    // applies to launches encoded afterwards; STATIC is kept for comparison against work stealing
+    void set_scheduling_policy(CPUSchedulingPolicy policy) noexcept { _scheduling_policy = policy; }
+    [[nodiscard]] CPUSchedulingPolicy scheduling_policy() const noexcept { return _scheduling_policy; }
+    
+    // initial mode of acceleration structures created afterwards, see CPUAccelerationStructure::set_traversal_mode()
+    void set_traversal_mode(CPUTraversalMode mode) noexcept { _traversal_mode = mode; }
+    [[nodiscard]] CPUTraversalMode traversal_mode() const noexcept { return _traversal_mode; }
+    
+    // initial threshold of acceleration structures created afterwards, see CPUAccelerationStructure::set_coherence_sort_threshold();
+    // sorting pays off for incoherent rays against scenes larger than the caches, and is disabled by default
+    void set_coherence_sort_threshold(uint32_t ray_count) noexcept { _coherence_sort_threshold = ray_count; }
+    [[nodiscard]] uint32_t coherence_sort_threshold() const noexcept { return _coherence_sort_threshold; }
+    
+};
+
+}
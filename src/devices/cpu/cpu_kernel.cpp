@@ -0,0 +1,49 @@
+#include <cstring>
+#include <stdexcept>
+#include "cpu_kernel.h"
+
+namespace luisa::cpu {
+
+void CPUKernelDispatcher::operator()(Kernel &kernel, math::uint2 threadgroups, math::uint2 threadgroup_size, std::function<void(KernelArgumentEncoder &)> encode) {
+
+    auto &&function = dynamic_cast<CPUKernel &>(kernel).function();
+    std::vector<CPUKernelArgument> arguments(function.arguments.size());
+    CPUKernelArgumentEncoder encoder{function, arguments};
+    encode(encoder);
+
+    enqueue([this, &function, arguments = std::move(arguments), threadgroups, threadgroup_size] {
+        parallel_for(threadgroups.x * threadgroups.y, [&](uint32_t index) {
+            CPUThreadgroup group{{index % threadgroups.x, index / threadgroups.x}, threadgroup_size, threadgroups};
+            function.invoke(arguments.data(), group);
+        });
+    });
+}
+
+void CPUKernelDispatcher::commit() {
+    for (auto &&command : _commands) { command(); }
+    _commands.clear();
+}
+
+std::unique_ptr<KernelArgumentProxy> CPUKernelArgumentEncoder::operator[](std::string_view name) {
+    for (auto i = 0ul; i < _function.arguments.size(); i++) {
+        if (_function.arguments[i] == name) {
+            return std::make_unique<CPUKernelArgumentProxy>(_arguments[i]);
+        }
+    }
+    throw std::runtime_error{"argument not found in CPU kernel."};
+}
+
+void CPUKernelArgumentProxy::set_buffer(Buffer &buffer, size_t offset) {
+    _argument.buffer = static_cast<std::byte *>(buffer.data()) + offset;
+}
+
+void CPUKernelArgumentProxy::set_texture(Texture &texture) {
+    _argument.texture = &dynamic_cast<CPUTexture &>(texture);
+}
+
+void CPUKernelArgumentProxy::set_bytes(const void *bytes, size_t size) {
+    _argument.bytes.resize(size);
+    std::memcpy(_argument.bytes.data(), bytes, size);
+}
+
+}
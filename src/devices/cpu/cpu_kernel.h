@@ -0,0 +1,116 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include <core/kernel.h>
+
+#include "cpu_buffer.h"
+#include "cpu_texture.h"
+#include "cpu_scheduler.h"
+
+namespace luisa::cpu {
+
+struct CPUKernelArgument {
+
+    std::byte *buffer{nullptr};
+    CPUTexture *texture{nullptr};
+    std::vector<std::byte> bytes;
+
+    template<typename T>
+    [[nodiscard]] T *pointer() const noexcept { return reinterpret_cast<T *>(buffer); }
+
+    // constant arguments may come either from set_bytes() or from a bound buffer
+    template<typename T>
+    [[nodiscard]] const T &value() const noexcept {
+        return *reinterpret_cast<const T *>(bytes.empty() ? buffer : bytes.data());
+    }
+};
+
+struct CPUThreadgroup {
+
+    math::uint2 position;
+    math::uint2 size;
+    math::uint2 count;
+
+    template<typename Func>
+    void for_each_thread(Func &&func) const {
+        auto origin = position * size;
+        for (auto y = 0u; y < size.y; y++) {
+            for (auto x = 0u; x < size.x; x++) {
+                func(math::uint2{origin.x + x, origin.y + y});
+            }
+        }
+    }
+};
+
+// host entry of a kernel: argument names in the order the invoker expects them,
+// and an invoker running one whole threadgroup so the kernel body is inlined into the thread loop
+struct CPUKernelFunction {
+    std::vector<std::string_view> arguments;
+    void (*invoke)(const CPUKernelArgument *arguments, const CPUThreadgroup &group);
+};
+
+// defined in cpu_kernels.cpp, where the kernel sources are compiled for the host
+[[nodiscard]] const CPUKernelFunction *cpu_kernel_function(std::string_view name) noexcept;
+
+class CPUKernelArgumentProxy : public KernelArgumentProxy {
+
+private:
+    CPUKernelArgument &_argument;
+
+public:
+    explicit CPUKernelArgumentProxy(CPUKernelArgument &argument) noexcept : _argument{argument} {}
+
+    void set_buffer(Buffer &buffer, size_t offset) override;
+    void set_texture(Texture &texture) override;
+    void set_bytes(const void *bytes, size_t size) override;
+
+};
+
+class CPUKernelArgumentEncoder : public KernelArgumentEncoder {
+
+private:
+    const CPUKernelFunction &_function;
+    std::vector<CPUKernelArgument> &_arguments;
+
+public:
+    CPUKernelArgumentEncoder(const CPUKernelFunction &function, std::vector<CPUKernelArgument> &arguments) noexcept
+        : _function{function}, _arguments{arguments} {}
+    [[nodiscard]] std::unique_ptr<KernelArgumentProxy> operator[](std::string_view name) override;
+
+};
+
+class CPUKernel : public Kernel {
+
+private:
+    const CPUKernelFunction &_function;
+
+public:
+    explicit CPUKernel(const CPUKernelFunction &function) noexcept : _function{function} {}
+    [[nodiscard]] const CPUKernelFunction &function() const noexcept { return _function; }
+
+};
+
+// Commands are recorded while encoding and executed in order when the device commits them,
+// mirroring the command buffer semantics of the Metal backend.
+class CPUKernelDispatcher : public KernelDispatcher {
+
+private:
+    CPUScheduler &_scheduler;
+    CPUSchedulingPolicy _policy;
+    std::vector<std::function<void()>> _commands;
+
+public:
+    CPUKernelDispatcher(CPUScheduler &scheduler, CPUSchedulingPolicy policy) noexcept : _scheduler{scheduler}, _policy{policy} {}
+    void operator()(Kernel &kernel, math::uint2 threadgroups, math::uint2 threadgroup_size, std::function<void(KernelArgumentEncoder &)> encode) override;
+    void enqueue(std::function<void()> command) { _commands.emplace_back(std::move(command)); }
+
+    // only meaningful inside enqueued commands, i.e. while the dispatcher is being committed
+    void parallel_for(uint32_t task_count, const std::function<void(uint32_t)> &task) { _scheduler.dispatch(task_count, _policy, task); }
+    [[nodiscard]] CPUScheduler &scheduler() noexcept { return _scheduler; }
+    void commit();
+
+};
+
+}
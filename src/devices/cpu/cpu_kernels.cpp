@@ -0,0 +1,324 @@
+#include <unordered_map>
+
+#include <core/ray.h>
+#include <core/color.h>
+#include <core/compaction.h>
+#include <core/filter.h>
+#include <core/intersection.h>
+#include <core/scene.h>
+#include <cameras/pinhole_camera.h>
+#include <films/rgb_film.h>
+#include <integrators/path_tracing.h>
+#include <samplers/halton_sampler.h>
+
+#include "cpu_kernel.h"
+
+// The kernel sources are compiled for the host through the non-Metal branch of compatibility.h.
+// Everything above must be included first, since that branch defines the Metal address space
+// qualifiers as macros.
+#include <camera_pinhole.metal>
+#include <compaction.metal>
+#include <film_rgb.metal>
+#include <filter.metal>
+#include <integrator_path_tracing.metal>
+#include <sampler.metal>
+
+namespace luisa::cpu {
+
+namespace {
+
+template<metal::access mode>
+[[nodiscard]] metal::texture2d<float, mode> texture_view(const CPUKernelArgument &argument) noexcept {
+    auto texture = argument.texture;
+    return {texture->data(), texture->size().x, texture->size().y, texture->channels()};
+}
+
+}
+
+const CPUKernelFunction *cpu_kernel_function(std::string_view name) noexcept {
+    
+    static const std::unordered_map<std::string_view, CPUKernelFunction> functions{
+        {"pinhole_camera_generate_rays", {{"uniforms", "ray_geometries", "ray_throughputs", "ray_radiances", "ray_pixels", "random"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<PinholeCameraGenerateRaysUniforms>();
+            auto ray_geometries = args[1].pointer<RayGeometry>();
+            auto ray_throughputs = args[2].pointer<RayThroughput>();
+            auto ray_radiances = args[3].pointer<RayRadiance>();
+            auto ray_pixels = args[4].pointer<RayPixel>();
+            auto random = texture_view<access::read>(args[5]);
+            group.for_each_thread([&](uint2 tid) { pinhole_camera_generate_rays(uniforms, ray_geometries, ray_throughputs, ray_radiances, ray_pixels, random, tid); });
+        }}},
+        {"pinhole_camera_generate_rays_compact", {{"uniforms", "ray_geometries", "ray_throughputs", "ray_radiances", "ray_pixels", "random"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<PinholeCameraGenerateRaysUniforms>();
+            auto ray_geometries = args[1].pointer<RayGeometry>();
+            auto ray_throughputs = args[2].pointer<CompactRayThroughput>();
+            auto ray_radiances = args[3].pointer<CompactRayRadiance>();
+            auto ray_pixels = args[4].pointer<CompactRayPixel>();
+            auto random = texture_view<access::read>(args[5]);
+            group.for_each_thread([&](uint2 tid) { pinhole_camera_generate_rays_compact(uniforms, ray_geometries, ray_throughputs, ray_radiances, ray_pixels, random, tid); });
+        }}},
+        {"compaction_count_rays", {{"uniforms", "rays", "ray_count", "offsets"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<CompactionUniforms>();
+            auto rays = args[1].pointer<const Ray>();
+            auto &&ray_count = args[2].value<uint32_t>();
+            auto offsets = args[3].pointer<uint32_t>();
+            group.for_each_thread([&](uint2 tid) { compaction_count_rays(uniforms, rays, ray_count, offsets, tid); });
+        }}},
+        {"compaction_scan_up", {{"uniforms", "offsets"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<CompactionUniforms>();
+            auto offsets = args[1].pointer<uint32_t>();
+            group.for_each_thread([&](uint2 tid) { compaction_scan_up(uniforms, offsets, tid); });
+        }}},
+        {"compaction_scan_total", {{"uniforms", "offsets", "total_count"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<CompactionUniforms>();
+            auto offsets = args[1].pointer<uint32_t>();
+            auto &&total_count = *args[2].pointer<uint32_t>();
+            group.for_each_thread([&](uint2 tid) { compaction_scan_total(uniforms, offsets, total_count, tid); });
+        }}},
+        {"compaction_scan_down", {{"uniforms", "offsets"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<CompactionUniforms>();
+            auto offsets = args[1].pointer<uint32_t>();
+            group.for_each_thread([&](uint2 tid) { compaction_scan_down(uniforms, offsets, tid); });
+        }}},
+        {"compaction_scatter_rays", {{"uniforms", "rays", "ray_count", "offsets", "output_rays", "gather_rays"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<CompactionUniforms>();
+            auto rays = args[1].pointer<const Ray>();
+            auto &&ray_count = args[2].value<uint32_t>();
+            auto offsets = args[3].pointer<const uint32_t>();
+            auto output_rays = args[4].pointer<Ray>();
+            auto gather_rays = args[5].pointer<GatherRay>();
+            group.for_each_thread([&](uint2 tid) { compaction_scatter_rays(uniforms, rays, ray_count, offsets, output_rays, gather_rays, tid); });
+        }}},
+        {"compaction_count_ray_queue", {{"uniforms", "ray_geometries", "ray_count", "offsets"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<CompactionUniforms>();
+            auto ray_geometries = args[1].pointer<const RayGeometry>();
+            auto &&ray_count = args[2].value<uint32_t>();
+            auto offsets = args[3].pointer<uint32_t>();
+            group.for_each_thread([&](uint2 tid) { compaction_count_ray_queue(uniforms, ray_geometries, ray_count, offsets, tid); });
+        }}},
+        {"compaction_scatter_ray_queue", {{"uniforms", "ray_geometries", "ray_throughputs", "ray_radiances", "ray_pixels", "ray_count", "offsets",
+                                           "output_ray_geometries", "output_ray_throughputs", "output_ray_radiances", "output_ray_pixels", "gather_rays"},
+                                          [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<CompactionUniforms>();
+            auto ray_geometries = args[1].pointer<const RayGeometry>();
+            auto ray_throughputs = args[2].pointer<const RayThroughput>();
+            auto ray_radiances = args[3].pointer<const RayRadiance>();
+            auto ray_pixels = args[4].pointer<const RayPixel>();
+            auto &&ray_count = args[5].value<uint32_t>();
+            auto offsets = args[6].pointer<const uint32_t>();
+            auto output_ray_geometries = args[7].pointer<RayGeometry>();
+            auto output_ray_throughputs = args[8].pointer<RayThroughput>();
+            auto output_ray_radiances = args[9].pointer<RayRadiance>();
+            auto output_ray_pixels = args[10].pointer<RayPixel>();
+            auto gather_rays = args[11].pointer<GatherRay>();
+            group.for_each_thread([&](uint2 tid) {
+                compaction_scatter_ray_queue(uniforms, ray_geometries, ray_throughputs, ray_radiances, ray_pixels, ray_count, offsets,
+                                             output_ray_geometries, output_ray_throughputs, output_ray_radiances, output_ray_pixels, gather_rays, tid);
+            });
+        }}},
+        {"compaction_scatter_ray_queue_compact", {{"uniforms", "ray_geometries", "ray_throughputs", "ray_radiances", "ray_pixels", "ray_count", "offsets",
+                                                   "output_ray_geometries", "output_ray_throughputs", "output_ray_radiances", "output_ray_pixels", "gather_rays"},
+                                                  [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<CompactionUniforms>();
+            auto ray_geometries = args[1].pointer<const RayGeometry>();
+            auto ray_throughputs = args[2].pointer<const CompactRayThroughput>();
+            auto ray_radiances = args[3].pointer<const CompactRayRadiance>();
+            auto ray_pixels = args[4].pointer<const CompactRayPixel>();
+            auto &&ray_count = args[5].value<uint32_t>();
+            auto offsets = args[6].pointer<const uint32_t>();
+            auto output_ray_geometries = args[7].pointer<RayGeometry>();
+            auto output_ray_throughputs = args[8].pointer<CompactRayThroughput>();
+            auto output_ray_radiances = args[9].pointer<CompactRayRadiance>();
+            auto output_ray_pixels = args[10].pointer<CompactRayPixel>();
+            auto gather_rays = args[11].pointer<CompactGatherRay>();
+            group.for_each_thread([&](uint2 tid) {
+                compaction_scatter_ray_queue_compact(uniforms, ray_geometries, ray_throughputs, ray_radiances, ray_pixels, ray_count, offsets,
+                                                     output_ray_geometries, output_ray_throughputs, output_ray_radiances, output_ray_pixels, gather_rays, tid);
+            });
+        }}},
+        {"rgb_film_convert_colorspace", {{"uniforms", "result"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<RGBFilmConvertColorspaceUniforms>();
+            auto result = texture_view<access::read_write>(args[1]);
+            group.for_each_thread([&](uint2 tid) { rgb_film_convert_colorspace(uniforms, result, tid); });
+        }}},
+        {"filter_apply", {{"uniforms", "rays", "weights", "result", "compensation"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<FilterApplyUniforms>();
+            auto rays = args[1].pointer<const GatherRay>();
+            auto weights = args[2].pointer<const float>();
+            auto result = texture_view<access::read_write>(args[3]);
+            auto compensation = texture_view<access::read_write>(args[4]);
+            group.for_each_thread([&](uint2 tid) { filter_apply(uniforms, rays, weights, result, compensation, tid); });
+        }}},
+        {"filter_apply_compact", {{"uniforms", "rays", "weights", "result", "compensation"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<FilterApplyUniforms>();
+            auto rays = args[1].pointer<const CompactGatherRay>();
+            auto weights = args[2].pointer<const float>();
+            auto result = texture_view<access::read_write>(args[3]);
+            auto compensation = texture_view<access::read_write>(args[4]);
+            group.for_each_thread([&](uint2 tid) { filter_apply_compact(uniforms, rays, weights, result, compensation, tid); });
+        }}},
+        {"filter_accumulate", {{"uniforms", "rays", "result", "compensation"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<FilterApplyUniforms>();
+            auto rays = args[1].pointer<const GatherRay>();
+            auto result = texture_view<access::read_write>(args[2]);
+            auto compensation = texture_view<access::read_write>(args[3]);
+            group.for_each_thread([&](uint2 tid) { filter_accumulate(uniforms, rays, result, compensation, tid); });
+        }}},
+        {"filter_accumulate_compact", {{"uniforms", "rays", "result", "compensation"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<FilterApplyUniforms>();
+            auto rays = args[1].pointer<const CompactGatherRay>();
+            auto result = texture_view<access::read_write>(args[2]);
+            auto compensation = texture_view<access::read_write>(args[3]);
+            group.for_each_thread([&](uint2 tid) { filter_accumulate_compact(uniforms, rays, result, compensation, tid); });
+        }}},
+        {"filter_splat", {{"uniforms", "rays", "weights", "accumulators"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<FilterApplyUniforms>();
+            auto rays = args[1].pointer<const GatherRay>();
+            auto weights = args[2].pointer<const float>();
+            auto accumulators = args[3].pointer<float4>();
+            group.for_each_thread([&](uint2 tid) { filter_splat(uniforms, rays, weights, accumulators, tid); });
+        }}},
+        {"filter_splat_compact", {{"uniforms", "rays", "weights", "accumulators"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<FilterApplyUniforms>();
+            auto rays = args[1].pointer<const CompactGatherRay>();
+            auto weights = args[2].pointer<const float>();
+            auto accumulators = args[3].pointer<float4>();
+            group.for_each_thread([&](uint2 tid) { filter_splat_compact(uniforms, rays, weights, accumulators, tid); });
+        }}},
+        {"filter_splat_merge", {{"uniforms", "accumulators", "result", "compensation"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<FilterApplyUniforms>();
+            auto accumulators = args[1].pointer<const float4>();
+            auto result = texture_view<access::read_write>(args[2]);
+            auto compensation = texture_view<access::read_write>(args[3]);
+            group.for_each_thread([&](uint2 tid) { filter_splat_merge(uniforms, accumulators, result, compensation, tid); });
+        }}},
+        {"filter_warp_pixel_samples", {{"uniforms", "inverse_cdf", "random"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<FilterWarpPixelSamplesUniforms>();
+            auto inverse_cdf = args[1].pointer<const float>();
+            auto random = texture_view<access::read_write>(args[2]);
+            group.for_each_thread([&](uint2 tid) { filter_warp_pixel_samples(uniforms, inverse_cdf, random, tid); });
+        }}},
+        {"path_tracing_sample_lights", {{"uniforms", "ray_geometries", "ray_pixels", "ray_count", "intersections", "positions", "lights",
+                                         "shadow_ray_geometries", "shadow_ray_throughputs", "shadow_ray_pixels", "sampler_dimensions", "sampler_table", "sampler_blue_noise"},
+                                        [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<PathTracingUniforms>();
+            auto ray_geometries = args[1].pointer<const RayGeometry>();
+            auto ray_pixels = args[2].pointer<const RayPixel>();
+            auto &&ray_count = args[3].value<uint32_t>();
+            auto intersections = args[4].pointer<const Intersection>();
+            auto positions = args[5].pointer<const float3>();
+            auto lights = args[6].pointer<const LightData>();
+            auto shadow_ray_geometries = args[7].pointer<RayGeometry>();
+            auto shadow_ray_throughputs = args[8].pointer<RayThroughput>();
+            auto shadow_ray_pixels = args[9].pointer<RayPixel>();
+            auto sampler_dimensions = args[10].pointer<const HaltonSamplerDimension>();
+            auto sampler_table = args[11].pointer<const float>();
+            auto sampler_blue_noise = args[12].pointer<const float>();
+            group.for_each_thread([&](uint2 tid) {
+                path_tracing_sample_lights(uniforms, ray_geometries, ray_pixels, ray_count, intersections, positions, lights,
+                                           shadow_ray_geometries, shadow_ray_throughputs, shadow_ray_pixels, sampler_dimensions, sampler_table, sampler_blue_noise, tid);
+            });
+        }}},
+        {"path_tracing_sample_lights_compact", {{"uniforms", "ray_geometries", "ray_pixels", "ray_count", "intersections", "positions", "lights",
+                                                 "shadow_ray_geometries", "shadow_ray_throughputs", "shadow_ray_pixels", "sampler_dimensions", "sampler_table", "sampler_blue_noise"},
+                                                [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<PathTracingUniforms>();
+            auto ray_geometries = args[1].pointer<const RayGeometry>();
+            auto ray_pixels = args[2].pointer<const CompactRayPixel>();
+            auto &&ray_count = args[3].value<uint32_t>();
+            auto intersections = args[4].pointer<const Intersection>();
+            auto positions = args[5].pointer<const float3>();
+            auto lights = args[6].pointer<const LightData>();
+            auto shadow_ray_geometries = args[7].pointer<RayGeometry>();
+            auto shadow_ray_throughputs = args[8].pointer<CompactRayThroughput>();
+            auto shadow_ray_pixels = args[9].pointer<CompactRayPixel>();
+            auto sampler_dimensions = args[10].pointer<const HaltonSamplerDimension>();
+            auto sampler_table = args[11].pointer<const float>();
+            auto sampler_blue_noise = args[12].pointer<const float>();
+            group.for_each_thread([&](uint2 tid) {
+                path_tracing_sample_lights_compact(uniforms, ray_geometries, ray_pixels, ray_count, intersections, positions, lights,
+                                                   shadow_ray_geometries, shadow_ray_throughputs, shadow_ray_pixels, sampler_dimensions, sampler_table, sampler_blue_noise, tid);
+            });
+        }}},
+        {"path_tracing_trace_radiance", {{"uniforms", "ray_geometries", "ray_throughputs", "ray_radiances", "ray_pixels", "ray_count", "intersections",
+                                          "shadow_ray_geometries", "shadow_ray_throughputs", "shadow_intersections", "positions", "normals", "material_ids", "materials", "sampler_dimensions", "sampler_table", "sampler_blue_noise"},
+                                         [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<PathTracingUniforms>();
+            auto ray_geometries = args[1].pointer<RayGeometry>();
+            auto ray_throughputs = args[2].pointer<RayThroughput>();
+            auto ray_radiances = args[3].pointer<RayRadiance>();
+            auto ray_pixels = args[4].pointer<const RayPixel>();
+            auto &&ray_count = args[5].value<uint32_t>();
+            auto intersections = args[6].pointer<const Intersection>();
+            auto shadow_ray_geometries = args[7].pointer<const RayGeometry>();
+            auto shadow_ray_throughputs = args[8].pointer<const RayThroughput>();
+            auto shadow_intersections = args[9].pointer<const ShadowIntersection>();
+            auto positions = args[10].pointer<const float3>();
+            auto normals = args[11].pointer<const float3>();
+            auto material_ids = args[12].pointer<const uint32_t>();
+            auto materials = args[13].pointer<const MaterialData>();
+            auto sampler_dimensions = args[14].pointer<const HaltonSamplerDimension>();
+            auto sampler_table = args[15].pointer<const float>();
+            auto sampler_blue_noise = args[16].pointer<const float>();
+            group.for_each_thread([&](uint2 tid) {
+                path_tracing_trace_radiance(uniforms, ray_geometries, ray_throughputs, ray_radiances, ray_pixels, ray_count, intersections,
+                                            shadow_ray_geometries, shadow_ray_throughputs, shadow_intersections, positions, normals, material_ids, materials, sampler_dimensions, sampler_table, sampler_blue_noise, tid);
+            });
+        }}},
+        {"path_tracing_trace_radiance_compact", {{"uniforms", "ray_geometries", "ray_throughputs", "ray_radiances", "ray_pixels", "ray_count", "intersections",
+                                                  "shadow_ray_geometries", "shadow_ray_throughputs", "shadow_intersections", "positions", "normals", "material_ids", "materials", "sampler_dimensions", "sampler_table", "sampler_blue_noise"},
+                                                 [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<PathTracingUniforms>();
+            auto ray_geometries = args[1].pointer<RayGeometry>();
+            auto ray_throughputs = args[2].pointer<CompactRayThroughput>();
+            auto ray_radiances = args[3].pointer<CompactRayRadiance>();
+            auto ray_pixels = args[4].pointer<const CompactRayPixel>();
+            auto &&ray_count = args[5].value<uint32_t>();
+            auto intersections = args[6].pointer<const Intersection>();
+            auto shadow_ray_geometries = args[7].pointer<const RayGeometry>();
+            auto shadow_ray_throughputs = args[8].pointer<const CompactRayThroughput>();
+            auto shadow_intersections = args[9].pointer<const ShadowIntersection>();
+            auto positions = args[10].pointer<const float3>();
+            auto normals = args[11].pointer<const float3>();
+            auto material_ids = args[12].pointer<const uint32_t>();
+            auto materials = args[13].pointer<const MaterialData>();
+            auto sampler_dimensions = args[14].pointer<const HaltonSamplerDimension>();
+            auto sampler_table = args[15].pointer<const float>();
+            auto sampler_blue_noise = args[16].pointer<const float>();
+            group.for_each_thread([&](uint2 tid) {
+                path_tracing_trace_radiance_compact(uniforms, ray_geometries, ray_throughputs, ray_radiances, ray_pixels, ray_count, intersections,
+                                                    shadow_ray_geometries, shadow_ray_throughputs, shadow_intersections, positions, normals, material_ids, materials, sampler_dimensions, sampler_table, sampler_blue_noise, tid);
+            });
+        }}},
+        {"path_tracing_write_aovs", {{"uniforms", "ray_geometries", "intersections", "normals", "material_ids", "materials",
+                                      "depths", "aov_normals", "albedos", "primitive_ids", "sample_counts"},
+                                     [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<PathTracingWriteAOVsUniforms>();
+            auto ray_geometries = args[1].pointer<const RayGeometry>();
+            auto intersections = args[2].pointer<const Intersection>();
+            auto normals = args[3].pointer<const float3>();
+            auto material_ids = args[4].pointer<const uint32_t>();
+            auto materials = args[5].pointer<const MaterialData>();
+            auto depths = args[6].pointer<float>();
+            auto aov_normals = args[7].pointer<packed_float3>();
+            auto albedos = args[8].pointer<packed_float3>();
+            auto primitive_ids = args[9].pointer<uint32_t>();
+            auto sample_counts = args[10].pointer<uint32_t>();
+            group.for_each_thread([&](uint2 tid) {
+                path_tracing_write_aovs(uniforms, ray_geometries, intersections, normals, material_ids, materials,
+                                        depths, aov_normals, albedos, primitive_ids, sample_counts, tid);
+            });
+        }}},
+        {"sampler_generate_samples", {{"uniforms", "sampler_dimensions", "sampler_table", "sampler_blue_noise", "random"}, [](const CPUKernelArgument *args, const CPUThreadgroup &group) {
+            auto &&uniforms = args[0].value<SamplerGenerateSamplesUniforms>();
+            auto sampler_dimensions = args[1].pointer<const HaltonSamplerDimension>();
+            auto sampler_table = args[2].pointer<const float>();
+            auto sampler_blue_noise = args[3].pointer<const float>();
+            auto random = texture_view<access::write>(args[4]);
+            group.for_each_thread([&](uint2 tid) { sampler_generate_samples(uniforms, sampler_dimensions, sampler_table, sampler_blue_noise, random, tid); });
+        }}}};
+    
+    auto iter = functions.find(name);
+    return iter == functions.end() ? nullptr : &iter->second;
+}
+
+}
@@ -0,0 +1,78 @@
+#include <util/thread_pool.h>
+#include "cpu_scheduler.h"
+
+namespace luisa::cpu {
+
+CPUScheduler::CPUScheduler()
+    : _queues{std::make_unique<WorkerQueue[]>(util::ThreadPool::instance().worker_count())},
+      _worker_count{util::ThreadPool::instance().worker_count()} {}
+
+bool CPUScheduler::_pop(uint32_t worker, uint32_t &task) noexcept {
+    auto &&range = _queues[worker].range;
+    auto r = range.load(std::memory_order_relaxed);
+    while (_begin(r) < _end(r)) {
+        if (range.compare_exchange_weak(r, _pack(_begin(r) + 1u, _end(r)), std::memory_order_relaxed)) {
+            task = _begin(r);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CPUScheduler::_steal(uint32_t thief) noexcept {
+    for (;;) {
+        // take from the most loaded victim, so that one steal rebalances as much as possible
+        auto victim = thief;
+        uint64_t victim_range = 0u;
+        auto victim_size = 0u;
+        for (auto i = 1u; i < _worker_count; i++) {
+            auto candidate = (thief + i) % _worker_count;
+            auto r = _queues[candidate].range.load(std::memory_order_relaxed);
+            if (auto size = _end(r) - _begin(r); _begin(r) < _end(r) && size > victim_size) {
+                victim = candidate;
+                victim_range = r;
+                victim_size = size;
+            }
+        }
+        if (victim_size == 0u) { return false; }
+        auto half = (victim_size + 1u) / 2u;
+        auto split = _end(victim_range) - half;
+        if (_queues[victim].range.compare_exchange_strong(victim_range, _pack(_begin(victim_range), split), std::memory_order_relaxed)) {
+            // the thief's own queue is empty here, so nobody else can be updating it
+            _queues[thief].range.store(_pack(split, _end(victim_range)), std::memory_order_relaxed);
+            return true;
+        }
+    }
+}
+
+void CPUScheduler::dispatch(uint32_t task_count, CPUSchedulingPolicy policy, const std::function<void(uint32_t)> &task) {
+    
+    std::lock_guard lock{_dispatch_mutex};
+    
+    // contiguous initial ranges keep neighbouring tiles on the same core
+    auto range_of = [task_count, worker_count = _worker_count](uint32_t worker) noexcept {
+        auto begin = static_cast<uint32_t>(static_cast<uint64_t>(task_count) * worker / worker_count);
+        auto end = static_cast<uint32_t>(static_cast<uint64_t>(task_count) * (worker + 1u) / worker_count);
+        return std::make_pair(begin, end);
+    };
+    
+    if (policy == CPUSchedulingPolicy::STATIC) {
+        util::ThreadPool::instance().run([&](uint32_t worker) {
+            auto [begin, end] = range_of(worker);
+            for (auto i = begin; i < end; i++) { task(i); }
+        });
+    } else {
+        for (auto worker = 0u; worker < _worker_count; worker++) {
+            auto [begin, end] = range_of(worker);
+            _queues[worker].range.store(_pack(begin, end), std::memory_order_relaxed);
+        }
+        util::ThreadPool::instance().run([&](uint32_t worker) {
+            auto index = 0u;
+            do {
+                while (_pop(worker, index)) { task(index); }
+            } while (_steal(worker));
+        });
+    }
+}
+
+}
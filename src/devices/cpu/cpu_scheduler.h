@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include <util/noncopyable.h>
+
+namespace luisa::cpu {
+
+enum struct CPUSchedulingPolicy {
+    STATIC,
+    WORK_STEALING
+};
+
+// Distributes the threadgroups of a dispatch over the workers of util::ThreadPool.
+// With WORK_STEALING every worker owns a contiguous range of threadgroups (a deque whose
+// front is consumed by the owner and whose back half is taken by idle workers), so cheap
+// tiles such as terminated rays or empty sky do not leave cores waiting for the slowest one.
+class CPUScheduler : util::Noncopyable {
+
+private:
+    struct alignas(64) WorkerQueue {
+        std::atomic<uint64_t> range{0u};  // [begin, end) packed as (end << 32u) | begin
+    };
+    
+    std::unique_ptr<WorkerQueue[]> _queues;
+    uint32_t _worker_count;
+    std::mutex _dispatch_mutex;  // the queues belong to one dispatch at a time, from setup until they are drained
+    
+    [[nodiscard]] static constexpr uint64_t _pack(uint32_t begin, uint32_t end) noexcept { return (static_cast<uint64_t>(end) << 32u) | begin; }
+    [[nodiscard]] static constexpr uint32_t _begin(uint64_t range) noexcept { return static_cast<uint32_t>(range); }
+    [[nodiscard]] static constexpr uint32_t _end(uint64_t range) noexcept { return static_cast<uint32_t>(range >> 32u); }
+    
+    [[nodiscard]] bool _pop(uint32_t worker, uint32_t &task) noexcept;
+    [[nodiscard]] bool _steal(uint32_t thief) noexcept;
+
+public:
+    CPUScheduler();
+    
+    // thread-safe, concurrent dispatches on the same scheduler run one after another
+    void dispatch(uint32_t task_count, CPUSchedulingPolicy policy, const std::function<void(uint32_t)> &task);
+};
+
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+// AVX2 functions are compiled with target attributes, so that they can sit next to the portable ones in any binary and be
+// chosen at runtime with cpu_has_avx2(); other compilers and hosts only get the portable ones
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define LUISA_CPU_AVX2_AVAILABLE
+#define LUISA_CPU_AVX2 __attribute__((target("avx2,fma")))
+#include <immintrin.h>
+#endif
+
+namespace luisa::cpu {
+
+// Eight float lanes for the host intersectors and denoisers, as plain loops that the compiler is free to vectorize and, on
+// x86-64, as AVX2 intrinsics. Both come with the same interface, so that SIMD code can be written once over the lane type.
+
+namespace portable {
+
+struct CPUBool8 {
+    uint32_t mask;
+    [[nodiscard]] uint32_t bits() const noexcept { return mask; }
+    [[nodiscard]] CPUBool8 operator&(CPUBool8 rhs) const noexcept { return {mask & rhs.mask}; }
+    [[nodiscard]] CPUBool8 operator|(CPUBool8 rhs) const noexcept { return {mask | rhs.mask}; }
+    [[nodiscard]] static CPUBool8 from_bits(uint32_t bits) noexcept { return {bits}; }
+};
+
+struct CPUFloat8 {
+
+    using Mask = CPUBool8;
+    alignas(32) float v[8];
+
+    template<typename F>
+    [[nodiscard]] static CPUFloat8 map(F &&f) noexcept {
+        CPUFloat8 result;
+        for (auto i = 0u; i < 8u; i++) { result.v[i] = f(i); }
+        return result;
+    }
+
+    template<typename F>
+    [[nodiscard]] static CPUBool8 test(F &&f) noexcept {
+        auto bits = 0u;
+        for (auto i = 0u; i < 8u; i++) { bits |= f(i) ? 1u << i : 0u; }
+        return {bits};
+    }
+
+    [[nodiscard]] static CPUFloat8 load(const float *p) noexcept { return map([p](uint32_t i) { return p[i]; }); }
+    [[nodiscard]] static CPUFloat8 load_unaligned(const float *p) noexcept { return load(p); }
+    [[nodiscard]] static CPUFloat8 broadcast(float x) noexcept { return map([x](uint32_t) { return x; }); }
+    void store(float *p) const noexcept { std::copy(v, v + 8, p); }
+    void store_unaligned(float *p) const noexcept { store(p); }
+    [[nodiscard]] CPUFloat8 operator+(const CPUFloat8 &rhs) const noexcept { return map([&](uint32_t i) { return v[i] + rhs.v[i]; }); }
+    [[nodiscard]] CPUFloat8 operator-(const CPUFloat8 &rhs) const noexcept { return map([&](uint32_t i) { return v[i] - rhs.v[i]; }); }
+    [[nodiscard]] CPUFloat8 operator*(const CPUFloat8 &rhs) const noexcept { return map([&](uint32_t i) { return v[i] * rhs.v[i]; }); }
+    [[nodiscard]] CPUBool8 operator<(const CPUFloat8 &rhs) const noexcept { return test([&](uint32_t i) { return v[i] < rhs.v[i]; }); }
+    [[nodiscard]] CPUBool8 operator<=(const CPUFloat8 &rhs) const noexcept { return test([&](uint32_t i) { return v[i] <= rhs.v[i]; }); }
+    [[nodiscard]] CPUBool8 operator>(const CPUFloat8 &rhs) const noexcept { return test([&](uint32_t i) { return v[i] > rhs.v[i]; }); }
+    [[nodiscard]] CPUBool8 operator>=(const CPUFloat8 &rhs) const noexcept { return test([&](uint32_t i) { return v[i] >= rhs.v[i]; }); }
+};
+
+[[nodiscard]] inline CPUFloat8 min(const CPUFloat8 &a, const CPUFloat8 &b) noexcept { return CPUFloat8::map([&](uint32_t i) { return std::min(a.v[i], b.v[i]); }); }
+[[nodiscard]] inline CPUFloat8 max(const CPUFloat8 &a, const CPUFloat8 &b) noexcept { return CPUFloat8::map([&](uint32_t i) { return std::max(a.v[i], b.v[i]); }); }
+[[nodiscard]] inline CPUFloat8 abs(const CPUFloat8 &a) noexcept { return CPUFloat8::map([&](uint32_t i) { return a.v[i] < 0.0f ? -a.v[i] : a.v[i]; }); }
+[[nodiscard]] inline CPUFloat8 reciprocal(const CPUFloat8 &a) noexcept { return CPUFloat8::map([&](uint32_t i) { return 1.0f / a.v[i]; }); }
+
+[[nodiscard]] inline CPUFloat8 select(CPUBool8 mask, const CPUFloat8 &a, const CPUFloat8 &b) noexcept {
+    return CPUFloat8::map([&](uint32_t i) { return (mask.mask & (1u << i)) != 0u ? a.v[i] : b.v[i]; });
+}
+
+[[nodiscard]] inline CPUFloat8 exp_non_positive(const CPUFloat8 &x) noexcept {
+    return CPUFloat8::map([&](uint32_t i) { return std::max(std::exp(x.v[i]), 1.17549435e-38f); });
+}
+
+}
+
+#ifdef LUISA_CPU_AVX2_AVAILABLE
+
+namespace avx2 {
+
+struct CPUBool8 {
+    __m256 v;
+    [[nodiscard]] LUISA_CPU_AVX2 uint32_t bits() const noexcept { return static_cast<uint32_t>(_mm256_movemask_ps(v)); }
+    [[nodiscard]] LUISA_CPU_AVX2 CPUBool8 operator&(CPUBool8 rhs) const noexcept { return {_mm256_and_ps(v, rhs.v)}; }
+    [[nodiscard]] LUISA_CPU_AVX2 CPUBool8 operator|(CPUBool8 rhs) const noexcept { return {_mm256_or_ps(v, rhs.v)}; }
+    [[nodiscard]] LUISA_CPU_AVX2 static CPUBool8 from_bits(uint32_t bits) noexcept {
+        auto lanes = _mm256_and_si256(_mm256_set1_epi32(static_cast<int>(bits)), _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128));
+        return {_mm256_castsi256_ps(_mm256_cmpeq_epi32(lanes, _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128)))};
+    }
+};
+
+struct CPUFloat8 {
+    using Mask = CPUBool8;
+    __m256 v;
+    [[nodiscard]] LUISA_CPU_AVX2 static CPUFloat8 load(const float *p) noexcept { return {_mm256_load_ps(p)}; }
+    [[nodiscard]] LUISA_CPU_AVX2 static CPUFloat8 load_unaligned(const float *p) noexcept { return {_mm256_loadu_ps(p)}; }
+    [[nodiscard]] LUISA_CPU_AVX2 static CPUFloat8 broadcast(float x) noexcept { return {_mm256_set1_ps(x)}; }
+    LUISA_CPU_AVX2 void store(float *p) const noexcept { _mm256_store_ps(p, v); }
+    LUISA_CPU_AVX2 void store_unaligned(float *p) const noexcept { _mm256_storeu_ps(p, v); }
+    [[nodiscard]] LUISA_CPU_AVX2 CPUFloat8 operator+(CPUFloat8 rhs) const noexcept { return {_mm256_add_ps(v, rhs.v)}; }
+    [[nodiscard]] LUISA_CPU_AVX2 CPUFloat8 operator-(CPUFloat8 rhs) const noexcept { return {_mm256_sub_ps(v, rhs.v)}; }
+    [[nodiscard]] LUISA_CPU_AVX2 CPUFloat8 operator*(CPUFloat8 rhs) const noexcept { return {_mm256_mul_ps(v, rhs.v)}; }
+    [[nodiscard]] LUISA_CPU_AVX2 CPUBool8 operator<(CPUFloat8 rhs) const noexcept { return {_mm256_cmp_ps(v, rhs.v, _CMP_LT_OQ)}; }
+    [[nodiscard]] LUISA_CPU_AVX2 CPUBool8 operator<=(CPUFloat8 rhs) const noexcept { return {_mm256_cmp_ps(v, rhs.v, _CMP_LE_OQ)}; }
+    [[nodiscard]] LUISA_CPU_AVX2 CPUBool8 operator>(CPUFloat8 rhs) const noexcept { return {_mm256_cmp_ps(v, rhs.v, _CMP_GT_OQ)}; }
+    [[nodiscard]] LUISA_CPU_AVX2 CPUBool8 operator>=(CPUFloat8 rhs) const noexcept { return {_mm256_cmp_ps(v, rhs.v, _CMP_GE_OQ)}; }
+};
+
+[[nodiscard]] LUISA_CPU_AVX2 inline CPUFloat8 min(CPUFloat8 a, CPUFloat8 b) noexcept { return {_mm256_min_ps(a.v, b.v)}; }
+[[nodiscard]] LUISA_CPU_AVX2 inline CPUFloat8 max(CPUFloat8 a, CPUFloat8 b) noexcept { return {_mm256_max_ps(a.v, b.v)}; }
+[[nodiscard]] LUISA_CPU_AVX2 inline CPUFloat8 abs(CPUFloat8 a) noexcept { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+[[nodiscard]] LUISA_CPU_AVX2 inline CPUFloat8 reciprocal(CPUFloat8 a) noexcept { return {_mm256_div_ps(_mm256_set1_ps(1.0f), a.v)}; }
+[[nodiscard]] LUISA_CPU_AVX2 inline CPUFloat8 select(CPUBool8 mask, CPUFloat8 a, CPUFloat8 b) noexcept { return {_mm256_blendv_ps(b.v, a.v, mask.v)}; }
+
+// exp(x) for x <= 0, within 2e-5 relative down to 2^-126 and flushed to it below: 2^floor(y) from the exponent bits times a
+// degree-6 Taylor polynomial of 2^f over the fraction f of y = x / ln(2)
+[[nodiscard]] LUISA_CPU_AVX2 inline CPUFloat8 exp_non_positive(CPUFloat8 x) noexcept {
+    auto y = _mm256_max_ps(_mm256_mul_ps(x.v, _mm256_set1_ps(1.44269504f)), _mm256_set1_ps(-126.0f));
+    auto n = _mm256_floor_ps(y);
+    auto f = _mm256_sub_ps(y, n);
+    auto p = _mm256_set1_ps(1.54035304e-4f);
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(1.33335581e-3f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(9.61812911e-3f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(5.55041087e-2f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(2.40226507e-1f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(6.93147181e-1f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(1.0f));
+    auto scale = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23));
+    return {_mm256_mul_ps(p, scale)};
+}
+
+}
+
+#endif
+
+// whether the host runs the avx2 functions above, checked once
+[[nodiscard]] inline bool cpu_has_avx2() noexcept {
+#if defined(__AVX2__) && defined(__FMA__)
+    return true;
+#elif defined(LUISA_CPU_AVX2_AVAILABLE)
+    static const auto supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+// the lanes for code compiled only once, AVX2 when the whole build targets it (see LUISA_CPU_ENABLE_AVX2)
+#if defined(__AVX2__) && defined(__FMA__)
+using namespace avx2;
+#else
+using namespace portable;
+#endif
+
+}
@@ -0,0 +1,51 @@
+#include <algorithm>
+
+#include "cpu_sort.h"
+
+namespace luisa::cpu {
+
+namespace {
+
+constexpr auto RADIX_BITS = 8u;
+constexpr auto RADIX_BUCKET_COUNT = 1u << RADIX_BITS;
+constexpr auto SORT_CHUNK_SIZE = 16u * 1024u;
+
+}
+
+void radix_sort(CPUScheduler &scheduler, std::vector<uint32_t> &keys, std::vector<uint32_t> &values, uint32_t key_bits) {
+    
+    auto count = static_cast<uint32_t>(keys.size());
+    auto chunk_count = (count + SORT_CHUNK_SIZE - 1u) / SORT_CHUNK_SIZE;
+    std::vector<uint32_t> sorted_keys(count);
+    std::vector<uint32_t> sorted_values(count);
+    std::vector<uint32_t> offsets(chunk_count * RADIX_BUCKET_COUNT);
+    for (auto shift = 0u; shift < key_bits; shift += RADIX_BITS) {
+        scheduler.dispatch(chunk_count, CPUSchedulingPolicy::STATIC, [&](uint32_t chunk) {
+            auto counts = offsets.data() + chunk * RADIX_BUCKET_COUNT;
+            std::fill_n(counts, RADIX_BUCKET_COUNT, 0u);
+            auto end = std::min((chunk + 1u) * SORT_CHUNK_SIZE, count);
+            for (auto i = chunk * SORT_CHUNK_SIZE; i < end; i++) { counts[(keys[i] >> shift) & (RADIX_BUCKET_COUNT - 1u)]++; }
+        });
+        auto offset = 0u;
+        for (auto digit = 0u; digit < RADIX_BUCKET_COUNT; digit++) {
+            for (auto chunk = 0u; chunk < chunk_count; chunk++) {
+                auto digit_count = offsets[chunk * RADIX_BUCKET_COUNT + digit];
+                offsets[chunk * RADIX_BUCKET_COUNT + digit] = offset;
+                offset += digit_count;
+            }
+        }
+        scheduler.dispatch(chunk_count, CPUSchedulingPolicy::STATIC, [&](uint32_t chunk) {
+            auto chunk_offsets = offsets.data() + chunk * RADIX_BUCKET_COUNT;
+            auto end = std::min((chunk + 1u) * SORT_CHUNK_SIZE, count);
+            for (auto i = chunk * SORT_CHUNK_SIZE; i < end; i++) {
+                auto index = chunk_offsets[(keys[i] >> shift) & (RADIX_BUCKET_COUNT - 1u)]++;
+                sorted_keys[index] = keys[i];
+                sorted_values[index] = values[i];
+            }
+        });
+        keys.swap(sorted_keys);
+        values.swap(sorted_values);
+    }
+}
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "cpu_scheduler.h"
+
+namespace luisa::cpu {
+
+// inserts two zero bits between each of the lower ten bits of v, interleaving three of them gives a 3D Morton code
+[[nodiscard]] constexpr uint32_t spread_morton_bits(uint32_t v) noexcept {
+    v = (v * 0x00010001u) & 0xff0000ffu;
+    v = (v * 0x00000101u) & 0x0f00f00fu;
+    v = (v * 0x00000011u) & 0xc30c30c3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+// Stable LSD radix sort of keys carrying values along, over the lowest key_bits bits of the keys. Every pass counts the digits
+// of fixed-size chunks in parallel, scans the counts in (digit, chunk) order and scatters the chunks in parallel to the offsets found.
+void radix_sort(CPUScheduler &scheduler, std::vector<uint32_t> &keys, std::vector<uint32_t> &values, uint32_t key_bits);
+
+}
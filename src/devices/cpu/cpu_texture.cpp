@@ -0,0 +1,19 @@
+#include <cstring>
+#include "cpu_texture.h"
+#include "cpu_kernel.h"
+
+namespace luisa::cpu {
+
+void CPUTexture::copy_from_buffer(KernelDispatcher &dispatch, Buffer &buffer) {
+    dynamic_cast<CPUKernelDispatcher &>(dispatch).enqueue([this, &buffer] {
+        std::memcpy(_memory.get(), buffer.data(), bytes_per_image());
+    });
+}
+
+void CPUTexture::copy_to_buffer(KernelDispatcher &dispatch, Buffer &buffer) {
+    dynamic_cast<CPUKernelDispatcher &>(dispatch).enqueue([this, &buffer] {
+        std::memcpy(buffer.data(), _memory.get(), bytes_per_image());
+    });
+}
+
+}
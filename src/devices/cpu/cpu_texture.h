@@ -0,0 +1,25 @@
+#pragma once
+
+#include <core/texture.h>
+#include "cpu_buffer.h"
+
+namespace luisa::cpu {
+
+class CPUTexture : public Texture {
+
+private:
+    CPUMemory _memory;
+
+public:
+    CPUTexture(math::uint2 size, TextureFormatTag format_tag, TextureAccessTag access_tag)
+        : Texture{size, format_tag, access_tag}, _memory{allocate_cpu_memory(bytes_per_image())} {}
+    
+    void copy_from_buffer(struct KernelDispatcher &dispatch, Buffer &buffer) override;
+    void copy_to_buffer(struct KernelDispatcher &dispatch, Buffer &buffer) override;
+    
+    [[nodiscard]] float *data() const noexcept { return reinterpret_cast<float *>(_memory.get()); }
+    [[nodiscard]] uint32_t channels() const noexcept { return static_cast<uint32_t>(bytes_per_pixel() / sizeof(float)); }
+    
+};
+
+}
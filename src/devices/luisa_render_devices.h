@@ -4,4 +4,8 @@
 
 #pragma once
 
+#ifdef __APPLE__
 #include "metal/metal_device.h"
+#endif
+
+#include "cpu/cpu_device.h"
@@ -8,6 +8,8 @@
 #error This file should only be used in Objective-C/C++ sources.
 #endif
 
+#import <vector>
+#import <memory>
 #import <MetalPerformanceShaders/MetalPerformanceShaders.h>
 #import <core/acceleration_structure.h>
 
@@ -16,18 +18,33 @@ namespace luisa::metal {
 class MetalAccelerationStructure : public AccelerationStructure {
 
 private:
-    MPSTriangleAccelerationStructure *_structure;
+    MPSAccelerationStructure *_structure;
     MPSRayIntersector *_nearest_intersector;
     MPSRayIntersector *_any_intersector;
+    MPSRayIntersector *_queue_nearest_intersector;
+    MPSRayIntersector *_queue_any_intersector;
+    std::vector<std::shared_ptr<AccelerationStructure>> _instanced_meshes;  // kept alive for instance structures
 
 public:
-    MetalAccelerationStructure(MPSTriangleAccelerationStructure *structure, MPSRayIntersector *nearest_its, MPSRayIntersector *any_its) noexcept
-        : _structure{structure}, _nearest_intersector{nearest_its}, _any_intersector{any_its} {}
+    MetalAccelerationStructure(MPSAccelerationStructure *structure, MPSRayIntersector *nearest_its, MPSRayIntersector *any_its,
+                               MPSRayIntersector *queue_nearest_its, MPSRayIntersector *queue_any_its,
+                               std::vector<std::shared_ptr<AccelerationStructure>> instanced_meshes = {}) noexcept
+        : _structure{structure}, _nearest_intersector{nearest_its}, _any_intersector{any_its}, _queue_nearest_intersector{queue_nearest_its},
+          _queue_any_intersector{queue_any_its}, _instanced_meshes{std::move(instanced_meshes)} {}
+    
+    [[nodiscard]] MPSAccelerationStructure *handle() const noexcept { return _structure; }
     
     void trace_any(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, size_t ray_count) override;
     void trace_nearest(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, size_t ray_count) override;
     void trace_any(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) override;
     void trace_nearest(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) override;
+    void trace_any(KernelDispatcher &dispatch, RayQueue &ray_queue, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) override;
+    void trace_nearest(KernelDispatcher &dispatch, RayQueue &ray_queue, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) override;
+    void refit(KernelDispatcher &dispatch, float rebuild_cost_ratio) override;
+    
+    [[nodiscard]] bool instanced() const noexcept override {
+        return _nearest_intersector.intersectionDataType == MPSIntersectionDataTypeDistancePrimitiveIndexInstanceIndexCoordinates;
+    }
 };
 
 }
@@ -6,6 +6,8 @@
 #import "metal_kernel.h"
 #import "metal_buffer.h"
 
+#import <core/ray_queue.h>
+
 namespace luisa::metal {
 
 void MetalAccelerationStructure::trace_any(KernelDispatcher &dispatch, Buffer &ray_buffer, Buffer &intersection_buffer, size_t ray_count) {
@@ -54,4 +56,32 @@ void MetalAccelerationStructure::trace_nearest(KernelDispatcher &dispatch, Buffe
                                       accelerationStructure:_structure];
 }
 
+void MetalAccelerationStructure::trace_any(KernelDispatcher &dispatch, RayQueue &ray_queue, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) {
+    [_queue_any_intersector encodeIntersectionToCommandBuffer:dynamic_cast<MetalKernelDispatcher &>(dispatch).command_buffer()
+                                             intersectionType:MPSIntersectionTypeAny
+                                                    rayBuffer:dynamic_cast<MetalBuffer &>(ray_queue.geometry_buffer()).handle()
+                                              rayBufferOffset:0u
+                                           intersectionBuffer:dynamic_cast<MetalBuffer &>(intersection_buffer).handle()
+                                     intersectionBufferOffset:0u
+                                               rayCountBuffer:dynamic_cast<MetalBuffer &>(ray_count_buffer).handle()
+                                         rayCountBufferOffset:ray_count_buffer_offset
+                                        accelerationStructure:_structure];
+}
+
+void MetalAccelerationStructure::trace_nearest(KernelDispatcher &dispatch, RayQueue &ray_queue, Buffer &intersection_buffer, Buffer &ray_count_buffer, size_t ray_count_buffer_offset) {
+    [_queue_nearest_intersector encodeIntersectionToCommandBuffer:dynamic_cast<MetalKernelDispatcher &>(dispatch).command_buffer()
+                                                 intersectionType:MPSIntersectionTypeNearest
+                                                        rayBuffer:dynamic_cast<MetalBuffer &>(ray_queue.geometry_buffer()).handle()
+                                                  rayBufferOffset:0u
+                                               intersectionBuffer:dynamic_cast<MetalBuffer &>(intersection_buffer).handle()
+                                         intersectionBufferOffset:0u
+                                                   rayCountBuffer:dynamic_cast<MetalBuffer &>(ray_count_buffer).handle()
+                                             rayCountBufferOffset:ray_count_buffer_offset
+                                            accelerationStructure:_structure];
+}
+
+void MetalAccelerationStructure::refit(KernelDispatcher &dispatch, float rebuild_cost_ratio [[maybe_unused]]) {  // MPS gives no cost estimates
+    [_structure encodeRefitToCommandBuffer:dynamic_cast<MetalKernelDispatcher &>(dispatch).command_buffer()];
+}
+
 }
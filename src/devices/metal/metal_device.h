@@ -22,7 +22,13 @@ public:
     
     std::shared_ptr<Kernel> create_kernel(std::string_view function_name) override;
     std::shared_ptr<Texture> create_texture(math::uint2 size, TextureFormatTag format_tag, TextureAccessTag access_tag) override;
-    std::shared_ptr<AccelerationStructure> create_acceleration_structure(Buffer &position_buffer, size_t stride, size_t triangle_count) override;
+    std::shared_ptr<AccelerationStructure> create_acceleration_structure(
+        Buffer &position_buffer, size_t stride, size_t triangle_count, AccelerationStructureBuildMode build_mode) override;
+    std::shared_ptr<AccelerationStructure> create_instance_acceleration_structure(
+        const std::vector<std::shared_ptr<AccelerationStructure>> &meshes, Buffer &mesh_index_buffer, Buffer &transform_buffer, size_t instance_count) override;
+    std::shared_ptr<AccelerationStructure> create_motion_instance_acceleration_structure(
+        const std::vector<std::shared_ptr<AccelerationStructure>> &meshes, Buffer &mesh_index_buffer, Buffer &transform_buffer, size_t instance_count,
+        uint32_t keyframe_count, float shutter_open, float shutter_close) override;
     std::shared_ptr<Buffer> create_buffer(size_t capacity, BufferStorageTag storage) override;
     
     void launch(std::function<void(KernelDispatcher &)> dispatch) override;
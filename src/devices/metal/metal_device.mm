@@ -17,7 +17,10 @@
 
 namespace luisa::metal {
 
-struct MetalDeviceWrapper { id<MTLDevice> device; };
+struct MetalDeviceWrapper {
+    id<MTLDevice> device;
+    MPSAccelerationStructureGroup *acceleration_structure_group;  // MPS only instances structures within the same group
+};
 struct MetalLibraryWrapper { id<MTLLibrary> library; };
 struct MetalCommandQueueWrapper { id<MTLCommandQueue> queue; };
 
@@ -27,6 +30,7 @@ MetalDevice::MetalDevice()
       _command_queue_wrapper{std::make_unique<MetalCommandQueueWrapper>()} {
     
     _device_wrapper->device = MTLCreateSystemDefaultDevice();
+    _device_wrapper->acceleration_structure_group = [[MPSAccelerationStructureGroup alloc] initWithDevice:_device_wrapper->device];
     _command_queue_wrapper->queue = [_device_wrapper->device newCommandQueue];
     
     auto library_path = util::make_objc_string(ResourceManager::instance().working_path("kernels/bin/kernels.metallib").c_str());
@@ -71,10 +75,14 @@ void MetalDevice::launch_async(std::function<void(KernelDispatcher &)> dispatch,
     [command_buffer commit];
 }
 
-std::shared_ptr<AccelerationStructure> MetalDevice::create_acceleration_structure(Buffer &position_buffer, size_t stride, size_t triangle_count) {
+std::shared_ptr<AccelerationStructure> MetalDevice::create_acceleration_structure(
+    Buffer &position_buffer, size_t stride, size_t triangle_count, AccelerationStructureBuildMode build_mode) {
     
-    auto accelerator = [[MPSTriangleAccelerationStructure alloc] initWithDevice:_device_wrapper->device];
+    auto accelerator = [[MPSTriangleAccelerationStructure alloc] initWithGroup:_device_wrapper->acceleration_structure_group];
     [accelerator autorelease];
+    if (build_mode != AccelerationStructureBuildMode::SAH) {  // MPS picks its own builder, only the hint can be passed on
+        accelerator.usage = MPSAccelerationStructureUsageFrequentRebuild;
+    }
     accelerator.vertexBuffer = dynamic_cast<MetalBuffer &>(position_buffer).handle();
     accelerator.vertexStride = stride;
     accelerator.triangleCount = triangle_count;
@@ -92,7 +100,79 @@ std::shared_ptr<AccelerationStructure> MetalDevice::create_acceleration_structur
     shadow_ray_intersector.intersectionDataType = MPSIntersectionDataTypeDistance;
     shadow_ray_intersector.rayStride = sizeof(ShadowRay);
     
-    return std::make_shared<MetalAccelerationStructure>(accelerator, ray_intersector, shadow_ray_intersector);
+    // same as ray_intersector and shadow_ray_intersector, over the geometry streams of ray queues
+    auto queue_ray_intersector = [[MPSRayIntersector alloc] initWithDevice:_device_wrapper->device];
+    [queue_ray_intersector autorelease];
+    queue_ray_intersector.rayDataType = MPSRayDataTypeOriginMinDistanceDirectionMaxDistance;
+    queue_ray_intersector.intersectionDataType = MPSIntersectionDataTypeDistancePrimitiveIndexCoordinates;
+    queue_ray_intersector.rayStride = sizeof(RayGeometry);
+    
+    auto queue_shadow_ray_intersector = [[MPSRayIntersector alloc] initWithDevice:_device_wrapper->device];
+    [queue_shadow_ray_intersector autorelease];
+    queue_shadow_ray_intersector.rayDataType = MPSRayDataTypeOriginMinDistanceDirectionMaxDistance;
+    queue_shadow_ray_intersector.intersectionDataType = MPSIntersectionDataTypeDistance;
+    queue_shadow_ray_intersector.rayStride = sizeof(RayGeometry);
+    
+    return std::make_shared<MetalAccelerationStructure>(accelerator, ray_intersector, shadow_ray_intersector, queue_ray_intersector, queue_shadow_ray_intersector);
+}
+
+std::shared_ptr<AccelerationStructure> MetalDevice::create_instance_acceleration_structure(
+    const std::vector<std::shared_ptr<AccelerationStructure>> &meshes, Buffer &mesh_index_buffer, Buffer &transform_buffer, size_t instance_count) {
+    
+    auto mesh_structures = [NSMutableArray arrayWithCapacity:meshes.size()];
+    for (auto &&mesh : meshes) {
+        auto metal_mesh = std::dynamic_pointer_cast<MetalAccelerationStructure>(mesh);
+        if (metal_mesh == nullptr) {
+            THROW_DEVICE_ERROR("instanced meshes should be triangle acceleration structures created by the Metal device.");
+        }
+        [mesh_structures addObject:metal_mesh->handle()];
+    }
+    
+    auto accelerator = [[MPSInstanceAccelerationStructure alloc] initWithGroup:_device_wrapper->acceleration_structure_group];
+    [accelerator autorelease];
+    accelerator.accelerationStructures = mesh_structures;
+    accelerator.instanceBuffer = dynamic_cast<MetalBuffer &>(mesh_index_buffer).handle();
+    accelerator.transformBuffer = dynamic_cast<MetalBuffer &>(transform_buffer).handle();
+    accelerator.transformType = MPSTransformTypeFloat4x4;
+    accelerator.instanceCount = instance_count;
+    [accelerator rebuild];
+    
+    auto ray_intersector = [[MPSRayIntersector alloc] initWithDevice:_device_wrapper->device];
+    [ray_intersector autorelease];
+    ray_intersector.rayDataType = MPSRayDataTypeOriginMinDistanceDirectionMaxDistance;
+    ray_intersector.intersectionDataType = MPSIntersectionDataTypeDistancePrimitiveIndexInstanceIndexCoordinates;
+    ray_intersector.rayStride = sizeof(Ray);
+    
+    auto shadow_ray_intersector = [[MPSRayIntersector alloc] initWithDevice:_device_wrapper->device];
+    [shadow_ray_intersector autorelease];
+    shadow_ray_intersector.rayDataType = MPSRayDataTypeOriginMinDistanceDirectionMaxDistance;
+    shadow_ray_intersector.intersectionDataType = MPSIntersectionDataTypeDistance;
+    shadow_ray_intersector.rayStride = sizeof(ShadowRay);
+    
+    // same as ray_intersector and shadow_ray_intersector, over the geometry streams of ray queues
+    auto queue_ray_intersector = [[MPSRayIntersector alloc] initWithDevice:_device_wrapper->device];
+    [queue_ray_intersector autorelease];
+    queue_ray_intersector.rayDataType = MPSRayDataTypeOriginMinDistanceDirectionMaxDistance;
+    queue_ray_intersector.intersectionDataType = MPSIntersectionDataTypeDistancePrimitiveIndexInstanceIndexCoordinates;
+    queue_ray_intersector.rayStride = sizeof(RayGeometry);
+    
+    auto queue_shadow_ray_intersector = [[MPSRayIntersector alloc] initWithDevice:_device_wrapper->device];
+    [queue_shadow_ray_intersector autorelease];
+    queue_shadow_ray_intersector.rayDataType = MPSRayDataTypeOriginMinDistanceDirectionMaxDistance;
+    queue_shadow_ray_intersector.intersectionDataType = MPSIntersectionDataTypeDistance;
+    queue_shadow_ray_intersector.rayStride = sizeof(RayGeometry);
+    
+    return std::make_shared<MetalAccelerationStructure>(accelerator, ray_intersector, shadow_ray_intersector, queue_ray_intersector, queue_shadow_ray_intersector, meshes);
+}
+
+std::shared_ptr<AccelerationStructure> MetalDevice::create_motion_instance_acceleration_structure(
+    const std::vector<std::shared_ptr<AccelerationStructure>> &meshes, Buffer &mesh_index_buffer, Buffer &transform_buffer, size_t instance_count,
+    uint32_t keyframe_count, float shutter_open [[maybe_unused]], float shutter_close [[maybe_unused]]) {
+    
+    if (keyframe_count != 1u) {  // MPS instance structures have no notion of time
+        THROW_DEVICE_ERROR("moving instances are not supported by the Metal device.");
+    }
+    return create_instance_acceleration_structure(meshes, mesh_index_buffer, transform_buffer, instance_count);
 }
 
 std::shared_ptr<Buffer> MetalDevice::create_buffer(size_t capacity, BufferStorageTag storage) {
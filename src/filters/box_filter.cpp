@@ -0,0 +1,9 @@
+#include "box_filter.h"
+
+namespace luisa {
+
+float BoxFilter::_weight(float offset [[maybe_unused]]) const noexcept {
+    return 1.0f;
+}
+
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <core/filter.h>
+
+namespace luisa {
+
+DERIVED_CLASS(BoxFilter, Filter) {
+
+protected:
+    [[nodiscard]] float _weight(float offset) const noexcept override;
+
+public:
+    CREATOR("Box") noexcept { return std::make_shared<BoxFilter>(); }
+};
+
+}
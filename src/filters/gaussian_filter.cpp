@@ -0,0 +1,17 @@
+#include "gaussian_filter.h"
+
+namespace luisa {
+
+float GaussianFilter::_weight(float offset) const noexcept {
+    return std::max(std::exp(-_alpha * offset * offset) - std::exp(-_alpha * _radius * _radius), 0.0f);
+}
+
+void GaussianFilter::initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) {
+    Filter::initialize(device, param_set);
+    if (!_decode_alpha(param_set)) {
+        LUISA_WARNING("parameter 'alpha' not specified, using default value (2.0).");
+        _alpha = 2.0f;
+    }
+}
+
+}
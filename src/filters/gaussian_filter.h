@@ -0,0 +1,25 @@
+#pragma once
+
+#include <core/filter.h>
+
+namespace luisa {
+
+// exp(-alpha * x^2) offset to reach zero at the radius
+DERIVED_CLASS(GaussianFilter, Filter) {
+
+protected:
+    PROPERTY(float, alpha, CoreTypeTag::FLOAT) {
+        if (params.size() != 1 || params[0] <= 0.0f) {
+            THROW_FILTER_ERROR("expected exactly one positive float value as Gaussian filter falloff 'alpha'.");
+        }
+        _alpha = params[0];
+    }
+    
+    [[nodiscard]] float _weight(float offset) const noexcept override;
+
+public:
+    CREATOR("Gaussian") noexcept { return std::make_shared<GaussianFilter>(); }
+    void initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) override;
+};
+
+}
@@ -4,4 +4,7 @@
 
 #pragma once
 
+#include "box_filter.h"
+#include "gaussian_filter.h"
 #include "mitchell_netravali_filter.h"
+#include "triangle_filter.h"
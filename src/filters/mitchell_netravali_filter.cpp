@@ -6,18 +6,13 @@
 
 namespace luisa {
 
-void MitchellNetravaliFilter::apply(KernelDispatcher &dispatch, Buffer &gather_ray_buffer, Texture &result_texture, math::uint2 frame_size, uint32_t frame_index) {
-    
-    math::uint2 threadgroup_size{32, 32};
-    auto threadgroups = (frame_size + threadgroup_size - 1u) / threadgroup_size;
-    
-    MitchellNetravaliFilterApplyUniforms uniforms{frame_size, frame_index, _radius, _b, _c};
-    
-    dispatch(*_apply_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
-        encoder["uniforms"]->set_bytes(&uniforms, sizeof(MitchellNetravaliFilterApplyUniforms));
-        encoder["rays"]->set_buffer(gather_ray_buffer);
-        encoder["result"]->set_texture(result_texture);
-    });
+float MitchellNetravaliFilter::_weight(float offset) const noexcept {
+    auto x = std::min(std::abs(2.0f * offset / _radius), 2.0f);
+    auto xx = x * x;
+    return (1.0f / 6.0f) *
+           (x > 1 ?
+            (-(_b + 6.0f * _c) * xx + 6.0f * (_b + 5.0f * _c) * x - 12.0f * (_b + 4.0f * _c)) * x + 8.0f * (_b + 3.0f * _c) :
+            (-6.0f * (1.5f * _b + _c - 2.0f) * xx + 6.0f * (2.0f * _b + _c - 3.0f) * x) * x - 2.0f * (_b - 3.0f));
 }
 
 void MitchellNetravaliFilter::initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) {
@@ -26,8 +21,6 @@ void MitchellNetravaliFilter::initialize(Device &device, const CoreTypeInitializ
     
     if (!_decode_b(param_set)) { LUISA_WARNING("parameter 'B' not specified, using default value (1/3)."); }
     if (!_decode_c(param_set)) { LUISA_WARNING("parameter 'C' not specified, using default value (1/3)."); }
-    
-    _apply_kernel = device.create_kernel("mitchell_natravali_filter_apply");
 }
 
 }
@@ -4,31 +4,12 @@
 
 #pragma once
 
-#include <core/mathematics.h>
-
-namespace luisa {
-
-struct alignas(16) MitchellNetravaliFilterApplyUniforms {
-    math::uint2 frame_size;
-    uint32_t frame_index;
-    float radius;
-    float b;
-    float c;
-};
-
-}
-
-#ifndef DEVICE_COMPATIBLE
-
 #include <core/filter.h>
 
 namespace luisa {
 
 DERIVED_CLASS(MitchellNetravaliFilter, Filter) {
 
-private:
-    std::shared_ptr<Kernel> _apply_kernel;
-
 protected:
     PROPERTY(float, b, CoreTypeTag::FLOAT) {
         if (params.size() != 1) {
@@ -43,13 +24,12 @@ protected:
         }
         _c = params[0];
     }
+    
+    [[nodiscard]] float _weight(float offset) const noexcept override;
 
 public:
     CREATOR("MitchellNetravali") noexcept { return std::make_shared<MitchellNetravaliFilter>(); }
     void initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) override;
-    void apply(KernelDispatcher &dispatch, Buffer &gather_ray_buffer, Texture &result_texture, math::uint2 frame_size, uint32_t frame_index) override;
 };
 
 }
-
-#endif
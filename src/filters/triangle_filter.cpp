@@ -0,0 +1,9 @@
+#include "triangle_filter.h"
+
+namespace luisa {
+
+float TriangleFilter::_weight(float offset) const noexcept {
+    return std::max(1.0f - offset / _radius, 0.0f);
+}
+
+}
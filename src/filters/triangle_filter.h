@@ -0,0 +1,16 @@
+#pragma once
+
+#include <core/filter.h>
+
+namespace luisa {
+
+DERIVED_CLASS(TriangleFilter, Filter) {
+
+protected:
+    [[nodiscard]] float _weight(float offset) const noexcept override;
+
+public:
+    CREATOR("Triangle") noexcept { return std::make_shared<TriangleFilter>(); }
+};
+
+}
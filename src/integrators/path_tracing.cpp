@@ -2,4 +2,155 @@
 // Created by Mike Smith on 2019/10/18.
 //
 
+#include <core/ray.h>
+#include <core/intersection.h>
 #include "path_tracing.h"
+
+namespace luisa {
+
+void PathTracing::initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) {
+    Integrator::initialize(device, param_set);
+    _device = &device;
+    if (!_decode_max_depth(param_set)) {
+        LUISA_WARNING("path tracing max depth not specified, using default value (5).");
+        _max_depth = 5u;
+    }
+    if (!_decode_ray_encoding(param_set)) { _ray_encoding = RayEncoding::FULL; }
+    auto compact = _ray_encoding == RayEncoding::COMPACT;
+    _sample_lights_kernel = device.create_kernel(compact ? "path_tracing_sample_lights_compact" : "path_tracing_sample_lights");
+    _trace_radiance_kernel = device.create_kernel(compact ? "path_tracing_trace_radiance_compact" : "path_tracing_trace_radiance");
+    _write_aovs_kernel = device.create_kernel("path_tracing_write_aovs");
+}
+
+void PathTracing::_prepare_for_frame_size(math::uint2 frame_size) {
+    
+    if (_frame_size == frame_size) { return; }
+    
+    auto pixel_count = frame_size.x * frame_size.y;
+    _compaction = std::make_unique<Compaction>(*_device, pixel_count);
+    _ray_queues[0] = std::make_unique<RayQueue>(*_device, pixel_count, _ray_encoding);
+    _ray_queues[1] = std::make_unique<RayQueue>(*_device, pixel_count, _ray_encoding);
+    _intersection_buffer = _device->create_buffer(sizeof(Intersection) * pixel_count, BufferStorageTag::DEVICE_PRIVATE);
+    _shadow_intersection_buffer = _device->create_buffer(sizeof(ShadowIntersection) * pixel_count, BufferStorageTag::DEVICE_PRIVATE);
+    auto gather_ray_size = _ray_encoding == RayEncoding::FULL ? sizeof(GatherRay) : sizeof(CompactGatherRay);
+    _gather_ray_buffer = _device->create_buffer(gather_ray_size * pixel_count, BufferStorageTag::DEVICE_PRIVATE);
+    _random_texture = _device->create_texture(frame_size, TextureFormatTag::RGBA32F, TextureAccessTag::READ_WRITE);
+    
+    // the camera fills the first queue, the later counts are written by the compaction
+    _ray_count_buffer = _device->create_buffer(sizeof(uint32_t) * (_max_depth + 1u), BufferStorageTag::MANAGED);
+    _ray_count_buffer->upload(&pixel_count, sizeof(uint32_t));
+    
+    _frame_size = frame_size;
+}
+
+void PathTracing::_write_aovs(KernelDispatcher &dispatch, const Scene &scene, Film &film, Viewport frame, Viewport tile, uint32_t frame_index) {
+    
+    math::uint2 threadgroup_size{32, 32};
+    auto threadgroups = (tile.size + threadgroup_size - 1u) / threadgroup_size;
+    
+    PathTracingWriteAOVsUniforms uniforms{frame.size, tile.origin - frame.origin, tile.origin, tile.size,
+                                          film.size().x, frame_index, _samples_per_frame, film.aovs()};
+    
+    // the kernel leaves the AOVs the film does not keep untouched, so the intersections stand in for their buffers
+    auto &&aov_buffer = [&](uint32_t aov) -> Buffer & { return film.has_aov(aov) ? film.aov_buffer(aov) : *_intersection_buffer; };
+    
+    dispatch(*_write_aovs_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+        encoder["uniforms"]->set_bytes(&uniforms, sizeof(PathTracingWriteAOVsUniforms));
+        encoder["ray_geometries"]->set_buffer(_ray_queues[0]->geometry_buffer());
+        encoder["intersections"]->set_buffer(*_intersection_buffer);
+        encoder["normals"]->set_buffer(*scene.normal_buffer);
+        encoder["material_ids"]->set_buffer(*scene.material_id_buffer);
+        encoder["materials"]->set_buffer(*scene.material_buffer);
+        encoder["depths"]->set_buffer(aov_buffer(AOV_DEPTH));
+        encoder["aov_normals"]->set_buffer(aov_buffer(AOV_NORMAL));
+        encoder["albedos"]->set_buffer(aov_buffer(AOV_ALBEDO));
+        encoder["primitive_ids"]->set_buffer(aov_buffer(AOV_PRIMITIVE_ID));
+        encoder["sample_counts"]->set_buffer(aov_buffer(AOV_SAMPLE_COUNT));
+    });
+}
+
+void PathTracing::_render_tile(KernelDispatcher &dispatch, const Scene &scene, Camera &camera, Filter &filter, Film &film,
+                               Texture &result_texture, Viewport frame, Viewport tile, uint32_t frame_index, float time) {
+    
+    // the shading kernels index the flat vertex buffers of the scene with Intersection::triangle_index
+    if (scene.acceleration_structure->instanced()) {
+        THROW_INTEGRATOR_ERROR("path tracing only supports acceleration structures over triangles, not over instances.");
+    }
+    
+    // the samples of a pixel are planes of frame.size stacked along y, so every kernel sees a frame samples_per_frame times as high
+    auto frame_size = math::uint2{frame.size.x, frame.size.y * _samples_per_frame};
+    if (_ray_encoding == RayEncoding::COMPACT && (frame_size.x > 0xffffu || frame_size.y > 0xffffu)) {
+        THROW_INTEGRATOR_ERROR("frame of ", frame_size.x, "x", frame_size.y, " samples too large for the compact ray encoding, use a smaller tile size.");
+    }
+    _prepare_for_frame_size(frame_size);
+    
+    auto pixel_count = frame_size.x * frame_size.y;
+    math::uint2 threadgroup_size{256, 1};
+    math::uint2 threadgroups{(pixel_count + threadgroup_size.x - 1u) / threadgroup_size.x, 1u};
+    
+    // the camera, then the light and BSDF samples of every bounce, each bounce taking a group of four dimensions
+    _sampler->prepare_for_frame(frame, _samples_per_frame, frame_index, SAMPLER_GROUP_DIMENSIONS * (_max_depth + 1u));
+    _sampler->generate_samples(dispatch, *_random_texture, camera.random_number_dimensions());
+    filter.warp_pixel_samples(dispatch, *_random_texture, frame_size);
+    camera.generate_rays(dispatch, *_random_texture, *_ray_queues[0], result_texture.size(), frame, _samples_per_frame, time);
+    
+    for (auto bounce = 0u; bounce < _max_depth; bounce++) {
+        
+        auto &&ray_queue = *_ray_queues[bounce % 2u];
+        auto &&next_ray_queue = *_ray_queues[(bounce + 1u) % 2u];
+        auto ray_count_offset = sizeof(uint32_t) * bounce;
+        
+        scene.acceleration_structure->trace_nearest(dispatch, ray_queue, *_intersection_buffer, *_ray_count_buffer, ray_count_offset);
+        if (bounce == 0u && film.aovs() != 0u) { _write_aovs(dispatch, scene, film, frame, tile, frame_index); }
+        
+        PathTracingUniforms uniforms{};
+        uniforms.sampler = _sampler->uniforms();
+        uniforms.sample_dimension = _sampler->reserve_dimensions(4u);
+        uniforms.light_count = scene.light_count;
+        uniforms.max_depth = _max_depth;
+        
+        dispatch(*_sample_lights_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+            encoder["uniforms"]->set_bytes(&uniforms, sizeof(PathTracingUniforms));
+            encoder["ray_geometries"]->set_buffer(ray_queue.geometry_buffer());
+            encoder["ray_pixels"]->set_buffer(ray_queue.pixel_buffer());
+            encoder["ray_count"]->set_buffer(*_ray_count_buffer, ray_count_offset);
+            encoder["intersections"]->set_buffer(*_intersection_buffer);
+            encoder["positions"]->set_buffer(*scene.position_buffer);
+            encoder["lights"]->set_buffer(*scene.light_buffer);
+            encoder["shadow_ray_geometries"]->set_buffer(next_ray_queue.geometry_buffer());
+            encoder["shadow_ray_throughputs"]->set_buffer(next_ray_queue.throughput_buffer());
+            encoder["shadow_ray_pixels"]->set_buffer(next_ray_queue.pixel_buffer());
+            _sampler->bind_tables(encoder);
+        });
+        
+        scene.acceleration_structure->trace_any(dispatch, next_ray_queue, *_shadow_intersection_buffer, *_ray_count_buffer, ray_count_offset);
+        
+        dispatch(*_trace_radiance_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
+            encoder["uniforms"]->set_bytes(&uniforms, sizeof(PathTracingUniforms));
+            encoder["ray_geometries"]->set_buffer(ray_queue.geometry_buffer());
+            encoder["ray_throughputs"]->set_buffer(ray_queue.throughput_buffer());
+            encoder["ray_radiances"]->set_buffer(ray_queue.radiance_buffer());
+            encoder["ray_pixels"]->set_buffer(ray_queue.pixel_buffer());
+            encoder["ray_count"]->set_buffer(*_ray_count_buffer, ray_count_offset);
+            encoder["intersections"]->set_buffer(*_intersection_buffer);
+            encoder["shadow_ray_geometries"]->set_buffer(next_ray_queue.geometry_buffer());
+            encoder["shadow_ray_throughputs"]->set_buffer(next_ray_queue.throughput_buffer());
+            encoder["shadow_intersections"]->set_buffer(*_shadow_intersection_buffer);
+            encoder["positions"]->set_buffer(*scene.position_buffer);
+            encoder["normals"]->set_buffer(*scene.normal_buffer);
+            encoder["material_ids"]->set_buffer(*scene.material_id_buffer);
+            encoder["materials"]->set_buffer(*scene.material_buffer);
+            _sampler->bind_tables(encoder);
+        });
+        
+        // the last bounce terminates every path, so all of them have been gathered once the loop is over
+        _compaction->compact_ray_queue(dispatch, frame_size,
+                                       ray_queue, *_ray_count_buffer, ray_count_offset,
+                                       next_ray_queue, *_ray_count_buffer, ray_count_offset + sizeof(uint32_t),
+                                       *_gather_ray_buffer);
+    }
+    
+    filter.apply(dispatch, *_gather_ray_buffer, _ray_encoding, result_texture, frame, tile, _samples_per_frame, frame_index);
+}
+
+}
@@ -7,6 +7,7 @@
 #include "core/parser.h"
 
 #include "cameras/luisa_render_cameras.h"
+#include "denoisers/luisa_render_denoisers.h"
 #include "films/luisa_render_films.h"
 #include "filters/luisa_render_filters.h"
 #include "integrators/luisa_render_integrators.h"
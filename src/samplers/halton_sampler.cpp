@@ -2,54 +2,64 @@
 // Created by Mike Smith on 2019/10/31.
 //
 
+#include <algorithm>
+#include <random>
+#include <vector>
 #include "halton_sampler.h"
 
 namespace luisa {
 
 void HaltonSampler::initialize(Device &device, const CoreTypeInitializerParameterSet &param_set [[maybe_unused]]) {
     Sampler::initialize(device, param_set);
-    _prepare_for_frame_kernel = device.create_kernel("halton_sampler_prepare_for_frame");
-    _generate_samples_kernel = device.create_kernel("halton_sampler_generate_samples");
-    _device = &device;
+    _prepare_tables(HALTON_UNSCRAMBLED_DIMENSIONS + 4u * 8u);
 }
 
-void HaltonSampler::generate_samples(KernelDispatcher &dispatch, Texture &random_texture, uint dimensions) {
+void HaltonSampler::_prepare_tables(uint32_t dimension_count) {
     
-    math::uint2 threadgroup_size{32, 32};
-    auto threadgroups = (_frame_size + threadgroup_size - 1u) / threadgroup_size;
+    // grown to the dimensions of the longest paths so far, rebuilt from scratch as the permutations are fixed anyway
+    dimension_count = std::min(std::max(dimension_count, 1u), HALTON_MAX_DIMENSIONS);
+    if (dimension_count <= _uniforms.table_dimensions) { return; }
     
-    HaltonSamplerGenerateSamplesUniforms uniforms{};
-    uniforms.frame_size = _frame_size;
-    uniforms.dimensions = dimensions;
-    
-    dispatch(*_generate_samples_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
-        encoder["uniforms"]->set_bytes(&uniforms, sizeof(HaltonSamplerGenerateSamplesUniforms));
-        encoder["states"]->set_buffer(*_state_buffer);
-        encoder["random"]->set_texture(random_texture);
-    });
-    
-    _current_dimension += dimensions;
-}
-
-void HaltonSampler::prepare_for_frame(KernelDispatcher &dispatch, math::uint2 frame_size, uint frame_index, uint total_dimensions) {
-    
-    _current_dimension = 0u;
-    if (_frame_size != frame_size) {
-        _state_buffer = _device->create_buffer(sizeof(HaltonSamplerState) * frame_size.x * frame_size.y, BufferStorageTag::DEVICE_PRIVATE);
-        _frame_size = frame_size;
+    std::vector<HaltonSamplerDimension> dimensions;
+    std::vector<float> table;
+    dimensions.reserve(dimension_count);
+    for (auto base = 2u; dimensions.size() < dimension_count; base++) {
+        auto is_prime = true;
+        for (auto p = 2u; p * p <= base && is_prime; p++) { is_prime = base % p != 0u; }
+        if (!is_prime) { continue; }
+        
+        // zero stays in place, so the digits beyond the last nonzero one add nothing
+        std::vector<uint32_t> permutation(base);
+        for (auto i = 0u; i < base; i++) { permutation[i] = i; }
+        if (dimensions.size() >= HALTON_UNSCRAMBLED_DIMENSIONS) {
+            std::mt19937 random{base};
+            std::shuffle(permutation.begin() + 1, permutation.end(), random);
+        }
+        
+        auto chunk_size = base;
+        auto digits = 1u;
+        while (chunk_size * base <= HALTON_MAX_CHUNK_SIZE) {
+            chunk_size *= base;
+            digits++;
+        }
+        dimensions.emplace_back(HaltonSamplerDimension{chunk_size, static_cast<uint32_t>(table.size()), 1.0f / static_cast<float>(chunk_size)});
+        auto inv_base = 1.0 / base;
+        for (auto chunk = 0u; chunk < chunk_size; chunk++) {
+            auto r = 0.0;
+            auto f = 1.0;
+            for (auto i = 0u, c = chunk; i < digits; i++, c /= base) {
+                f *= inv_base;
+                r += f * permutation[c % base];
+            }
+            table.emplace_back(static_cast<float>(r));
+        }
     }
     
-    math::uint2 threadgroup_size{32, 32};
-    auto threadgroups = (frame_size + threadgroup_size - 1u) / threadgroup_size;
-    
-    HaltonSamplerPrepareForFrameUniforms uniforms{};
-    uniforms.frame_size = frame_size;
-    uniforms.frame_index = frame_index;
-    
-    dispatch(*_prepare_for_frame_kernel, threadgroups, threadgroup_size, [&](KernelArgumentEncoder &encoder) {
-        encoder["uniforms"]->set_bytes(&uniforms, sizeof(HaltonSamplerPrepareForFrameUniforms));
-        encoder["states"]->set_buffer(*_state_buffer);
-    });
+    _dimension_buffer = _device->create_buffer(sizeof(HaltonSamplerDimension) * dimensions.size(), BufferStorageTag::MANAGED);
+    _dimension_buffer->upload(dimensions.data(), sizeof(HaltonSamplerDimension) * dimensions.size());
+    _table_buffer = _device->create_buffer(sizeof(float) * table.size(), BufferStorageTag::MANAGED);
+    _table_buffer->upload(table.data(), sizeof(float) * table.size());
+    _uniforms.table_dimensions = dimension_count;
 }
 
-}
\ No newline at end of file
+}
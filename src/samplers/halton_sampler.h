@@ -8,19 +8,16 @@
 
 namespace luisa {
 
-struct HaltonSamplerState {
-    uint32_t offset;
-    uint32_t dimension;
-};
-
-struct alignas(16) HaltonSamplerPrepareForFrameUniforms {
-    math::uint2 frame_size;
-    uint32_t frame_index;
-};
-
-struct alignas(16) HaltonSamplerGenerateSamplesUniforms {
-    math::uint2 frame_size;
-    uint32_t dimensions;
+constexpr auto HALTON_MAX_DIMENSIONS = 512u;        // tabulated at most, further dimensions reuse the bases of the table
+constexpr auto HALTON_MAX_CHUNK_SIZE = 4096u;       // of the tables, so that small bases take several digits per lookup
+constexpr auto HALTON_UNSCRAMBLED_DIMENSIONS = 8u;  // the groups of the camera and the first bounce, well distributed as they are
+
+// The radical inverse in a base b is evaluated k digits at a time, b^k <= HALTON_MAX_CHUNK_SIZE, from a table of the
+// scrambled radical inverses of the b^k possible chunks, at table_offset in the table buffer.
+struct HaltonSamplerDimension {
+    uint32_t chunk_size;  // b^k
+    uint32_t table_offset;
+    float inv_chunk_size;
 };
 
 }
@@ -31,20 +28,18 @@ struct alignas(16) HaltonSamplerGenerateSamplesUniforms {
 
 namespace luisa {
 
+// The dimensions are scrambled from HALTON_UNSCRAMBLED_DIMENSIONS on by fixed random permutations of the nonzero digits of
+// their bases, which breaks up the correlations between the larger neighbouring primes. Beyond HALTON_MAX_DIMENSIONS, the
+// bases are reused with the sample indices hashed by the round, so paths of any length stay within the tables.
 DERIVED_CLASS(HaltonSampler, Sampler) {
 
-private:
-    std::shared_ptr<Kernel> _prepare_for_frame_kernel;
-    std::shared_ptr<Kernel> _generate_samples_kernel;
-    std::shared_ptr<Buffer> _state_buffer;
-    Device *_device;
-    math::uint2 _frame_size;
+protected:
+    [[nodiscard]] uint32_t _kind() const noexcept override { return SAMPLER_HALTON; }
+    void _prepare_tables(uint32_t dimension_count) override;
 
 public:
     CREATOR("Halton") noexcept { return std::make_shared<HaltonSampler>(); }
     void initialize(Device &device, const CoreTypeInitializerParameterSet &param_set) override;
-    void generate_samples(KernelDispatcher &dispatch, Texture &random_texture, uint dimensions) override;
-    void prepare_for_frame(KernelDispatcher &dispatch, math::uint2 frame_size, uint frame_index, uint total_dimensions) override;
 };
 
 }
@@ -4,4 +4,5 @@
 
 #pragma once
 
-#include "halton_sampler.h"
\ No newline at end of file
+#include "halton_sampler.h"
+#include "sobol_sampler.h"
\ No newline at end of file
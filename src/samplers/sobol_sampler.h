@@ -0,0 +1,20 @@
+#pragma once
+
+#include <core/sampler.h>
+
+namespace luisa {
+
+// The first four Sobol dimensions with Burley's hash-based Owen scrambling, "Practical Hash-based Owen Scrambling": every
+// group of SAMPLER_GROUP_DIMENSIONS dimensions takes the four dimensions again, with the sample indices shuffled by a nested
+// uniform scramble and the points Owen-scrambled, both seeded by the pixel and the group. Both keep the stratification of
+// aligned runs of 2^k samples, so powers of two samples per pixel converge best.
+DERIVED_CLASS(SobolSampler, Sampler) {
+
+protected:
+    [[nodiscard]] uint32_t _kind() const noexcept override { return SAMPLER_SOBOL; }
+
+public:
+    CREATOR("Sobol") noexcept { return std::make_shared<SobolSampler>(); }
+};
+
+}
@@ -0,0 +1,46 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.h"
+
+namespace luisa::util {
+
+bool MappedFile::open(const std::filesystem::path &path) noexcept {
+    
+    close();
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) { return false; }
+    
+    struct stat status{};
+    if (::fstat(fd, &status) != 0 || !S_ISREG(status.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    
+    // empty files cannot be mapped, but open as empty contents all the same
+    auto size = static_cast<size_t>(status.st_size);
+    if (size != 0u) {
+        auto data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        ::madvise(data, size, MADV_SEQUENTIAL);
+        _data = static_cast<const char *>(data);
+        _size = size;
+    }
+    ::close(fd);  // the mapping outlives the descriptor
+    _is_open = true;
+    return true;
+}
+
+void MappedFile::close() noexcept {
+    if (_data != nullptr) { ::munmap(const_cast<char *>(_data), _size); }
+    _data = nullptr;
+    _size = 0u;
+    _is_open = false;
+}
+
+}
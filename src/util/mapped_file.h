@@ -0,0 +1,32 @@
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+
+#include "noncopyable.h"
+
+namespace luisa::util {
+
+// A read-only memory mapping of a whole file, so its contents are paged in as they are read rather than copied up front.
+class MappedFile : Noncopyable {
+
+private:
+    const char *_data{nullptr};
+    size_t _size{0u};
+    bool _is_open{false};
+
+public:
+    MappedFile() noexcept = default;
+    ~MappedFile() noexcept { close(); }
+    
+    // maps the regular file at path, replacing the mapping held so far, and tells whether it succeeded
+    bool open(const std::filesystem::path &path) noexcept;
+    void close() noexcept;
+    
+    [[nodiscard]] bool is_open() const noexcept { return _is_open; }
+    
+    // valid until the file is closed or another one opened
+    [[nodiscard]] std::string_view contents() const noexcept { return {_data, _size}; }
+};
+
+}
@@ -0,0 +1,62 @@
+#include <algorithm>
+#include "thread_pool.h"
+
+namespace luisa::util {
+
+ThreadPool::ThreadPool(uint32_t worker_count) {
+    worker_count = std::max(worker_count, 1u);
+    _workers.reserve(worker_count - 1u);
+    for (auto i = 1u; i < worker_count; i++) {
+        _workers.emplace_back([this, i] { _worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() noexcept {
+    {
+        std::lock_guard lock{_mutex};
+        _should_stop = true;
+    }
+    _task_cv.notify_all();
+    for (auto &&worker : _workers) { worker.join(); }
+}
+
+ThreadPool &ThreadPool::instance() {
+    static ThreadPool pool{std::thread::hardware_concurrency()};
+    return pool;
+}
+
+void ThreadPool::_worker_loop(uint32_t worker_index) {
+    uint64_t last_task_id = 0u;
+    for (;;) {
+        const std::function<void(uint32_t)> *task = nullptr;
+        {
+            std::unique_lock lock{_mutex};
+            _task_cv.wait(lock, [&] { return _should_stop || _task_id != last_task_id; });
+            if (_should_stop) { return; }
+            last_task_id = _task_id;
+            task = _task;
+        }
+        (*task)(worker_index);
+        {
+            std::lock_guard lock{_mutex};
+            if (--_running_workers == 0u) { _done_cv.notify_one(); }
+        }
+    }
+}
+
+void ThreadPool::run(const std::function<void(uint32_t)> &task) {
+    std::lock_guard run_lock{_run_mutex};
+    {
+        std::lock_guard lock{_mutex};
+        _task = &task;
+        _running_workers = static_cast<uint32_t>(_workers.size());
+        _task_id++;
+    }
+    _task_cv.notify_all();
+    task(0u);
+    std::unique_lock lock{_mutex};
+    _done_cv.wait(lock, [this] { return _running_workers == 0u; });
+    _task = nullptr;
+}
+
+}
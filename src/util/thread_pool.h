@@ -0,0 +1,42 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+#include "noncopyable.h"
+
+namespace luisa::util {
+
+// Persistent workers for host-side parallel work, so that dispatches never pay for thread creation.
+// The calling thread takes part as worker 0, and run() is not reentrant.
+class ThreadPool : Noncopyable {
+
+private:
+    std::vector<std::thread> _workers;
+    const std::function<void(uint32_t)> *_task{nullptr};
+    uint64_t _task_id{0u};
+    uint32_t _running_workers{0u};
+    bool _should_stop{false};
+    std::mutex _mutex;
+    std::mutex _run_mutex;
+    std::condition_variable _task_cv;
+    std::condition_variable _done_cv;
+
+    void _worker_loop(uint32_t worker_index);
+
+public:
+    explicit ThreadPool(uint32_t worker_count);
+    ~ThreadPool() noexcept;
+
+    [[nodiscard]] static ThreadPool &instance();
+
+    [[nodiscard]] uint32_t worker_count() const noexcept { return static_cast<uint32_t>(_workers.size()) + 1u; }
+
+    // invokes task(worker_index) once on every worker and blocks until all of them have returned
+    void run(const std::function<void(uint32_t)> &task);
+};
+
+}